@@ -0,0 +1,259 @@
+#include "sysmon.h"
+
+// Rolling windows of --windows: min, max, mean and p50/p95/p99 of the fast
+// metrics over the last 10 s, 1 min and 5 min.
+//
+// The fast collectors (CPU, memory, disk and network rates) are sampled on
+// their own short period, 100 ms by default. Every series keeps, per window,
+// a ring of WINDOW_SLOTS sub-windows of window / WINDOW_SLOTS seconds each;
+// a sample only updates the current sub-window of each window (count, sum,
+// min, max and one histogram bin), and a sub-window is cleared when the ring
+// comes back to it. A window's statistics merge its sub-windows when a
+// sample is displayed, so they cover between (WINDOW_SLOTS - 1) / WINDOW_SLOTS
+// of the window and all of it. Memory per series is fixed.
+//
+// Quantiles come from the merged histograms. Percentages use linear bins
+// over 0-100; byte rates use logarithmic bins, three per power of two (a
+// relative error of at most 12%). Estimates are clamped to the exact min
+// and max.
+
+typedef struct {
+    uint32_t count;
+    double sum;
+    double min;
+    double max;
+    uint16_t bins[WINDOW_BINS];
+} window_slot_t;
+
+typedef struct {
+    window_slot_t slots[WINDOW_COUNT][WINDOW_SLOTS];
+} series_t;
+
+// Window lengths in seconds
+static const double window_seconds[WINDOW_COUNT] = {10.0, 60.0, 300.0};
+static const char *window_names[WINDOW_COUNT] = {"10s", "1m", "5m"};
+
+// Fixed series ahead of the per-core ones
+enum {
+    SERIES_CPU,
+    SERIES_IOWAIT,
+    SERIES_MEMORY,
+    SERIES_SWAP,
+    SERIES_DISK_READ,
+    SERIES_DISK_WRITE,
+    SERIES_NET_RX,
+    SERIES_NET_TX,
+    SERIES_CORES                        // First per-core series
+};
+
+static const struct {
+    const char *name;
+    series_unit_t unit;
+} fixed_series[SERIES_CORES] = {
+    [SERIES_CPU]        = {"cpu",        SERIES_PERCENT},
+    [SERIES_IOWAIT]     = {"iowait",     SERIES_PERCENT},
+    [SERIES_MEMORY]     = {"memory",     SERIES_PERCENT},
+    [SERIES_SWAP]       = {"swap",       SERIES_PERCENT},
+    [SERIES_DISK_READ]  = {"disk.read",  SERIES_BYTES_RATE},
+    [SERIES_DISK_WRITE] = {"disk.write", SERIES_BYTES_RATE},
+    [SERIES_NET_RX]     = {"net.rx",     SERIES_BYTES_RATE},
+    [SERIES_NET_TX]     = {"net.tx",     SERIES_BYTES_RATE},
+};
+
+static series_t *series = NULL;
+static series_stats_t *stats = NULL;    // Handed out in window_info_t
+static int series_count = 0;
+static int64_t epochs[WINDOW_COUNT];    // Sub-window number of each current slot
+
+// Lower bound of every logarithmic bin above bin 0: 2^((i - 1) / 3)
+static double log_bounds[WINDOW_BINS];
+
+#define CBRT_2  1.2599210498948732      // Ratio between two logarithmic bins
+#define SQRT6_2 1.1224620483093730      // Geometric middle of a bin over its bound
+
+const char *window_name(int window) {
+    return window >= 0 && window < WINDOW_COUNT ? window_names[window] : "?";
+}
+
+// Sizes the series for the cores present at startup
+int aggregate_open(int cores) {
+    aggregate_close();
+
+    series_count = SERIES_CORES + cores;
+    series = calloc((size_t)series_count, sizeof(series_t));
+    stats = calloc((size_t)series_count, sizeof(series_stats_t));
+    if (!series || !stats) {
+        aggregate_close();
+        return -1;
+    }
+
+    for (int i = 0; i < series_count; i++) {
+        if (i < SERIES_CORES) {
+            snprintf(stats[i].name, sizeof(stats[i].name), "%s", fixed_series[i].name);
+            stats[i].unit = fixed_series[i].unit;
+        } else {
+            snprintf(stats[i].name, sizeof(stats[i].name), "cpu%d", i - SERIES_CORES);
+            stats[i].unit = SERIES_PERCENT;
+        }
+    }
+    for (int w = 0; w < WINDOW_COUNT; w++) epochs[w] = -1;
+
+    log_bounds[1] = 1.0;
+    for (int i = 2; i < WINDOW_BINS; i++) log_bounds[i] = log_bounds[i - 1] * CBRT_2;
+    return 0;
+}
+
+void aggregate_close(void) {
+    free(series);
+    free(stats);
+    series = NULL;
+    stats = NULL;
+    series_count = 0;
+}
+
+static int value_bin(series_unit_t unit, double v) {
+    if (unit == SERIES_PERCENT) {
+        int bin = (int)(v * (WINDOW_BINS - 1) / 100.0);
+        if (bin < 0) return 0;
+        return bin < WINDOW_BINS ? bin : WINDOW_BINS - 1;
+    }
+
+    if (v < 1.0) return 0;
+    int lo = 1, hi = WINDOW_BINS - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (log_bounds[mid] <= v) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// Value a bin stands for
+static double bin_value(series_unit_t unit, int bin) {
+    if (unit == SERIES_PERCENT) return (bin + 0.5) * 100.0 / (WINDOW_BINS - 1);
+    return bin == 0 ? 0.5 : log_bounds[bin] * SQRT6_2;
+}
+
+// Moves every window to the sub-window holding now, clearing the ones the
+// ring passes over
+static void rotate(double now) {
+    for (int w = 0; w < WINDOW_COUNT; w++) {
+        int64_t epoch = (int64_t)(now * WINDOW_SLOTS / window_seconds[w]);
+        if (epoch == epochs[w]) continue;
+
+        int64_t first = epochs[w] < 0 || epoch - epochs[w] > WINDOW_SLOTS ?
+                        epoch - WINDOW_SLOTS + 1 : epochs[w] + 1;
+        for (int64_t e = first; e <= epoch; e++) {
+            int slot = (int)(e % WINDOW_SLOTS);
+            for (int i = 0; i < series_count; i++) {
+                memset(&series[i].slots[w][slot], 0, sizeof(window_slot_t));
+            }
+        }
+        epochs[w] = epoch;
+    }
+}
+
+static void feed(int index, double v) {
+    if (index >= series_count || v < 0) return;
+
+    int bin = value_bin(stats[index].unit, v);
+    for (int w = 0; w < WINDOW_COUNT; w++) {
+        window_slot_t *slot = &series[index].slots[w][epochs[w] % WINDOW_SLOTS];
+        if (slot->count == 0 || v < slot->min) slot->min = v;
+        if (slot->count == 0 || v > slot->max) slot->max = v;
+        slot->count++;
+        slot->sum += v;
+        if (slot->bins[bin] < UINT16_MAX) slot->bins[bin]++;
+    }
+    stats[index].current = v;
+}
+
+// Adds one fast sample (CLOCK_MONOTONIC time now) to every series
+void aggregate_feed(const system_info_t *sample, double now) {
+    if (!series) return;
+    rotate(now);
+
+    if (sample->valid_flags & SHOW_CPU) {
+        feed(SERIES_CPU, sample->cpu.total_usage);
+        feed(SERIES_IOWAIT, sample->cpu.iowait_percent);
+        for (int i = 0; i < sample->cpu.cores; i++) {
+            feed(SERIES_CORES + i, sample->cpu.usage[i]);
+        }
+    }
+    if (sample->valid_flags & SHOW_MEMORY) {
+        feed(SERIES_MEMORY, sample->memory.usage_percent);
+        feed(SERIES_SWAP, sample->memory.swap_percent);
+    }
+    if (sample->valid_flags & SHOW_DISK) {
+        double read = 0.0, write = 0.0;
+        for (int i = 0; i < sample->disk.device_count; i++) {
+            read += sample->disk.devices[i].read_bytes_per_sec;
+            write += sample->disk.devices[i].write_bytes_per_sec;
+        }
+        feed(SERIES_DISK_READ, read);
+        feed(SERIES_DISK_WRITE, write);
+    }
+    if (sample->valid_flags & SHOW_NET) {
+        feed(SERIES_NET_RX, sample->net.rx_bytes_per_sec);
+        feed(SERIES_NET_TX, sample->net.tx_bytes_per_sec);
+    }
+}
+
+// Estimates the quantile q from merged bins, within the exact min and max
+static double quantile(const uint32_t *bins, const window_stats_t *window, series_unit_t unit,
+                       double q) {
+    uint32_t rank = (uint32_t)(q * (window->count - 1)) + 1;
+    uint32_t seen = 0;
+
+    for (int bin = 0; bin < WINDOW_BINS; bin++) {
+        seen += bins[bin];
+        if (seen >= rank) {
+            double v = bin_value(unit, bin);
+            if (v < window->min) return window->min;
+            if (v > window->max) return window->max;
+            return v;
+        }
+    }
+    return window->max;
+}
+
+// Fills out with the statistics of every window at time now; the series
+// stay valid until the next call
+void aggregate_stats(window_info_t *out, double now) {
+    uint32_t bins[WINDOW_BINS];
+
+    memset(out, 0, sizeof(window_info_t));
+    if (!series) return;
+    rotate(now);
+
+    for (int i = 0; i < series_count; i++) {
+        series_unit_t unit = stats[i].unit;
+        for (int w = 0; w < WINDOW_COUNT; w++) {
+            window_stats_t *window = &stats[i].windows[w];
+            double sum = 0.0;
+
+            memset(window, 0, sizeof(window_stats_t));
+            memset(bins, 0, sizeof(bins));
+            for (int s = 0; s < WINDOW_SLOTS; s++) {
+                const window_slot_t *slot = &series[i].slots[w][s];
+                if (slot->count == 0) continue;
+                if (window->count == 0 || slot->min < window->min) window->min = slot->min;
+                if (window->count == 0 || slot->max > window->max) window->max = slot->max;
+                window->count += slot->count;
+                sum += slot->sum;
+                for (int b = 0; b < WINDOW_BINS; b++) bins[b] += slot->bins[b];
+            }
+            if (window->count == 0) continue;
+
+            window->mean = sum / window->count;
+            window->p50 = quantile(bins, window, unit, 0.50);
+            window->p95 = quantile(bins, window, unit, 0.95);
+            window->p99 = quantile(bins, window, unit, 0.99);
+        }
+    }
+    out->count = series_count;
+    out->series = stats;
+}
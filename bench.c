@@ -0,0 +1,699 @@
+#include "sysmon.h"
+#include <stdarg.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+// Benchmarks for the data collectors.
+// Linked with -Wl,--wrap so that open/close calls and heap allocations made
+// by the collectors are counted; read-type syscalls are taken from the
+// kernel's /proc/self/io.
+
+#define DEFAULT_ITERATIONS 2000
+
+static unsigned long open_calls = 0;
+static unsigned long close_calls = 0;
+static unsigned long alloc_calls = 0;     // Updated atomically, scan workers allocate too
+
+int __real_open(const char *path, int flags, ...);
+int __real_openat(int dirfd, const char *path, int flags, ...);
+int __real_close(int fd);
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_fclose(FILE *fp);
+
+int __wrap_open(const char *path, int flags, ...) {
+    mode_t mode = 0;
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    open_calls++;
+    return __real_open(path, flags, mode);
+}
+
+int __wrap_openat(int dirfd, const char *path, int flags, ...) {
+    mode_t mode = 0;
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    open_calls++;
+    return __real_openat(dirfd, path, flags, mode);
+}
+
+int __wrap_close(int fd) {
+    close_calls++;
+    return __real_close(fd);
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode) {
+    open_calls++;
+    return __real_fopen(path, mode);
+}
+
+int __wrap_fclose(FILE *fp) {
+    close_calls++;
+    return __real_fclose(fp);
+}
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+int __real_posix_memalign(void **ptr, size_t alignment, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    __atomic_fetch_add(&alloc_calls, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&alloc_calls, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    __atomic_fetch_add(&alloc_calls, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+int __wrap_posix_memalign(void **ptr, size_t alignment, size_t size) {
+    __atomic_fetch_add(&alloc_calls, 1, __ATOMIC_RELAXED);
+    return __real_posix_memalign(ptr, alignment, size);
+}
+
+// Returns a counter of this process from /proc/self/io ("syscr:", "wchar:", ...)
+static unsigned long self_io(const char *key) {
+    char buf[512];
+    unsigned long value = 0;
+    int fd = __real_open("/proc/self/io", O_RDONLY);
+    if (fd < 0) return 0;
+
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    __real_close(fd);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+
+    const char *p = strstr(buf, key);
+    if (p) scan_ulong(p + strlen(key), &value);
+    return value;
+}
+
+// Returns the number of read-type syscalls issued by this process so far
+static unsigned long read_syscalls(void) {
+    return self_io("syscr:");
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Stdio implementation the sampler replaced, kept here as the baseline
+static void legacy_sample(void) {
+    static const char *files[] = {"/proc/cpuinfo", "/proc/stat", "/proc/meminfo", "/proc/uptime"};
+    char line[MAX_LINE_LEN];
+    char key[64];
+    unsigned long a, b, c, d, e, f, g, h;
+    double uptime;
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        FILE *fp = fopen(files[i], "r");
+        if (!fp) continue;
+
+        if (i == 3) {
+            if (fscanf(fp, "%lf", &uptime) != 1) uptime = 0;
+        }
+        while (i != 3 && fgets(line, sizeof(line), fp)) {
+            if (i == 1 && strncmp(line, "cpu", 3) == 0) {
+                sscanf(line, "%*s %lu %lu %lu %lu %lu %lu %lu %lu", &a, &b, &c, &d, &e, &f, &g, &h);
+            } else if (i == 2) {
+                sscanf(line, "%63s %lu", key, &a);
+            }
+        }
+        fclose(fp);
+    }
+
+    // Temperature probe, unchanged between both variants
+    FILE *fp = fopen("/sys/class/thermal/thermal_zone0/temp", "r");
+    if (!fp) fp = fopen("/sys/devices/platform/coretemp.0/hwmon/hwmon0/temp1_input", "r");
+    if (fp) {
+        if (fscanf(fp, "%lf", &uptime) != 1) uptime = 0;
+        fclose(fp);
+    }
+}
+
+static void sampler_sample(void) {
+    cpu_info_t cpu;
+    memory_info_t memory;
+    uptime_info_t uptime;
+
+    read_cpu_info(&cpu);
+    read_memory_info(&memory);
+    read_uptime_info(&uptime);
+}
+
+// Runs one variant and prints ns and syscalls per sample
+static void run_variant(const char *name, void (*sample)(void), int iterations) {
+    sample();   // Warm up buffers and descriptors
+
+    unsigned long opens = open_calls, closes = close_calls;
+    unsigned long reads = read_syscalls();
+    double start = now_ns();
+
+    for (int i = 0; i < iterations; i++) {
+        sample();
+    }
+
+    double elapsed = now_ns() - start;
+    reads = read_syscalls() - reads;
+    opens = open_calls - opens;
+    closes = close_calls - closes;
+
+    printf("  %-10s %10.0f ns/sample %8.2f syscalls/sample (open %.2f, read %.2f, close %.2f)\n",
+           name, elapsed / iterations,
+           (double)(opens + reads + closes) / iterations,
+           (double)opens / iterations, (double)reads / iterations, (double)closes / iterations);
+}
+
+static void bench_sampler(int iterations) {
+    printf("sampler: cpuinfo + stat + meminfo + uptime, %d iterations\n", iterations);
+    run_variant("stdio", legacy_sample, iterations);
+    run_variant("pread", sampler_sample, iterations);
+}
+
+// Full process scan at increasing thread counts
+static void bench_scan(int iterations) {
+    static const int thread_counts[] = {1, 2, 4, 8, 16};
+    process_info_t processes[DEFAULT_TOP_PROCESSES];
+    double base = 0.0;
+
+    iterations = iterations / 20 > 5 ? iterations / 20 : 5;
+    printf("scan: top %d processes by CPU, %d iterations\n", DEFAULT_TOP_PROCESSES, iterations);
+
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        if (process_scan_set_threads(thread_counts[t]) != 0) {
+            perror("process_scan_set_threads");
+            return;
+        }
+        read_top_processes(processes, DEFAULT_TOP_PROCESSES, SORT_CPU);   // Warm up
+
+        unsigned long opens = open_calls;
+        unsigned long reads = read_syscalls();
+        double start = now_ns();
+        for (int i = 0; i < iterations; i++) {
+            read_top_processes(processes, DEFAULT_TOP_PROCESSES, SORT_CPU);
+        }
+        double per_scan = (now_ns() - start) / iterations;
+        reads = read_syscalls() - reads;
+        opens = open_calls - opens;
+        if (t == 0) base = per_scan;
+
+        printf("  %2d threads %10.3f ms/scan %6.2fx %10.0f opens/scan %10.0f reads/scan\n",
+               thread_counts[t], per_scan / 1e6, base / per_scan,
+               (double)opens / iterations, (double)reads / iterations);
+    }
+    process_scan_set_threads(1);
+}
+
+// Per-core delta kernels on synthetic counters at increasing core counts
+static void bench_kernel(int iterations) {
+    static const int core_counts[] = {32, 256, 1024};
+    int kernel_count;
+    const cpu_kernel_t *kernels = cpu_kernel_list(&kernel_count);
+
+    iterations *= 50;
+    printf("kernel: per-core usage/iowait/steal/irq, %d iterations\n", iterations);
+
+    for (size_t c = 0; c < sizeof(core_counts) / sizeof(core_counts[0]); c++) {
+        int cores = core_counts[c];
+        cpu_counters_t prev = {{0}}, cur = {{0}};
+        cpu_usage_t reference = {0}, out = {0};
+
+        if (cpu_counters_resize(&prev, 0, cores) != 0 || cpu_counters_resize(&cur, 0, cores) != 0 ||
+            cpu_usage_resize(&reference, 0, cores) != 0 || cpu_usage_resize(&out, 0, cores) != 0) {
+            perror("cpu_counters_resize");
+            return;
+        }
+
+        // Plausible ticks: a large base plus a 0..199 increment per field
+        unsigned int seed = 1;
+        for (int f = 0; f < CPU_FIELDS; f++) {
+            for (int i = 0; i < cores; i++) {
+                seed = seed * 1103515245u + 12345u;
+                prev.field[f][i] = 1000000ull * (f + 1) + i;
+                cur.field[f][i] = prev.field[f][i] + (seed >> 16) % 200;
+            }
+        }
+        kernels[0].fn(&cur, &prev, &reference, cores);
+
+        for (int k = 0; k < kernel_count; k++) {
+            kernels[k].fn(&cur, &prev, &out, cores);   // Warm up
+
+            double start = now_ns();
+            for (int i = 0; i < iterations; i++) {
+                kernels[k].fn(&cur, &prev, &out, cores);
+            }
+            double per_call = (now_ns() - start) / iterations;
+
+            // Every kernel must agree with the scalar one
+            double max_error = 0.0;
+            const double *a[] = {reference.usage, reference.iowait, reference.steal, reference.irq};
+            const double *b[] = {out.usage, out.iowait, out.steal, out.irq};
+            for (int m = 0; m < 4; m++) {
+                for (int i = 0; i < cores; i++) {
+                    double error = a[m][i] > b[m][i] ? a[m][i] - b[m][i] : b[m][i] - a[m][i];
+                    if (error > max_error) max_error = error;
+                }
+            }
+
+            printf("  %4d cores %-7s %10.1f ns/call %8.2f ns/core  max error %.2g\n",
+                   cores, kernels[k].name, per_call, per_call / cores, max_error);
+        }
+
+        cpu_counters_free(&prev);
+        cpu_counters_free(&cur);
+        cpu_usage_free(&reference);
+        cpu_usage_free(&out);
+    }
+}
+
+// Watch-mode frames: clear and reprint through line-buffered stdio versus
+// the diffing screen renderer, both writing to /dev/null
+#define RENDER_SAMPLES 16
+
+static void bench_render(int iterations) {
+    static system_info_t samples[RENDER_SAMPLES];
+    collect_options_t options = {
+        .show_flags = SHOW_ALL, .top_count = DEFAULT_TOP_PROCESSES, .sort_key = SORT_CPU,
+    };
+
+    // Consecutive real samples, so frames change the way they do when watching
+    for (int i = 0; i < RENDER_SAMPLES; i++) {
+        collect_system_info(&samples[i], &options);
+        struct timespec pause = {0, 20 * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+
+    int fd = __real_open("/dev/null", O_WRONLY);
+    FILE *fp = fdopen(fd, "w");
+    if (fd < 0 || !fp) {
+        perror("/dev/null");
+        return;
+    }
+    setvbuf(fp, NULL, _IOLBF, 0);   // Like stdout on a terminal
+
+    iterations = iterations / 10 > 10 ? iterations / 10 : 10;
+    printf("render: watch frames with all sections, %d iterations\n", iterations);
+
+    for (int variant = 0; variant < 2; variant++) {
+        if (variant == 1 && screen_init(fd) != 0) {
+            perror("screen_init");
+            break;
+        }
+
+        unsigned long writes = self_io("syscw:");
+        unsigned long bytes = self_io("wchar:");
+        double start = now_ns();
+
+        for (int i = 0; i < iterations; i++) {
+            const system_info_t *info = &samples[i % RENDER_SAMPLES];
+            if (variant == 0) {
+                display_set_output(fp);
+                clear_screen();
+                display_system_info(info, SHOW_ALL);
+                fflush(fp);
+            } else {
+                display_set_output(screen_begin());
+                display_system_info(info, SHOW_ALL);
+                screen_end();
+            }
+        }
+
+        double per_frame = (now_ns() - start) / iterations;
+        writes = self_io("syscw:") - writes;
+        bytes = self_io("wchar:") - bytes;
+
+        printf("  %-10s %10.0f ns/frame %10.0f bytes/frame %8.2f writes/frame\n",
+               variant == 0 ? "stdio" : "diff", per_frame,
+               (double)bytes / iterations, (double)writes / iterations);
+    }
+
+    display_set_output(stdout);
+    screen_close();
+    fclose(fp);
+}
+
+// Synthetic /proc and /sys trees, so collectors can be measured at sizes the
+// machine running the benchmark does not have. Each configuration gets its
+// own <dir>/<name>/proc and <dir>/<name>/sys, selected with sysmon_set_roots.
+
+// Extra meminfo keys in the large configuration
+#define FIXTURE_MEMINFO_EXTRA 4096
+
+static char fixture_dir[PATH_MAX];
+
+// Creates every missing directory of path (like mkdir -p)
+static int fixture_mkdirs(const char *path) {
+    char buf[PATH_MAX];
+
+    snprintf(buf, sizeof(buf), "%s", path);
+    for (char *p = buf + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(buf, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    return mkdir(buf, 0755) != 0 && errno != EEXIST ? -1 : 0;
+}
+
+// Writes a file below the fixture directory, creating its parents
+static int fixture_write(const char *name, const char *data, size_t len) {
+    char path[PATH_MAX];
+
+    if (snprintf(path, sizeof(path), "%s/%s", fixture_dir, name) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = __real_open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == ENOENT) {
+        char *slash = strrchr(path, '/');
+        *slash = '\0';
+        if (fixture_mkdirs(path) != 0) return -1;
+        *slash = '/';
+        fd = __real_open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (fd < 0) return -1;
+    ssize_t n = write(fd, data, len);
+    __real_close(fd);
+    return n == (ssize_t)len ? 0 : -1;
+}
+
+// Collects printf output for one fixture file in memory
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t len;
+} fixture_file_t;
+
+static int fixture_begin(fixture_file_t *f) {
+    f->fp = open_memstream(&f->buf, &f->len);
+    return f->fp ? 0 : -1;
+}
+
+static int fixture_end(fixture_file_t *f, const char *name) {
+    int result = __real_fclose(f->fp) == 0 ? fixture_write(name, f->buf, f->len) : -1;
+    free(f->buf);
+    return result;
+}
+
+// The files every configuration needs: stat and cpuinfo for cores CPUs,
+// meminfo with extra padding keys, uptime, the possible-CPU range and a
+// thermal zone
+static int fixture_base(const char *name, int cores, int meminfo_extra) {
+    fixture_file_t f;
+    char path[PATH_MAX];
+
+    if (fixture_begin(&f) != 0) return -1;
+    fprintf(f.fp, "cpu  %d %d %d %d %d %d %d %d 0 0\n",
+            cores * 1000, cores * 10, cores * 500, cores * 90000, cores * 50,
+            cores * 5, cores * 20, cores * 3);
+    for (int i = 0; i < cores; i++) {
+        fprintf(f.fp, "cpu%d %d 10 %d 90000 50 5 20 3 0 0\n", i, 1000 + i, 500 + i % 7);
+    }
+    fprintf(f.fp, "intr 123456789 0 0 0\nctxt 987654321\nbtime 1700000000\n"
+                  "processes 123456\nprocs_running 2\nprocs_blocked 0\n");
+    snprintf(path, sizeof(path), "%s/proc/stat", name);
+    if (fixture_end(&f, path) != 0) return -1;
+
+    if (fixture_begin(&f) != 0) return -1;
+    for (int i = 0; i < cores; i++) {
+        fprintf(f.fp, "processor\t: %d\nvendor_id\t: GenuineIntel\ncpu family\t: 6\n"
+                      "model\t\t: 143\nmodel name\t: Synthetic Xeon @ 2.00GHz\n"
+                      "cpu MHz\t\t: 2000.000\ncache size\t: 107520 KB\n"
+                      "flags\t\t: fpu vme de pse tsc msr pae mce cx8 apic sep sse sse2 avx avx2\n\n", i);
+    }
+    snprintf(path, sizeof(path), "%s/proc/cpuinfo", name);
+    if (fixture_end(&f, path) != 0) return -1;
+
+    if (fixture_begin(&f) != 0) return -1;
+    fprintf(f.fp, "MemTotal:       263842560 kB\nMemFree:        201234432 kB\n"
+                  "MemAvailable:   240123904 kB\nBuffers:          1234560 kB\n"
+                  "Cached:          30123456 kB\nSwapCached:             0 kB\n"
+                  "Active:          20123456 kB\nInactive:        15123456 kB\n"
+                  "SwapTotal:        8388604 kB\nSwapFree:         8388604 kB\n"
+                  "Dirty:                128 kB\nShmem:             123456 kB\n"
+                  "Slab:             2345678 kB\nPageTables:         45678 kB\n");
+    for (int i = 0; i < meminfo_extra; i++) {
+        fprintf(f.fp, "Synthetic%04d:  %12d kB\n", i, i * 4);
+    }
+    fprintf(f.fp, "HugePages_Total:       0\nHugepagesize:       2048 kB\n");
+    snprintf(path, sizeof(path), "%s/proc/meminfo", name);
+    if (fixture_end(&f, path) != 0) return -1;
+
+    static const char uptime[] = "123456.78 9876543.21\n";
+    snprintf(path, sizeof(path), "%s/proc/uptime", name);
+    if (fixture_write(path, uptime, sizeof(uptime) - 1) != 0) return -1;
+
+    char range[32];
+    int len = snprintf(range, sizeof(range), cores > 1 ? "0-%d\n" : "0\n", cores - 1);
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/possible", name);
+    if (fixture_write(path, range, (size_t)len) != 0) return -1;
+
+    static const char temp[] = "45000\n";
+    snprintf(path, sizeof(path), "%s/sys/class/thermal/thermal_zone0/temp", name);
+    return fixture_write(path, temp, sizeof(temp) - 1);
+}
+
+// Adds pids process directories with stat, io, status and smaps_rollup files
+static int fixture_processes(const char *name, int pids) {
+    char path[PATH_MAX], data[512];
+
+    for (int pid = 1; pid <= pids; pid++) {
+        unsigned int seed = (unsigned int)pid * 2654435761u;
+        int len = snprintf(data, sizeof(data),
+                           "%d (worker %d) S 1 %d %d 0 -1 4194560 %u 0 0 0 %u %u 0 0 20 0 %u 0 %u "
+                           "%u %u 18446744073709551615 1 1 0 0 0 0 0 4096 0 0 0 0 17 %d 0 0 0 0 0\n",
+                           pid, pid % 1000, pid, pid, seed % 5000, seed % 100000, seed % 30000,
+                           1 + seed % 32, 1000 + pid, 100000000u + seed % 900000000u,
+                           seed % 250000, pid % 8);
+        snprintf(path, sizeof(path), "%s/proc/%d/stat", name, pid);
+        if (fixture_write(path, data, (size_t)len) != 0) return -1;
+
+        len = snprintf(data, sizeof(data),
+                       "rchar: %u\nwchar: %u\nsyscr: %u\nsyscw: %u\n"
+                       "read_bytes: %u\nwrite_bytes: %u\ncancelled_write_bytes: 0\n",
+                       seed, seed / 2, seed % 100000, seed % 50000, seed / 4, seed / 8);
+        snprintf(path, sizeof(path), "%s/proc/%d/io", name, pid);
+        if (fixture_write(path, data, (size_t)len) != 0) return -1;
+
+        // Tails of status and smaps_rollup, read for the top K only
+        len = snprintf(data, sizeof(data),
+                       "Name:\tworker %d\nState:\tS (sleeping)\nThreads:\t%u\n"
+                       "voluntary_ctxt_switches:\t%u\nnonvoluntary_ctxt_switches:\t%u\n",
+                       pid % 1000, 1 + seed % 32, seed % 700000, seed % 9000);
+        snprintf(path, sizeof(path), "%s/proc/%d/status", name, pid);
+        if (fixture_write(path, data, (size_t)len) != 0) return -1;
+
+        len = snprintf(data, sizeof(data),
+                       "00400000-7fffffffe000 ---p 00000000 00:00 0 [rollup]\n"
+                       "Rss:  %u kB\nPss:  %u kB\n",
+                       seed % 250000 * 4, seed % 250000 * 3);
+        snprintf(path, sizeof(path), "%s/proc/%d/smaps_rollup", name, pid);
+        if (fixture_write(path, data, (size_t)len) != 0) return -1;
+    }
+    return 0;
+}
+
+static int fixture_remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+// Points the collectors at one configuration of the fixture tree
+static int fixture_use(const char *name) {
+    char proc[PATH_MAX], sys[PATH_MAX];
+
+    if (snprintf(proc, sizeof(proc), "%s/%s/proc", fixture_dir, name) >= (int)sizeof(proc) ||
+        snprintf(sys, sizeof(sys), "%s/%s/sys", fixture_dir, name) >= (int)sizeof(sys)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return sysmon_set_roots(proc, sys);
+}
+
+// Resets the peak RSS of this process where the kernel allows it
+static void peak_rss_reset(void) {
+    int fd = __real_open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    if (write(fd, "5", 1) != 1) {
+        // Old kernel: the peak below is the peak since start
+    }
+    __real_close(fd);
+}
+
+// Peak RSS in kB since the last reset (VmHWM), or since start
+static long peak_rss_kb(void) {
+    char buf[4096];
+    unsigned long value;
+    int fd = __real_open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+
+    if (fd >= 0) {
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        __real_close(fd);
+        if (n > 0) {
+            buf[n] = '\0';
+            const char *p = strstr(buf, "VmHWM:");
+            if (p && scan_ulong(p + 6, &value)) return (long)value;
+        }
+    }
+
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+}
+
+static void fixture_sample_cpu(void) {
+    cpu_info_t cpu;
+    read_cpu_info(&cpu);
+}
+
+static void fixture_sample_memory(void) {
+    memory_info_t memory;
+    read_memory_info(&memory);
+}
+
+static void fixture_sample_processes(void) {
+    process_info_t processes[DEFAULT_TOP_PROCESSES];
+    read_top_processes(processes, DEFAULT_TOP_PROCESSES, SORT_CPU);
+}
+
+// Times one configuration; units is what the per-unit cost is divided by
+static void fixture_run(const char *name, const char *unit, int units,
+                        void (*sample)(void), int iterations) {
+    if (fixture_use(name) != 0) {
+        perror(name);
+        return;
+    }
+
+    // Roughly the same amount of work for every size
+    long repeats = (long)iterations * 500 / units;
+    if (repeats < 3) repeats = 3;
+    if (repeats > iterations) repeats = iterations;
+
+    peak_rss_reset();
+    sample();   // Warm up buffers, descriptors and the process table
+
+    unsigned long allocs = __atomic_load_n(&alloc_calls, __ATOMIC_RELAXED);
+    double start = now_ns();
+    for (long i = 0; i < repeats; i++) {
+        sample();
+    }
+    double per_sample = (now_ns() - start) / repeats;
+    allocs = __atomic_load_n(&alloc_calls, __ATOMIC_RELAXED) - allocs;
+
+    printf("  %-12s %10.1f samples/s %10.1f ns/%-7s %8.2f allocs/sample %8ld kB peak RSS\n",
+           name, 1e9 / per_sample, per_sample / units, unit,
+           (double)allocs / repeats, peak_rss_kb());
+}
+
+static void bench_fixture(int iterations) {
+    static const int core_counts[] = {8, 64, 256, 1024};
+    static const int pid_counts[] = {1000, 10000, 100000};
+    char name[64];
+    const char *tmp = getenv("TMPDIR");
+
+    snprintf(fixture_dir, sizeof(fixture_dir), "%s/sysmon-fixture-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    if (!mkdtemp(fixture_dir)) {
+        perror(fixture_dir);
+        return;
+    }
+
+    printf("fixture: synthetic /proc and /sys under %s, %d iterations max\n", fixture_dir, iterations);
+
+    for (size_t c = 0; c < sizeof(core_counts) / sizeof(core_counts[0]); c++) {
+        snprintf(name, sizeof(name), "cpu-%d", core_counts[c]);
+        if (fixture_base(name, core_counts[c], 0) != 0) {
+            perror(name);
+            goto out;
+        }
+        fixture_run(name, "core", core_counts[c], fixture_sample_cpu, iterations);
+    }
+
+    for (int large = 0; large <= 1; large++) {
+        int extra = large ? FIXTURE_MEMINFO_EXTRA : 0;
+        snprintf(name, sizeof(name), "meminfo-%d", 16 + extra);
+        if (fixture_base(name, 8, extra) != 0) {
+            perror(name);
+            goto out;
+        }
+        fixture_run(name, "line", 16 + extra, fixture_sample_memory, iterations);
+    }
+
+    for (size_t p = 0; p < sizeof(pid_counts) / sizeof(pid_counts[0]); p++) {
+        snprintf(name, sizeof(name), "pids-%d", pid_counts[p]);
+        if (fixture_base(name, 8, 0) != 0 || fixture_processes(name, pid_counts[p]) != 0) {
+            perror(name);
+            goto out;
+        }
+        fixture_run(name, "process", pid_counts[p], fixture_sample_processes, iterations);
+    }
+
+out:
+    sysmon_set_roots("/proc", "/sys");
+    nftw(fixture_dir, fixture_remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+// Available benchmarks, all of them run when none is named
+static const struct {
+    const char *name;
+    void (*run)(int iterations);
+} benchmarks[] = {
+    {"sampler", bench_sampler},
+    {"scan",    bench_scan},
+    {"kernel",  bench_kernel},
+    {"render",  bench_render},
+    {"fixture", bench_fixture},
+};
+
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+int main(int argc, char *argv[]) {
+    int iterations = DEFAULT_ITERATIONS;
+    int selected = 0;
+
+    // Usage: sysmon-bench [-n ITERATIONS] [BENCHMARK...]
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        iterations = atoi(argv[2]);
+        if (iterations <= 0) iterations = DEFAULT_ITERATIONS;
+        first = 3;
+    }
+
+    for (int i = first; i < argc; i++) {
+        size_t b;
+        for (b = 0; b < BENCHMARK_COUNT; b++) {
+            if (strcmp(argv[i], benchmarks[b].name) == 0) break;
+        }
+        if (b == BENCHMARK_COUNT) {
+            fprintf(stderr, "Unknown benchmark: %s\n", argv[i]);
+            return 1;
+        }
+        benchmarks[b].run(iterations);
+        selected++;
+    }
+
+    if (selected == 0) {
+        for (size_t b = 0; b < BENCHMARK_COUNT; b++) {
+            benchmarks[b].run(iterations);
+        }
+    }
+    return 0;
+}
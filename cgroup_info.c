@@ -0,0 +1,534 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+
+// cgroup v2 collector: a ranked tree of the groups below /sys/fs/cgroup
+// (or /sys/fs/cgroup/unified on hosts with the hybrid v1/v2 layout).
+//
+// The hierarchy is walked once and then kept up to date with inotify: every
+// group directory carries a watch for subdirectories being created, removed
+// or renamed, so a refresh costs one non-blocking read of the inotify
+// descriptor instead of a walk over thousands of directories. A full walk
+// only happens again after the event queue overflowed or a watch could not
+// be added.
+//
+// Every refresh reads cpu.stat, memory.current and io.stat of each group for
+// the rates the tree is ranked by. memory.stat and the pressure files are
+// only read for the groups that make it into the tree.
+
+// Events a group directory is watched for
+#define CGROUP_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+// Size of the inotify read buffer
+#define INOTIFY_BUF_SIZE 65536
+
+typedef struct {
+    char *path;                         // Relative to the root, "" for the root itself
+    int parent;                         // Node index, -1 for the root
+    int depth;                          // 0 for the root
+    int wd;                             // inotify watch, -1 if none
+    int seen;                           // Found by the current walk
+    int has_prev;                       // The counters below are from the last sample
+    unsigned long usage_usec;           // cpu.stat
+    unsigned long throttled_usec;
+    unsigned long read_bytes;           // io.stat, summed over devices
+    unsigned long write_bytes;
+    int selected;                       // Part of this sample's tree
+    int first_child, last_child;        // Selected children, busiest first
+    int next_sibling;
+    cgroup_info_t info;                 // Current sample
+} cgroup_node_t;
+
+// Where the v2 hierarchy may be mounted, tried in order
+static const char *cgroup_mounts[] = {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"};
+
+static const char *cgroup_mount = NULL; // The entry of cgroup_mounts in use
+static int cgroup_root_fd = -1;
+static unsigned int cgroup_root_generation = 0;
+static int inotify_fd = -1;
+static int need_walk = 1;               // Tree unknown or events lost
+
+static cgroup_node_t *nodes = NULL;     // Dense, the root at index 0
+static int node_count = 0;
+static int node_cap = 0;
+static int *wd_nodes = NULL;            // Node index per watch descriptor, -1 if none
+static int wd_cap = 0;
+static int *path_index = NULL;          // Open-addressed path -> node index, -1 empty
+static size_t path_index_cap = 0;
+static int *ranked = NULL;              // Scratch: node indices by rank
+static int ranked_cap = 0;
+static cgroup_info_t rows[MAX_CGROUP_ROWS]; // Handed out in cgroup_tree_t
+static double sample_time = 0.0;        // CLOCK_MONOTONIC time of the last sample
+
+// FNV-1a hash of a group path
+static size_t path_hash(const char *path) {
+    uint32_t hash = 2166136261u;
+    while (*path) hash = (hash ^ (unsigned char)*path++) * 16777619u;
+    return hash;
+}
+
+static int path_lookup(const char *path) {
+    if (!path_index) return -1;
+
+    size_t mask = path_index_cap - 1;
+    for (size_t slot = path_hash(path) & mask; path_index[slot] >= 0; slot = (slot + 1) & mask) {
+        if (strcmp(nodes[path_index[slot]].path, path) == 0) return path_index[slot];
+    }
+    return -1;
+}
+
+static void path_insert(int index) {
+    size_t mask = path_index_cap - 1;
+    size_t slot = path_hash(nodes[index].path) & mask;
+    while (path_index[slot] >= 0) slot = (slot + 1) & mask;
+    path_index[slot] = index;
+}
+
+// Rebuilds the path index sized for count nodes (at most half full)
+static int path_index_rebuild(int count) {
+    size_t cap = 64;
+    while (cap < (size_t)count * 2 + 2) cap *= 2;
+
+    if (cap != path_index_cap) {
+        int *slots = realloc(path_index, cap * sizeof(int));
+        if (!slots) return -1;
+        path_index = slots;
+        path_index_cap = cap;
+    }
+    memset(path_index, 0xff, path_index_cap * sizeof(int));
+    for (int i = 0; i < node_count; i++) path_insert(i);
+    return 0;
+}
+
+// Opens a file of a group relative to the cgroup root
+static ssize_t read_group_file(const cgroup_node_t *node, const char *file, char *buf, size_t size) {
+    char path[PATH_MAX];
+
+    if (node->path[0]) {
+        snprintf(path, sizeof(path), "%s/%s", node->path, file);
+    } else {
+        snprintf(path, sizeof(path), "%s", file);
+    }
+
+    int fd = openat(cgroup_root_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        selfstat_io(1, 0);
+        return -1;
+    }
+    ssize_t bytes = read(fd, buf, size - 1);
+    close(fd);
+    selfstat_io(3, bytes > 0 ? (unsigned long)bytes : 0);
+    if (bytes < 0) return -1;
+
+    buf[bytes] = '\0';
+    return bytes;
+}
+
+// Watches a group directory; a group without a watch forces walks
+static void watch_group(int index) {
+    char path[PATH_MAX], root[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s%s%s", cgroup_mount, nodes[index].path[0] ? "/" : "",
+             nodes[index].path);
+    int wd = inotify_add_watch(inotify_fd, sysmon_path(path, root, sizeof(root)), CGROUP_WATCH_MASK);
+    selfstat_io(1, 0);
+    int old_cap = wd_cap;
+    int *grown = wd >= 0 ? grow_array(wd_nodes, &wd_cap, wd + 1, sizeof(int)) : NULL;
+    if (!grown) {
+        // Out of watches (fs.inotify.max_user_watches): fall back to walking
+        need_walk = 1;
+        return;
+    }
+    wd_nodes = grown;
+    for (int i = old_cap; i < wd_cap; i++) wd_nodes[i] = -1;
+    wd_nodes[wd] = index;
+    nodes[index].wd = wd;
+}
+
+// Finds or adds the group at path below parent and marks it seen
+static int add_group(int parent, const char *name) {
+    char path[PATH_MAX];
+
+    if (parent < 0) {
+        path[0] = '\0';
+    } else if (nodes[parent].path[0]) {
+        snprintf(path, sizeof(path), "%s/%s", nodes[parent].path, name);
+    } else {
+        snprintf(path, sizeof(path), "%s", name);
+    }
+
+    int index = path_lookup(path);
+    if (index >= 0) {
+        nodes[index].seen = 1;
+        if (nodes[index].wd < 0) watch_group(index);
+        return index;
+    }
+
+    cgroup_node_t *grown = grow_array(nodes, &node_cap, node_count + 1, sizeof(cgroup_node_t));
+    if (!grown) return -1;
+    nodes = grown;
+    if ((size_t)(node_count + 1) * 2 + 2 > path_index_cap && path_index_rebuild(node_count + 1) != 0) {
+        return -1;
+    }
+
+    cgroup_node_t *node = &nodes[node_count];
+    memset(node, 0, sizeof(cgroup_node_t));
+    node->path = strdup(path);
+    if (!node->path) return -1;
+    node->parent = parent;
+    node->depth = parent < 0 ? 0 : nodes[parent].depth + 1;
+    node->wd = -1;
+    node->seen = 1;
+
+    index = node_count++;
+    path_insert(index);
+    watch_group(index);
+    return index;
+}
+
+// Adds every group below a node, recursively
+static void walk_group(int index) {
+    int fd = openat(cgroup_root_fd, nodes[index].path[0] ? nodes[index].path : ".",
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    selfstat_io(1, 0);
+    if (fd < 0) return;
+
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.') continue;
+
+        int child = add_group(index, entry->d_name);
+        if (child >= 0) walk_group(child);
+    }
+    closedir(dir);
+}
+
+// Drops the groups that are not seen (and everything below them), then
+// packs the node array and renumbers the references to it
+static int sweep_groups(void) {
+    int *new_index = grow_array(ranked, &ranked_cap, node_count, sizeof(int));
+    if (!new_index) return -1;
+    ranked = new_index;
+
+    // Parents always come before their children in the array
+    int kept = 0;
+    for (int i = 0; i < node_count; i++) {
+        if (nodes[i].seen && i > 0 && !nodes[nodes[i].parent].seen) nodes[i].seen = 0;
+        new_index[i] = nodes[i].seen ? kept++ : -1;
+    }
+
+    for (int i = 0; i < node_count; i++) {
+        cgroup_node_t *node = &nodes[i];
+        if (!node->seen) {
+            if (node->wd >= 0) {
+                inotify_rm_watch(inotify_fd, node->wd);
+                wd_nodes[node->wd] = -1;
+            }
+            free(node->path);
+            continue;
+        }
+        if (node->parent >= 0) node->parent = new_index[node->parent];
+        if (node->wd >= 0) wd_nodes[node->wd] = new_index[i];
+        nodes[new_index[i]] = *node;
+    }
+    node_count = kept;
+    return path_index_rebuild(node_count);
+}
+
+// Removes the group at path and everything below it
+static void remove_group(const char *path) {
+    int index = path_lookup(path);
+    if (index <= 0) return;
+
+    for (int i = 0; i < node_count; i++) nodes[i].seen = 1;
+    nodes[index].seen = 0;
+    sweep_groups();
+}
+
+// Walks the whole hierarchy, keeping the counters of known groups
+static void walk_hierarchy(void) {
+    need_walk = 0;
+    for (int i = 0; i < node_count; i++) nodes[i].seen = 0;
+
+    int root = add_group(-1, "");
+    if (root >= 0) walk_group(root);
+    sweep_groups();
+}
+
+// Applies the queued inotify events to the tree
+static void drain_inotify(void) {
+    static char buf[INOTIFY_BUF_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        ssize_t n = read(inotify_fd, buf, sizeof(buf));
+        selfstat_io(1, n > 0 ? (unsigned long)n : 0);
+        if (n <= 0) return;
+
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                need_walk = 1;
+                continue;
+            }
+            if (ev->wd < 0 || ev->wd >= wd_cap || wd_nodes[ev->wd] < 0) continue;
+            if (ev->mask & IN_IGNORED) {
+                // The watched directory is gone; its parent reports the removal
+                nodes[wd_nodes[ev->wd]].wd = -1;
+                wd_nodes[ev->wd] = -1;
+                continue;
+            }
+            if (!(ev->mask & IN_ISDIR) || ev->len == 0) continue;
+
+            int parent = wd_nodes[ev->wd];
+            if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                // Groups created before the watch was added only show up in the walk
+                int child = add_group(parent, ev->name);
+                if (child >= 0) walk_group(child);
+            } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                char path[PATH_MAX];
+                if (nodes[parent].path[0]) {
+                    snprintf(path, sizeof(path), "%s/%s", nodes[parent].path, ev->name);
+                } else {
+                    snprintf(path, sizeof(path), "%s", ev->name);
+                }
+                remove_group(path);
+            }
+        }
+    }
+}
+
+// Forgets the tree (new cgroup root)
+static void reset_groups(void) {
+    for (int i = 0; i < node_count; i++) free(nodes[i].path);
+    node_count = 0;
+    for (int i = 0; i < wd_cap; i++) wd_nodes[i] = -1;
+    if (path_index) path_index_rebuild(0);
+    if (inotify_fd >= 0) close(inotify_fd);
+    if (cgroup_root_fd >= 0) close(cgroup_root_fd);
+    inotify_fd = cgroup_root_fd = -1;
+}
+
+// Opens the cgroup root and the inotify descriptor, again whenever the
+// sysfs root changed
+static int cgroup_init(void) {
+    if (cgroup_root_fd >= 0 && cgroup_root_generation == sysmon_root_generation()) return 0;
+
+    reset_groups();
+    cgroup_root_generation = sysmon_root_generation();
+
+    // Only a v2 root has cgroup.controllers; v1 controller mounts do not
+    for (size_t i = 0; i < sizeof(cgroup_mounts) / sizeof(cgroup_mounts[0]); i++) {
+        int fd = sysmon_open(cgroup_mounts[i], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) continue;
+        selfstat_io(1, 0);
+        if (faccessat(fd, "cgroup.controllers", F_OK, 0) == 0) {
+            cgroup_root_fd = fd;
+            cgroup_mount = cgroup_mounts[i];
+            break;
+        }
+        close(fd);
+    }
+    if (cgroup_root_fd < 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) return -1;
+
+    need_walk = 1;
+    return 0;
+}
+
+// Sums "<key>=<n>" over the lines of io.stat
+static unsigned long sum_io_field(const char *buf, const char *key) {
+    unsigned long total = 0, value;
+    size_t len = strlen(key);
+
+    for (const char *p = buf; (p = strstr(p, key)) != NULL; p += len) {
+        if ((p == buf || p[-1] == ' ') && scan_ulong(p + len, &value)) total += value;
+    }
+    return total;
+}
+
+// Counter delta per second; a counter that went back (group recreated
+// between two samples) counts from zero
+static double counter_rate(unsigned long current, unsigned long previous, double elapsed) {
+    return (double)(current >= previous ? current - previous : current) / elapsed;
+}
+
+// Reads the counters every group needs for the ranking
+static void sample_group(cgroup_node_t *node, double elapsed) {
+    char buf[1024];
+    unsigned long usage = 0, throttled = 0, memory;
+    int have_throttled = 0;
+    cgroup_info_t *info = &node->info;
+
+    info->cpu_percent = 0.0;
+    info->throttled_percent = -1.0;
+    info->memory_bytes = -1;
+    info->read_bytes_per_sec = 0.0;
+    info->write_bytes_per_sec = 0.0;
+
+    if (read_group_file(node, "cpu.stat", buf, sizeof(buf)) >= 0) {
+        scan_key(buf, "usage_usec", 10, &usage);
+        have_throttled = scan_key(buf, "throttled_usec", 14, &throttled) == 0;
+    }
+    if (read_group_file(node, "memory.current", buf, sizeof(buf)) >= 0 && scan_ulong(buf, &memory)) {
+        info->memory_bytes = (int64_t)memory;
+    }
+    unsigned long read_bytes = 0, write_bytes = 0;
+    if (read_group_file(node, "io.stat", buf, sizeof(buf)) >= 0) {
+        read_bytes = sum_io_field(buf, "rbytes=");
+        write_bytes = sum_io_field(buf, "wbytes=");
+    }
+
+    if (node->has_prev && elapsed > 0) {
+        info->cpu_percent = counter_rate(usage, node->usage_usec, elapsed) / 1e4;
+        if (have_throttled) {
+            info->throttled_percent = counter_rate(throttled, node->throttled_usec, elapsed) / 1e4;
+        }
+        info->read_bytes_per_sec = counter_rate(read_bytes, node->read_bytes, elapsed);
+        info->write_bytes_per_sec = counter_rate(write_bytes, node->write_bytes, elapsed);
+    } else if (have_throttled) {
+        info->throttled_percent = 0.0;
+    }
+    node->usage_usec = usage;
+    node->throttled_usec = throttled;
+    node->read_bytes = read_bytes;
+    node->write_bytes = write_bytes;
+    node->has_prev = 1;
+}
+
+// "some avg10=" of a pressure file, or -1
+static double read_pressure(const cgroup_node_t *node, const char *file) {
+    char buf[256];
+
+    if (read_group_file(node, file, buf, sizeof(buf)) < 0) return -1.0;
+    const char *p = strstr(buf, "some avg10=");
+    return p ? strtod(p + 11, NULL) : -1.0;
+}
+
+// Reads the files only shown for the groups in the tree
+static void sample_details(cgroup_node_t *node) {
+    char buf[4096];
+    unsigned long value;
+    cgroup_info_t *info = &node->info;
+
+    info->anon_bytes = info->file_bytes = -1;
+    if (read_group_file(node, "memory.stat", buf, sizeof(buf)) >= 0) {
+        if (scan_key(buf, "anon ", 5, &value) == 0) info->anon_bytes = (int64_t)value;
+        if (scan_key(buf, "file ", 5, &value) == 0) info->file_bytes = (int64_t)value;
+    }
+    info->cpu_pressure = read_pressure(node, "cpu.pressure");
+    info->memory_pressure = read_pressure(node, "memory.pressure");
+    info->io_pressure = read_pressure(node, "io.pressure");
+}
+
+// Busiest first: CPU, then memory, then ancestors before descendants
+static int rank_compare(const void *a, const void *b) {
+    const cgroup_node_t *x = &nodes[*(const int *)a];
+    const cgroup_node_t *y = &nodes[*(const int *)b];
+
+    if (x->info.cpu_percent != y->info.cpu_percent) {
+        return x->info.cpu_percent > y->info.cpu_percent ? -1 : 1;
+    }
+    if (x->info.memory_bytes != y->info.memory_bytes) {
+        return x->info.memory_bytes > y->info.memory_bytes ? -1 : 1;
+    }
+    return x->depth - y->depth;
+}
+
+// Selects a node and its unselected ancestors if they all fit in the rows
+static int select_group(int index, int count) {
+    int needed = 0;
+
+    for (int i = index; i > 0 && !nodes[i].selected; i = nodes[i].parent) needed++;
+    if (count + needed > MAX_CGROUP_ROWS) return count;
+
+    for (int i = index; i > 0 && !nodes[i].selected; i = nodes[i].parent) nodes[i].selected = 1;
+    return count + needed;
+}
+
+// Appends the selected subtree below a node to the rows in preorder
+static int emit_rows(int index, int count) {
+    for (int child = nodes[index].first_child; child >= 0; child = nodes[child].next_sibling) {
+        cgroup_node_t *node = &nodes[child];
+        sample_details(node);
+
+        cgroup_info_t *row = &rows[count++];
+        *row = node->info;
+        size_t len = strnlen(node->path, sizeof(row->path) - 1);
+        memcpy(row->path, node->path, len);
+        row->path[len] = '\0';
+        row->depth = node->depth;
+
+        count = emit_rows(child, count);
+    }
+    return count;
+}
+
+int read_cgroup_info(cgroup_tree_t *tree) {
+    struct timespec now;
+
+    memset(tree, 0, sizeof(cgroup_tree_t));
+
+    if (cgroup_init() != 0) {
+        perror("Error opening the cgroup v2 hierarchy");
+        return -1;
+    }
+    drain_inotify();
+    if (need_walk) walk_hierarchy();
+    if (node_count == 0) return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec + now.tv_nsec / 1e9;
+    double elapsed = time - sample_time;
+    sample_time = time;
+
+    // The root's own files describe the whole machine, not a group
+    int *grown = grow_array(ranked, &ranked_cap, node_count, sizeof(int));
+    if (!grown) return -1;
+    ranked = grown;
+    int candidates = 0;
+    for (int i = 1; i < node_count; i++) {
+        sample_group(&nodes[i], elapsed);
+        nodes[i].selected = 0;
+        nodes[i].first_child = nodes[i].last_child = nodes[i].next_sibling = -1;
+        ranked[candidates++] = i;
+    }
+    nodes[0].selected = 1;
+    nodes[0].first_child = nodes[0].last_child = -1;
+    qsort(ranked, (size_t)candidates, sizeof(int), rank_compare);
+
+    int selected = 0;
+    for (int i = 0; i < candidates && selected < MAX_CGROUP_ROWS; i++) {
+        selected = select_group(ranked[i], selected);
+    }
+
+    // Link the selected groups to their parents in rank order
+    for (int i = 0; i < candidates; i++) {
+        int index = ranked[i];
+        if (!nodes[index].selected) continue;
+
+        cgroup_node_t *parent = &nodes[nodes[index].parent];
+        if (parent->last_child >= 0) {
+            nodes[parent->last_child].next_sibling = index;
+        } else {
+            parent->first_child = index;
+        }
+        parent->last_child = index;
+    }
+
+    tree->count = emit_rows(0, 0);
+    tree->groups = rows;
+    tree->tracked = node_count - 1;
+    return 0;
+}
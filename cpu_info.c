@@ -1,138 +1,249 @@
 #include "sysmon.h"
 
-// Static variables to track previous CPU stats for usage calculation
-static unsigned long prev_total[MAX_CPU_CORES] = {0};
-static unsigned long prev_idle[MAX_CPU_CORES] = {0};
+// Per-core counters, sized at startup from the configured CPU count and grown
+// if /proc/stat ever lists a higher CPU number (hotplug). Counters are kept
+// as structure-of-arrays so one vectorized kernel handles every core.
+typedef struct {
+    int capacity;                       // Cores the arrays have room for
+    cpu_counters_t cur;                 // Ticks at this sample
+    cpu_counters_t prev;                // Ticks at the previous sample
+    cpu_usage_t usage;                  // Percentages handed out in cpu_info_t
+    unsigned char *online;              // Core listed in this sample
+    unsigned char *has_prev;            // prev holds a sample for this core
+} core_state_t;
+
+static core_state_t core_state;
+
+// The aggregate "cpu" line goes through the same kernel as a single core
+static cpu_counters_t total_cur, total_prev;
+static cpu_usage_t total_usage;
+static cpu_kernel_fn cpu_kernel = NULL;
 static int first_run = 1;
 
-int read_cpu_info(cpu_info_t *cpu) {
-    FILE *fp;
-    char line[MAX_LINE_LEN];
-    int core_count = 0;
+// Persistent handle for the file sampled on every refresh
+static proc_file_t stat_file = PROC_FILE_INIT("/proc/stat");
 
-    memset(cpu, 0, sizeof(cpu_info_t));
+// The model name never changes: /proc/cpuinfo (slow to generate, it asks
+// every core for its clock) is read once per proc root
+static char cpu_model[128];
+static int cpu_model_loaded = 0;
+static unsigned int cpu_model_generation = 0;
 
-    // Read CPU model and core count from /proc/cpuinfo
-    fp = fopen("/proc/cpuinfo", "r");
-    if (!fp) {
-        perror("Error opening /proc/cpuinfo");
+// Grows a byte array, zeroing the new tail
+static int grow_flags(unsigned char **flags, int old_count, int count) {
+    unsigned char *bigger = realloc(*flags, (size_t)count);
+    if (!bigger) return -1;
+
+    memset(bigger + old_count, 0, (size_t)(count - old_count));
+    *flags = bigger;
+    return 0;
+}
+
+// Makes room for at least the given number of cores
+static int core_state_reserve(int count) {
+    core_state_t *cs = &core_state;
+    if (count <= cs->capacity) return 0;
+
+    int old = cs->capacity;
+    if (old == 0) {
+        cpu_kernel = cpu_kernel_best();
+        if (cpu_counters_resize(&total_cur, 0, 1) != 0 ||
+            cpu_counters_resize(&total_prev, 0, 1) != 0 ||
+            cpu_usage_resize(&total_usage, 0, 1) != 0) {
+            return -1;
+        }
+    }
+    if (cpu_counters_resize(&cs->cur, old, count) != 0 ||
+        cpu_counters_resize(&cs->prev, old, count) != 0 ||
+        cpu_usage_resize(&cs->usage, old, count) != 0 ||
+        grow_flags(&cs->online, old, count) != 0 ||
+        grow_flags(&cs->has_prev, old, count) != 0) {
+        return -1;
+    }
+    cs->capacity = count;
+    return 0;
+}
+
+// Highest cpuN directory number + 1 under /sys/devices/system/cpu, or -1
+// if the directory cannot be read. This is the configured count glibc
+// reports for _SC_NPROCESSORS_CONF, taken from the sysfs root in use; unlike
+// the "possible" mask it leaves out hotplug slots with no CPU behind them.
+static int cpu_configured_count(void) {
+    char path[PATH_MAX];
+    struct dirent *entry;
+    int last = -1;
+
+    DIR *dir = opendir(sysmon_path("/sys/devices/system/cpu", path, sizeof(path)));
+    selfstat_io(1, 0);
+    if (!dir) return -1;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned long value;
+        const char *end;
+        // cpu0, cpu1, ...; not cpufreq or cpuidle
+        if (strncmp(entry->d_name, "cpu", 3) != 0 || !isdigit((unsigned char)entry->d_name[3])) {
+            continue;
+        }
+        end = scan_ulong(entry->d_name + 3, &value);
+        if (end && *end == '\0' && (long)value > last) last = (int)value;
+    }
+    closedir(dir);
+    selfstat_io(1, 0);
+    return last >= 0 ? last + 1 : -1;
+}
+
+// Number of CPU cores tracked: the configured count, or more after hotplug
+int cpu_core_count(void) {
+    if (core_state.capacity == 0) {
+        long configured = cpu_configured_count();
+        if (configured < 1) configured = sysconf(_SC_NPROCESSORS_CONF);
+        if (configured < 1) configured = 1;
+        core_state_reserve((int)configured);
+    }
+    return core_state.capacity;
+}
+
+// Parses the eight counters of a "cpu" line into slot index of counters
+static const char *parse_cpu_counters(const char *p, cpu_counters_t *counters, int index) {
+    for (int f = 0; f < CPU_FIELDS; f++) {
+        unsigned long value;
+        p = scan_ulong(p, &value);
+        if (!p) return NULL;
+        counters->field[f][index] = value;
+    }
+    return p;
+}
+
+static void swap_counters(cpu_counters_t *a, cpu_counters_t *b) {
+    cpu_counters_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+// Reads the model name from /proc/cpuinfo unless it is already known
+static int load_cpu_model(void) {
+    if (cpu_model_loaded && cpu_model_generation == sysmon_root_generation()) return 0;
+
+    proc_file_t cpuinfo = PROC_FILE_INIT("/proc/cpuinfo");
+    if (proc_file_read(&cpuinfo) < 0) {
+        proc_file_close(&cpuinfo);
         return -1;
     }
 
-    while (fgets(line, sizeof(line), fp)) {
+    cpu_model[0] = '\0';
+    for (const char *line = cpuinfo.buf; *line; line = scan_next_line(line)) {
         // Extract CPU model name (only first occurrence)
-        if (strncmp(line, "model name", 10) == 0 && strlen(cpu->model) == 0) {
-            char *colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) == 0) {
+            const char *colon = strchr(line, ':');
             if (colon) {
-                colon += 2;  // Skip ": "
-                char *newline = strchr(colon, '\n');
-                if (newline) *newline = '\0';
-                strncpy(cpu->model, colon, sizeof(cpu->model) - 1);
-                cpu->model[sizeof(cpu->model) - 1] = '\0';
+                colon = scan_skip_spaces(colon + 1);
+                size_t len = strcspn(colon, "\n");
+                if (len >= sizeof(cpu_model)) len = sizeof(cpu_model) - 1;
+                memcpy(cpu_model, colon, len);
+                cpu_model[len] = '\0';
             }
-        }
-        // Count processor cores
-        if (strncmp(line, "processor", 9) == 0) {
-            core_count++;
+            break;
         }
     }
-    fclose(fp);
+    proc_file_close(&cpuinfo);
 
-    cpu->cores = core_count;
+    cpu_model_loaded = 1;
+    cpu_model_generation = sysmon_root_generation();
+    return 0;
+}
+
+int read_cpu_info(cpu_info_t *cpu) {
+    const char *line;
+
+    memset(cpu, 0, sizeof(cpu_info_t));
+
+    if (load_cpu_model() != 0) {
+        perror("Error reading /proc/cpuinfo");
+        return -1;
+    }
+    memcpy(cpu->model, cpu_model, sizeof(cpu->model));
 
     // Read CPU usage statistics from /proc/stat
-    fp = fopen("/proc/stat", "r");
-    if (!fp) {
-        perror("Error opening /proc/stat");
+    if (cpu_core_count() == 0 || proc_file_read(&stat_file) < 0) {
+        perror("Error reading /proc/stat");
         return -1;
     }
 
-    int core_idx = 0;
-
-    // Parse CPU usage statistics for each core
-    while (fgets(line, sizeof(line), fp) && core_idx <= core_count) {
-        if (strncmp(line, "cpu", 3) == 0) {
-            unsigned long user, nice, system, idle, iowait, irq, softirq, steal;
-
-            // Overall CPU stats (line starts with "cpu ")
-            if (line[3] == ' ') {
-                sscanf(line, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
-                       &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-
-                unsigned long total = user + nice + system + idle + iowait + irq + softirq + steal;
-
-                // Calculate usage percentage (skip first run for accurate diff)
-                if (!first_run) {
-                    unsigned long total_diff = total - prev_total[0];
-                    unsigned long idle_diff = idle - prev_idle[0];
-
-                    if (total_diff > 0) {
-                        cpu->total_usage = 100.0 * (total_diff - idle_diff) / total_diff;
-                    }
-                }
-
-                // Store current values for next calculation
-                prev_total[0] = total;
-                prev_idle[0] = idle;
-
-            // Individual CPU core stats (line starts with "cpu0", "cpu1", etc.)
-            } else if (line[3] >= '0' && line[3] <= '9') {
-                int cpu_num;
-                sscanf(line, "cpu%d %lu %lu %lu %lu %lu %lu %lu %lu",
-                       &cpu_num, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-
-                if (cpu_num < MAX_CPU_CORES) {
-                    unsigned long total = user + nice + system + idle + iowait + irq + softirq + steal;
-
-                    // Calculate per-core usage percentage
-                    if (!first_run) {
-                        unsigned long total_diff = total - prev_total[cpu_num + 1];
-                        unsigned long idle_diff = idle - prev_idle[cpu_num + 1];
-
-                        if (total_diff > 0) {
-                            cpu->usage[cpu_num] = 100.0 * (total_diff - idle_diff) / total_diff;
-                        }
-                    }
-
-                    // Store current values for next calculation
-                    prev_total[cpu_num + 1] = total;
-                    prev_idle[cpu_num + 1] = idle;
-                }
+    memset(core_state.online, 0, (size_t)core_state.capacity);
+    int have_total = 0;
+
+    // The "cpu" lines come first in /proc/stat, stop at the first other line.
+    // Offline cores have no line at all.
+    for (line = stat_file.buf; strncmp(line, "cpu", 3) == 0; line = scan_next_line(line)) {
+        // Overall CPU stats (line starts with "cpu ")
+        if (line[3] == ' ') {
+            have_total = parse_cpu_counters(line + 3, &total_cur, 0) != NULL;
+
+        // Individual CPU core stats (line starts with "cpu0", "cpu1", etc.)
+        } else {
+            unsigned long cpu_num;
+            const char *p = scan_ulong(line + 3, &cpu_num);
+            if (!p) continue;
+
+            // A core beyond the configured count appeared, grow the arrays
+            if ((int)cpu_num >= core_state.capacity &&
+                core_state_reserve((int)cpu_num + 1) != 0) {
+                continue;
+            }
+
+            if (parse_cpu_counters(p, &core_state.cur, (int)cpu_num)) {
+                core_state.online[cpu_num] = 1;
             }
         }
-        core_idx++;
     }
-    fclose(fp);
-
-    // Try to read CPU temperature from thermal sensors
-    fp = fopen("/sys/class/thermal/thermal_zone0/temp", "r");
-    if (fp) {
-        int temp_millidegrees;
-        if (fscanf(fp, "%d", &temp_millidegrees) == 1) {
-            cpu->temperature = temp_millidegrees / 1000.0;  // Convert to Celsius
-        }
-        fclose(fp);
-    } else {
-        // Try alternative thermal sensor path
-        fp = fopen("/sys/devices/platform/coretemp.0/hwmon/hwmon0/temp1_input", "r");
-        if (fp) {
-            int temp_millidegrees;
-            if (fscanf(fp, "%d", &temp_millidegrees) == 1) {
-                cpu->temperature = temp_millidegrees / 1000.0;  // Convert to Celsius
-            }
-            fclose(fp);
+
+    // Overall usage and breakdown (skip first run for accurate diff)
+    if (have_total) {
+        if (!first_run) {
+            cpu_kernel(&total_cur, &total_prev, &total_usage, 1);
+            cpu->total_usage = total_usage.usage[0];
+            cpu->iowait_percent = total_usage.iowait[0];
+            cpu->steal_percent = total_usage.steal[0];
+            cpu->irq_percent = total_usage.irq[0];
         }
+        swap_counters(&total_cur, &total_prev);
     }
 
-    // On first run, initialize values and return (no usage calculation yet)
-    if (first_run) {
-        first_run = 0;
-        cpu->total_usage = 0.0;
-        for (int i = 0; i < cpu->cores; i++) {
-            cpu->usage[i] = 0.0;
+    int count = core_state.capacity;
+    cpu_kernel(&core_state.cur, &core_state.prev, &core_state.usage, count);
+
+    // Offline cores report -1, cores without a previous sample report 0
+    for (int i = 0; i < count; i++) {
+        if (!core_state.online[i]) {
+            core_state.usage.usage[i] = -1.0;
+            core_state.usage.iowait[i] = -1.0;
+            core_state.usage.steal[i] = -1.0;
+            core_state.usage.irq[i] = -1.0;
+            core_state.has_prev[i] = 0;
+            continue;
+        }
+        if (!core_state.has_prev[i]) {
+            core_state.usage.usage[i] = 0.0;
+            core_state.usage.iowait[i] = 0.0;
+            core_state.usage.steal[i] = 0.0;
+            core_state.usage.irq[i] = 0.0;
         }
-        return 0;
+        core_state.has_prev[i] = 1;
+        cpu->online++;
     }
 
+    // This sample becomes the previous one; offline slots are rewritten
+    // before they are used again
+    swap_counters(&core_state.cur, &core_state.prev);
+
+    cpu->cores = count;
+    cpu->usage = core_state.usage.usage;
+    cpu->iowait = core_state.usage.iowait;
+    cpu->steal = core_state.usage.steal;
+    cpu->irq = core_state.usage.irq;
+
+    // Hottest package of the sensors discovered by sensor_info.c
+    cpu->temperature = read_cpu_temperature();
+
+    first_run = 0;
     return 0;
-}
\ No newline at end of file
+}
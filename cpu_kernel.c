@@ -0,0 +1,231 @@
+#include "sysmon.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CPU_KERNEL_X86 1
+#endif
+
+// Per-core delta and utilization kernels over structure-of-arrays counters.
+//
+// For every core i the kernels compute the tick deltas of all eight fields
+// since the previous sample and, from their sum dt:
+//   usage  = 100 * (dt - idle) / dt
+//   iowait = 100 * iowait / dt
+//   steal  = 100 * steal / dt
+//   irq    = 100 * (irq + softirq) / dt
+// A core with dt == 0 gets 0 everywhere and results are clamped to 0..100,
+// so counters that went backwards never produce garbage.
+
+// Allocates a zeroed, cache-line aligned array
+static void *aligned_array(size_t count, size_t size) {
+    void *ptr = NULL;
+    size_t bytes = (count * size + 63) & ~(size_t)63;
+
+    if (bytes == 0) bytes = 64;
+    if (posix_memalign(&ptr, 64, bytes) != 0) return NULL;
+    memset(ptr, 0, bytes);
+    return ptr;
+}
+
+// Moves an array into a larger aligned one, keeping its contents
+static int grow_aligned(void **array, int old_count, int new_count, size_t size) {
+    void *bigger = aligned_array((size_t)new_count, size);
+    if (!bigger) return -1;
+
+    if (*array) memcpy(bigger, *array, (size_t)old_count * size);
+    free(*array);
+    *array = bigger;
+    return 0;
+}
+
+// Grows every field array from old_count to count cores
+int cpu_counters_resize(cpu_counters_t *counters, int old_count, int count) {
+    for (int f = 0; f < CPU_FIELDS; f++) {
+        if (grow_aligned((void **)&counters->field[f], old_count, count, sizeof(uint64_t)) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void cpu_counters_free(cpu_counters_t *counters) {
+    for (int f = 0; f < CPU_FIELDS; f++) {
+        free(counters->field[f]);
+        counters->field[f] = NULL;
+    }
+}
+
+// Grows every percentage array from old_count to count cores
+int cpu_usage_resize(cpu_usage_t *usage, int old_count, int count) {
+    if (grow_aligned((void **)&usage->usage, old_count, count, sizeof(double)) != 0 ||
+        grow_aligned((void **)&usage->iowait, old_count, count, sizeof(double)) != 0 ||
+        grow_aligned((void **)&usage->steal, old_count, count, sizeof(double)) != 0 ||
+        grow_aligned((void **)&usage->irq, old_count, count, sizeof(double)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void cpu_usage_free(cpu_usage_t *usage) {
+    free(usage->usage);
+    free(usage->iowait);
+    free(usage->steal);
+    free(usage->irq);
+    memset(usage, 0, sizeof(cpu_usage_t));
+}
+
+static double clamp_percent(double value) {
+    if (value < 0.0) return 0.0;
+    if (value > 100.0) return 100.0;
+    return value;
+}
+
+// Scalar kernel for cores first..count-1; also finishes the SIMD tails
+static void kernel_scalar_range(const cpu_counters_t *cur, const cpu_counters_t *prev,
+                                const cpu_usage_t *out, int first, int count) {
+    for (int i = first; i < count; i++) {
+        uint64_t delta[CPU_FIELDS];
+        uint64_t dt = 0;
+
+        for (int f = 0; f < CPU_FIELDS; f++) {
+            delta[f] = cur->field[f][i] - prev->field[f][i];
+            dt += delta[f];
+        }
+
+        double scale = dt > 0 ? 100.0 / (double)dt : 0.0;
+        out->usage[i] = clamp_percent((double)(dt - delta[CPU_IDLE]) * scale);
+        out->iowait[i] = clamp_percent((double)delta[CPU_IOWAIT] * scale);
+        out->steal[i] = clamp_percent((double)delta[CPU_STEAL] * scale);
+        out->irq[i] = clamp_percent((double)(delta[CPU_IRQ] + delta[CPU_SOFTIRQ]) * scale);
+    }
+}
+
+static void kernel_scalar(const cpu_counters_t *cur, const cpu_counters_t *prev,
+                          const cpu_usage_t *out, int count) {
+    kernel_scalar_range(cur, prev, out, 0, count);
+}
+
+#ifdef CPU_KERNEL_X86
+
+// Tick deltas are far below 2^52, so a 64-bit integer converts to double by
+// placing it in the mantissa of 2^52 and subtracting 2^52 (no AVX-512 needed)
+#define EXP52 0x4330000000000000ull
+
+static inline __m128d u64_to_pd_sse2(__m128i v) {
+    const __m128i bits = _mm_set1_epi64x((long long)EXP52);
+    return _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(v, bits)), _mm_castsi128_pd(bits));
+}
+
+static inline __m128d clamp_pd_sse2(__m128d v) {
+    return _mm_min_pd(_mm_max_pd(v, _mm_setzero_pd()), _mm_set1_pd(100.0));
+}
+
+// Two cores per iteration
+static void kernel_sse2(const cpu_counters_t *cur, const cpu_counters_t *prev,
+                        const cpu_usage_t *out, int count) {
+    const __m128d hundred = _mm_set1_pd(100.0);
+    int i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128i delta[CPU_FIELDS];
+        __m128i dt = _mm_setzero_si128();
+
+        for (int f = 0; f < CPU_FIELDS; f++) {
+            __m128i c = _mm_loadu_si128((const __m128i *)&cur->field[f][i]);
+            __m128i p = _mm_loadu_si128((const __m128i *)&prev->field[f][i]);
+            delta[f] = _mm_sub_epi64(c, p);
+            dt = _mm_add_epi64(dt, delta[f]);
+        }
+
+        __m128d total = u64_to_pd_sse2(dt);
+        __m128d nonzero = _mm_cmpneq_pd(total, _mm_setzero_pd());
+        __m128d scale = _mm_and_pd(_mm_div_pd(hundred, total), nonzero);
+
+        __m128d busy = _mm_sub_pd(total, u64_to_pd_sse2(delta[CPU_IDLE]));
+        __m128d irq = u64_to_pd_sse2(_mm_add_epi64(delta[CPU_IRQ], delta[CPU_SOFTIRQ]));
+
+        _mm_storeu_pd(&out->usage[i], clamp_pd_sse2(_mm_mul_pd(busy, scale)));
+        _mm_storeu_pd(&out->iowait[i], clamp_pd_sse2(_mm_mul_pd(u64_to_pd_sse2(delta[CPU_IOWAIT]), scale)));
+        _mm_storeu_pd(&out->steal[i], clamp_pd_sse2(_mm_mul_pd(u64_to_pd_sse2(delta[CPU_STEAL]), scale)));
+        _mm_storeu_pd(&out->irq[i], clamp_pd_sse2(_mm_mul_pd(irq, scale)));
+    }
+
+    kernel_scalar_range(cur, prev, out, i, count);
+}
+
+__attribute__((target("avx2")))
+static inline __m256d u64_to_pd_avx2(__m256i v) {
+    const __m256i bits = _mm256_set1_epi64x((long long)EXP52);
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(v, bits)), _mm256_castsi256_pd(bits));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d clamp_pd_avx2(__m256d v) {
+    return _mm256_min_pd(_mm256_max_pd(v, _mm256_setzero_pd()), _mm256_set1_pd(100.0));
+}
+
+// Four cores per iteration
+__attribute__((target("avx2")))
+static void kernel_avx2(const cpu_counters_t *cur, const cpu_counters_t *prev,
+                        const cpu_usage_t *out, int count) {
+    const __m256d hundred = _mm256_set1_pd(100.0);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i delta[CPU_FIELDS];
+        __m256i dt = _mm256_setzero_si256();
+
+        for (int f = 0; f < CPU_FIELDS; f++) {
+            __m256i c = _mm256_loadu_si256((const __m256i *)&cur->field[f][i]);
+            __m256i p = _mm256_loadu_si256((const __m256i *)&prev->field[f][i]);
+            delta[f] = _mm256_sub_epi64(c, p);
+            dt = _mm256_add_epi64(dt, delta[f]);
+        }
+
+        __m256d total = u64_to_pd_avx2(dt);
+        __m256d nonzero = _mm256_cmp_pd(total, _mm256_setzero_pd(), _CMP_NEQ_OQ);
+        __m256d scale = _mm256_and_pd(_mm256_div_pd(hundred, total), nonzero);
+
+        __m256d busy = _mm256_sub_pd(total, u64_to_pd_avx2(delta[CPU_IDLE]));
+        __m256d irq = u64_to_pd_avx2(_mm256_add_epi64(delta[CPU_IRQ], delta[CPU_SOFTIRQ]));
+
+        _mm256_storeu_pd(&out->usage[i], clamp_pd_avx2(_mm256_mul_pd(busy, scale)));
+        _mm256_storeu_pd(&out->iowait[i], clamp_pd_avx2(_mm256_mul_pd(u64_to_pd_avx2(delta[CPU_IOWAIT]), scale)));
+        _mm256_storeu_pd(&out->steal[i], clamp_pd_avx2(_mm256_mul_pd(u64_to_pd_avx2(delta[CPU_STEAL]), scale)));
+        _mm256_storeu_pd(&out->irq[i], clamp_pd_avx2(_mm256_mul_pd(irq, scale)));
+    }
+
+    kernel_scalar_range(cur, prev, out, i, count);
+}
+
+#endif
+
+// Kernels usable on this machine, slowest first
+static cpu_kernel_t kernels[3];
+static int kernel_count = 0;
+
+static void cpu_kernel_detect(void) {
+    if (kernel_count > 0) return;
+
+    kernels[kernel_count++] = (cpu_kernel_t){"scalar", kernel_scalar};
+#ifdef CPU_KERNEL_X86
+    kernels[kernel_count++] = (cpu_kernel_t){"sse2", kernel_sse2};   // x86-64 baseline
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels[kernel_count++] = (cpu_kernel_t){"avx2", kernel_avx2};
+    }
+#endif
+}
+
+// Lists the kernels supported by the running CPU, best last
+const cpu_kernel_t *cpu_kernel_list(int *count) {
+    cpu_kernel_detect();
+    *count = kernel_count;
+    return kernels;
+}
+
+// Best kernel for the running CPU, chosen once at runtime
+cpu_kernel_fn cpu_kernel_best(void) {
+    cpu_kernel_detect();
+    return kernels[kernel_count - 1].fn;
+}
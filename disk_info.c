@@ -0,0 +1,373 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <poll.h>
+#include <sys/sysmacros.h>
+
+// Disk collector: capacity of every real mount and per-device I/O rates.
+//
+// The mount list comes from /proc/self/mountinfo and is cached. The kernel
+// flags a descriptor open on mountinfo with POLLPRI (and POLLERR) whenever
+// the mount table of the namespace changes, so each sample costs one poll()
+// plus a statvfs() per mount, and the table is only parsed again after a
+// mount or unmount. I/O rates are deltas of the /proc/diskstats counters
+// over the time between two samples.
+
+// Pseudo and virtual filesystems that never hold user data
+static const char *pseudo_fstypes[] = {
+    "autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs", "debugfs",
+    "devpts", "devtmpfs", "efivarfs", "fuse.gvfsd-fuse", "fuse.lxcfs",
+    "fuse.portal", "fusectl", "hugetlbfs", "mqueue", "nsfs", "proc", "pstore",
+    "ramfs", "rpc_pipefs", "securityfs", "selinuxfs", "squashfs", "sysfs",
+    "tmpfs", "tracefs",
+};
+
+// Cached mount table; paths are kept in full for statvfs()
+typedef struct {
+    char *path;                         // Unescaped mount point
+    dev_t dev;                          // major:minor of the filesystem
+    mount_info_t info;                  // Names; capacity is filled per sample
+} mount_entry_t;
+
+static proc_file_t mountinfo_file = PROC_FILE_INIT("/proc/self/mountinfo");
+static mount_entry_t *mount_entries = NULL;
+static int mount_count = 0;
+static int mount_cap = 0;
+static int mounts_loaded = 0;
+static mount_info_t *mounts = NULL;     // Handed out in disk_info_t
+static int mounts_cap = 0;
+static int mounts_usable = 0;           // Entries of mounts filled by the last statvfs pass
+static int mounts_root = -1;            // Index of "/" in mounts, or -1
+
+// /proc/diskstats counters used per device, in file order after the name
+enum {
+    DS_READS,                           // Reads completed
+    DS_READS_MERGED,
+    DS_READ_SECTORS,
+    DS_READ_MS,                         // Time spent reading
+    DS_WRITES,                          // Writes completed
+    DS_WRITES_MERGED,
+    DS_WRITE_SECTORS,
+    DS_WRITE_MS,                        // Time spent writing
+    DS_IN_FLIGHT,                       // Requests currently in flight
+    DS_IO_MS,                           // Time the device was busy
+    DS_WEIGHTED_MS,                     // Busy time weighted by requests in flight
+    DS_FIELDS
+};
+
+// diskstats sectors are always 512 bytes, whatever the device block size
+#define DISKSTAT_SECTOR_SIZE 512
+
+typedef struct {
+    dev_t dev;
+    int skip;                           // Partition, loop or RAM disk
+    int has_prev;                       // prev holds the counters of the last sample
+    int seen;                           // Listed in the current sample
+    unsigned long prev[DS_FIELDS];
+    disk_io_t io;
+} device_state_t;
+
+static proc_file_t diskstats_file = PROC_FILE_INIT("/proc/diskstats");
+static device_state_t *device_states = NULL;
+static int device_state_count = 0;
+static int device_state_cap = 0;
+static disk_io_t *devices = NULL;       // Handed out in disk_info_t
+static int device_cap = 0;
+static double diskstats_time = 0.0;     // CLOCK_MONOTONIC time of the last sample
+
+static int is_pseudo_fstype(const char *fstype, size_t len) {
+    for (size_t i = 0; i < sizeof(pseudo_fstypes) / sizeof(pseudo_fstypes[0]); i++) {
+        if (strlen(pseudo_fstypes[i]) == len && memcmp(pseudo_fstypes[i], fstype, len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Returns the next space-separated field of a line and its length
+static const char *next_field(const char **p, size_t *len) {
+    const char *start = *p;
+
+    while (*start == ' ') start++;
+    const char *end = start;
+    while (*end && *end != ' ' && *end != '\n') end++;
+    *len = (size_t)(end - start);
+    *p = end;
+    return *len > 0 ? start : NULL;
+}
+
+// Copies a mountinfo field into dst, decoding the \ooo octal escapes the
+// kernel uses for spaces, tabs, newlines and backslashes
+static void unescape_field(char *dst, size_t size, const char *src, size_t len) {
+    size_t n = 0;
+
+    for (size_t i = 0; i < len && n + 1 < size; i++) {
+        if (src[i] == '\\' && i + 3 < len &&
+            src[i + 1] >= '0' && src[i + 1] <= '3' &&
+            src[i + 2] >= '0' && src[i + 2] <= '7' &&
+            src[i + 3] >= '0' && src[i + 3] <= '7') {
+            dst[n++] = (char)((src[i + 1] - '0') * 64 + (src[i + 2] - '0') * 8 + (src[i + 3] - '0'));
+            i += 3;
+        } else {
+            dst[n++] = src[i];
+        }
+    }
+    dst[n] = '\0';
+}
+
+static void free_mount_entries(void) {
+    for (int i = 0; i < mount_count; i++) free(mount_entries[i].path);
+    mount_count = 0;
+}
+
+// Rebuilds the mount table from mountinfo. Lines look like
+//   36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw
+// with any number of optional fields before the "-" separator.
+static int load_mounts(void) {
+    if (proc_file_read(&mountinfo_file) < 0) return -1;
+
+    free_mount_entries();
+
+    for (const char *line = mountinfo_file.buf; *line; line = scan_next_line(line)) {
+        const char *p = line, *field, *point = NULL, *fstype = NULL, *source = NULL;
+        size_t len, point_len = 0, fstype_len = 0, source_len = 0;
+        unsigned long dev_major = 0, dev_minor = 0;
+
+        // Mount ID, parent ID, major:minor, root, mount point
+        for (int f = 0; f < 5 && (field = next_field(&p, &len)) != NULL; f++) {
+            if (f == 2) {
+                const char *q = scan_ulong(field, &dev_major);
+                if (!q || *q != ':' || !scan_ulong(q + 1, &dev_minor)) break;
+            } else if (f == 4) {
+                point = field;
+                point_len = len;
+            }
+        }
+        if (!point) continue;
+
+        // Skip the mount options and optional fields up to "-"
+        while ((field = next_field(&p, &len)) != NULL && !(len == 1 && *field == '-')) {
+        }
+        if (!field) continue;
+
+        fstype = next_field(&p, &fstype_len);
+        source = next_field(&p, &source_len);
+        if (!fstype || is_pseudo_fstype(fstype, fstype_len)) continue;
+
+        // Bind mounts and repeated mounts report the same filesystem again
+        dev_t dev = makedev(dev_major, dev_minor);
+        int duplicate = 0;
+        for (int i = 0; i < mount_count && !duplicate; i++) {
+            duplicate = mount_entries[i].dev == dev;
+        }
+        if (duplicate) continue;
+
+        mount_entry_t *grown_entries = grow_array(mount_entries, &mount_cap, mount_count + 1,
+                                                  sizeof(mount_entry_t));
+        if (!grown_entries) return -1;
+        mount_entries = grown_entries;
+        mount_info_t *grown_mounts = grow_array(mounts, &mounts_cap, mount_count + 1,
+                                                sizeof(mount_info_t));
+        if (!grown_mounts) return -1;
+        mounts = grown_mounts;
+
+        mount_entry_t *entry = &mount_entries[mount_count];
+        mount_info_t *info = &entry->info;
+        entry->path = malloc(point_len + 1);
+        if (!entry->path) return -1;
+        unescape_field(entry->path, point_len + 1, point, point_len);
+        entry->dev = dev;
+
+        memset(info, 0, sizeof(mount_info_t));
+        snprintf(info->mount_point, sizeof(info->mount_point), "%s", entry->path);
+        unescape_field(info->device, sizeof(info->device), source ? source : "", source_len);
+        unescape_field(info->fstype, sizeof(info->fstype), fstype, fstype_len);
+        mount_count++;
+    }
+
+    mounts_loaded = 1;
+    return 0;
+}
+
+// True when the mount table has to be parsed again
+static int mounts_changed(void) {
+    if (!mounts_loaded || mountinfo_file.fd < 0 ||
+        mountinfo_file.generation != sysmon_root_generation()) {
+        return 1;
+    }
+
+    struct pollfd pfd = {mountinfo_file.fd, POLLPRI, 0};
+    selfstat_io(1, 0);
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR));
+}
+
+// Fills the public array with the capacity of every cached mount that can
+// be queried; root is set to the index of "/" (or -1)
+static int update_mounts(int *root) {
+    int usable = 0;
+
+    *root = -1;
+    for (int i = 0; i < mount_count; i++) {
+        struct statvfs st;
+
+        selfstat_io(1, 0);
+        if (statvfs(mount_entries[i].path, &st) != 0 || st.f_blocks == 0) continue;
+
+        if (strcmp(mount_entries[i].path, "/") == 0) *root = usable;
+        mount_info_t *info = &mounts[usable];
+        *info = mount_entries[i].info;
+        info->total_bytes = (uint64_t)st.f_blocks * st.f_frsize;
+        info->available_bytes = (uint64_t)st.f_bavail * st.f_frsize;
+        info->used_bytes = info->total_bytes - (uint64_t)st.f_bfree * st.f_frsize;
+        info->usage_percent = (double)info->used_bytes * 100.0 / (double)info->total_bytes;
+        usable++;
+    }
+    return usable;
+}
+
+// Whole disks only: partitions, loop devices and RAM disks are skipped
+static int device_skipped(const char *name, size_t len, dev_t dev) {
+    char path[96], buf[PATH_MAX];
+
+    if ((len >= 4 && memcmp(name, "loop", 4) == 0) || (len >= 3 && memcmp(name, "ram", 3) == 0)) {
+        return 1;
+    }
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/partition", major(dev), minor(dev));
+    selfstat_io(1, 0);
+    return access(sysmon_path(path, buf, sizeof(buf)), F_OK) == 0;
+}
+
+// Finds or adds the state of a device; hint is where it was last time
+static device_state_t *device_state(dev_t dev, int hint, const char *name, size_t len) {
+    if (hint < device_state_count && device_states[hint].dev == dev) return &device_states[hint];
+    for (int i = 0; i < device_state_count; i++) {
+        if (device_states[i].dev == dev) return &device_states[i];
+    }
+
+    device_state_t *grown = grow_array(device_states, &device_state_cap, device_state_count + 1,
+                                       sizeof(device_state_t));
+    if (!grown) return NULL;
+    device_states = grown;
+    device_state_t *ds = &device_states[device_state_count++];
+    memset(ds, 0, sizeof(device_state_t));
+    ds->dev = dev;
+    ds->skip = device_skipped(name, len, dev);
+    if (len >= sizeof(ds->io.name)) len = sizeof(ds->io.name) - 1;
+    memcpy(ds->io.name, name, len);
+    return ds;
+}
+
+// Turns the counter deltas of one device into rates over elapsed seconds
+static void device_rates(device_state_t *ds, const unsigned long *cur, double elapsed) {
+    unsigned long d[DS_FIELDS];
+
+    for (int f = 0; f < DS_FIELDS; f++) d[f] = cur[f] - ds->prev[f];
+    d[DS_IN_FLIGHT] = cur[DS_IN_FLIGHT];   // A gauge, not a counter
+
+    double ms = elapsed * 1000.0;
+    unsigned long ios = d[DS_READS] + d[DS_WRITES];
+
+    ds->io.read_iops = d[DS_READS] / elapsed;
+    ds->io.write_iops = d[DS_WRITES] / elapsed;
+    ds->io.read_bytes_per_sec = (double)d[DS_READ_SECTORS] * DISKSTAT_SECTOR_SIZE / elapsed;
+    ds->io.write_bytes_per_sec = (double)d[DS_WRITE_SECTORS] * DISKSTAT_SECTOR_SIZE / elapsed;
+    ds->io.queue_depth = d[DS_WEIGHTED_MS] / ms;
+    ds->io.await_ms = ios > 0 ? (double)(d[DS_READ_MS] + d[DS_WRITE_MS]) / ios : 0.0;
+    ds->io.util_percent = d[DS_IO_MS] * 100.0 / ms;
+    if (ds->io.util_percent > 100.0) ds->io.util_percent = 100.0;
+}
+
+// Samples /proc/diskstats; returns the number of devices with rates
+static int update_devices(void) {
+    struct timespec now;
+
+    if (proc_file_read(&diskstats_file) < 0) return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec + now.tv_nsec / 1e9;
+    double elapsed = time - diskstats_time;
+    diskstats_time = time;
+
+    for (int i = 0; i < device_state_count; i++) device_states[i].seen = 0;
+
+    int index = 0, count = 0;
+    for (const char *line = diskstats_file.buf; *line; line = scan_next_line(line), index++) {
+        const char *p = line, *name;
+        unsigned long dev_major, dev_minor, cur[DS_FIELDS];
+        size_t len;
+
+        if (!(p = scan_ulong(p, &dev_major)) || !(p = scan_ulong(p, &dev_minor)) ||
+            !(name = next_field(&p, &len))) {
+            continue;
+        }
+        int f;
+        for (f = 0; f < DS_FIELDS && (p = scan_ulong(p, &cur[f])) != NULL; f++) {
+        }
+        if (f < DS_FIELDS) continue;
+
+        device_state_t *ds = device_state(makedev(dev_major, dev_minor), index, name, len);
+        if (!ds || ds->skip) continue;
+        ds->seen = 1;
+
+        // Idle devices that never did any I/O are not worth a row
+        if (ds->has_prev && elapsed > 0 && cur[DS_READS] + cur[DS_WRITES] > 0) {
+            device_rates(ds, cur, elapsed);
+            disk_io_t *grown = grow_array(devices, &device_cap, count + 1, sizeof(disk_io_t));
+            if (!grown) return -1;
+            devices = grown;
+            devices[count++] = ds->io;
+        }
+        memcpy(ds->prev, cur, sizeof(ds->prev));
+        ds->has_prev = 1;
+    }
+
+    // Devices that disappeared start over if they come back
+    for (int i = 0; i < device_state_count; i++) {
+        if (!device_states[i].seen) device_states[i].has_prev = 0;
+    }
+    return count;
+}
+
+// Reads the I/O rates and, when capacity is set, queries every mount again;
+// otherwise the capacities of the last query are handed out. A changed mount
+// table is always queried.
+int read_disk_info(disk_info_t *disk, int capacity) {
+    memset(disk, 0, sizeof(disk_info_t));
+
+    if (mounts_changed()) {
+        if (load_mounts() != 0) {
+            perror("Error reading /proc/self/mountinfo");
+            return -1;
+        }
+        capacity = 1;
+    }
+    if (capacity) mounts_usable = update_mounts(&mounts_root);
+
+    int root_index = mounts_root;
+    disk->mounts = mounts;
+    disk->mount_count = mounts_usable;
+    disk->capacity_fresh = capacity;
+
+    // The root filesystem (or the first mount) fills the flat summary fields
+    // used by the CSV columns and the record header
+    if (root_index < 0 && disk->mount_count > 0) root_index = 0;
+    const mount_info_t *root = root_index >= 0 ? &mounts[root_index] : NULL;
+    if (root) {
+        size_t len = strnlen(root->mount_point, sizeof(disk->filesystem) - 1);
+        memcpy(disk->filesystem, root->mount_point, len);
+        disk->filesystem[len] = '\0';
+        disk->total_bytes = root->total_bytes;
+        disk->used_bytes = root->used_bytes;
+        disk->available_bytes = root->available_bytes;
+        disk->usage_percent = root->usage_percent;
+    }
+
+    int count = update_devices();
+    if (count < 0) {
+        // Capacity is still useful without I/O rates (no diskstats in some containers)
+        count = 0;
+    }
+    disk->devices = devices;
+    disk->device_count = count;
+
+    return root ? 0 : -1;
+}
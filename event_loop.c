@@ -0,0 +1,296 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+// Event loop for the repeating modes: one epoll set with
+//   - a timerfd armed on absolute CLOCK_MONOTONIC period boundaries, so the
+//     sampling cadence never drifts by the time spent collecting,
+//   - a signalfd for SIGINT, SIGTERM and SIGWINCH,
+//   - stdin in non-canonical mode for single keypresses,
+//   - optionally the PSI trigger descriptors, which raise EPOLLPRI when a
+//     stall crossed its threshold. A stall switches the timer to a short
+//     burst period for a few ticks, then back onto the regular boundaries,
+//   - optionally the epoll set of the --serve sockets, reported as
+//     EVENT_SERVE for the caller to handle between samples,
+//   - optionally a second, relative timer for the fast collectors of
+//     --windows, reported as EVENT_FAST.
+
+// Keys that end the loop
+#define KEY_QUIT(c) ((c) == 'q' || (c) == 'Q')
+
+// Terminal settings to put back at exit while a loop holds stdin in raw
+// mode, so a startup error that returns from main without closing the loop
+// does not leave the shell without echo
+static struct termios exit_tty;
+static int exit_tty_pending = 0;
+static int exit_tty_registered = 0;
+
+static void restore_tty_at_exit(void) {
+    if (exit_tty_pending) tcsetattr(STDIN_FILENO, TCSANOW, &exit_tty);
+}
+
+static int epoll_add(int epfd, int fd, uint32_t events) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Blocks the handled signals in the calling thread and every thread it
+// creates later; call before starting the scan thread pool
+static int block_signals(sigset_t *set) {
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+    sigaddset(set, SIGWINCH);
+    return pthread_sigmask(SIG_BLOCK, set, NULL) == 0 ? 0 : -1;
+}
+
+// Arms the periodic absolute timer on the next boundary start + k * interval,
+// so expirations stay on the same grid whatever happened before
+static int arm_periodic(event_loop_t *loop) {
+    struct itimerspec spec;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t interval_ns = (int64_t)loop->interval_ms * 1000000;
+    int64_t since_ns = (int64_t)(now.tv_sec - loop->start.tv_sec) * 1000000000 +
+                       (now.tv_nsec - loop->start.tv_nsec);
+    int64_t next_ns = (since_ns / interval_ns + 1) * interval_ns;
+
+    spec.it_interval.tv_sec = loop->interval_ms / 1000;
+    spec.it_interval.tv_nsec = (loop->interval_ms % 1000) * 1000000L;
+    spec.it_value.tv_sec = loop->start.tv_sec + (time_t)(next_ns / 1000000000);
+    spec.it_value.tv_nsec = loop->start.tv_nsec + (long)(next_ns % 1000000000);
+    if (spec.it_value.tv_nsec >= 1000000000L) {
+        spec.it_value.tv_sec++;
+        spec.it_value.tv_nsec -= 1000000000L;
+    }
+    return timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+// Opens the loop with a tick every interval_ms milliseconds, the first one
+// interval_ms from now. With keys set stdin is read key by key if it is a
+// terminal.
+int event_loop_open(event_loop_t *loop, long interval_ms, int keys) {
+    sigset_t signals;
+
+    memset(loop, 0, sizeof(event_loop_t));
+    loop->epfd = loop->timer_fd = loop->signal_fd = loop->key_fd = -1;
+    loop->serve_fd = loop->fast_fd = -1;
+    loop->interval_ms = interval_ms;
+
+    if (block_signals(&signals) != 0) return -1;
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    loop->signal_fd = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (loop->epfd < 0 || loop->signal_fd < 0 || loop->timer_fd < 0) goto fail;
+
+    clock_gettime(CLOCK_MONOTONIC, &loop->start);
+    if (arm_periodic(loop) != 0) goto fail;
+
+    if (epoll_add(loop->epfd, loop->timer_fd, EPOLLIN) != 0 ||
+        epoll_add(loop->epfd, loop->signal_fd, EPOLLIN) != 0) {
+        goto fail;
+    }
+
+    // Single keypresses without echo; Ctrl-C still raises SIGINT
+    if (keys && isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &loop->saved_tty) == 0) {
+        struct termios raw = loop->saved_tty;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        if (!exit_tty_registered) exit_tty_registered = atexit(restore_tty_at_exit) == 0;
+        if (exit_tty_registered && tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0) {
+            exit_tty = loop->saved_tty;
+            exit_tty_pending = 1;
+            loop->raw_tty = 1;
+            loop->key_fd = STDIN_FILENO;
+            if (epoll_add(loop->epfd, loop->key_fd, EPOLLIN) != 0) loop->key_fd = -1;
+        }
+    }
+    return 0;
+
+fail:
+    event_loop_close(loop);
+    return -1;
+}
+
+void event_loop_close(event_loop_t *loop) {
+    if (loop->raw_tty) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &loop->saved_tty);
+        exit_tty_pending = 0;
+    }
+    if (loop->timer_fd >= 0) close(loop->timer_fd);
+    if (loop->signal_fd >= 0) close(loop->signal_fd);
+    if (loop->fast_fd >= 0) close(loop->fast_fd);
+    if (loop->epfd >= 0) close(loop->epfd);
+    memset(loop, 0, sizeof(event_loop_t));
+    loop->epfd = loop->timer_fd = loop->signal_fd = loop->key_fd = -1;
+    loop->serve_fd = loop->fast_fd = -1;
+}
+
+// Wakes the loop with EVENT_STALL whenever fd raises POLLPRI (PSI trigger)
+int event_loop_add_trigger(event_loop_t *loop, int fd) {
+    if (epoll_add(loop->epfd, fd, EPOLLPRI) != 0) return -1;
+    loop->triggers++;
+    return 0;
+}
+
+// Wakes the loop with EVENT_SERVE whenever the epoll set fd has ready sockets
+int event_loop_add_server(event_loop_t *loop, int fd) {
+    if (epoll_add(loop->epfd, fd, EPOLLIN) != 0) return -1;
+    loop->serve_fd = fd;
+    return 0;
+}
+
+// Wakes the loop with EVENT_FAST every interval_ms, apart from the ticks
+int event_loop_add_fast(event_loop_t *loop, long interval_ms) {
+    struct itimerspec spec;
+
+    loop->fast_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (loop->fast_fd < 0) return -1;
+
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(loop->fast_fd, 0, &spec, NULL) != 0 ||
+        epoll_add(loop->epfd, loop->fast_fd, EPOLLIN) != 0) {
+        close(loop->fast_fd);
+        loop->fast_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// Ticks every burst_ms for the next ticks periods, then resumes the regular
+// period on its usual boundaries. A burst during a burst starts over; a
+// burst period no shorter than the regular one changes nothing.
+int event_loop_burst(event_loop_t *loop, long burst_ms, int ticks) {
+    struct itimerspec spec;
+
+    if (burst_ms >= loop->interval_ms || ticks <= 0) return 0;
+
+    spec.it_interval.tv_sec = burst_ms / 1000;
+    spec.it_interval.tv_nsec = (burst_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(loop->timer_fd, 0, &spec, NULL) != 0) return -1;
+
+    loop->burst_ms = burst_ms;
+    loop->burst_left = ticks;
+    return 0;
+}
+
+// Drains the signalfd; returns 1 if a quit signal arrived
+static int handle_signals(event_loop_t *loop) {
+    struct signalfd_siginfo info;
+    int quit = 0;
+
+    while (read(loop->signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        if (info.ssi_signo == SIGWINCH) {
+            screen_invalidate();
+        } else {
+            quit = 1;
+        }
+    }
+    return quit;
+}
+
+// Waits for the next tick, key or quit request
+int event_loop_next(event_loop_t *loop, event_t *event) {
+    memset(event, 0, sizeof(event_t));
+
+    for (;;) {
+        struct epoll_event ready[EVENT_LOOP_BATCH];
+        int n = epoll_wait(loop->epfd, ready, EVENT_LOOP_BATCH, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        // Trigger wakeups come first and all at once: epoll consumes them
+        // when it reports them, while the timer, signals and keys stay
+        // readable until they are read
+        for (int i = 0; i < n; i++) {
+            if (ready[i].events & EPOLLPRI) event->stall_fds[event->stall_count++] = ready[i].data.fd;
+        }
+        if (event->stall_count > 0) {
+            event->type = EVENT_STALL;
+            loop->stalls++;
+            return 0;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = ready[i].data.fd;
+
+            if (fd == loop->signal_fd) {
+                if (!handle_signals(loop)) continue;
+                event->type = EVENT_QUIT;
+                return 0;
+            }
+
+            if (fd == loop->key_fd) {
+                char key;
+                ssize_t got = read(loop->key_fd, &key, 1);
+                if (got <= 0) {
+                    // stdin closed: stop watching it
+                    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, loop->key_fd, NULL);
+                    loop->key_fd = -1;
+                    continue;
+                }
+                event->type = KEY_QUIT(key) ? EVENT_QUIT : EVENT_KEY;
+                event->key = key;
+                return 0;
+            }
+
+            if (fd == loop->timer_fd) {
+                uint64_t expirations;
+                if (read(loop->timer_fd, &expirations, sizeof(expirations)) !=
+                    (ssize_t)sizeof(expirations)) {
+                    continue;
+                }
+                // More than one expiration: the previous sample overran
+                event->type = EVENT_TICK;
+                event->missed = expirations - 1;
+                loop->ticks += expirations;
+                loop->overruns += expirations - 1;
+
+                if (loop->burst_left > 0) {
+                    event->burst = 1;
+                    loop->burst_left -= expirations < (uint64_t)loop->burst_left ?
+                                        (int)expirations : loop->burst_left;
+                    if (loop->burst_left == 0 && arm_periodic(loop) != 0) return -1;
+                }
+                return 0;
+            }
+
+            // Fast periods missed while a sample was taken are not made up
+            if (fd == loop->fast_fd) {
+                uint64_t expirations;
+                if (read(loop->fast_fd, &expirations, sizeof(expirations)) !=
+                    (ssize_t)sizeof(expirations)) {
+                    continue;
+                }
+                event->type = EVENT_FAST;
+                return 0;
+            }
+
+            if (fd == loop->serve_fd) {
+                event->type = EVENT_SERVE;
+                return 0;
+            }
+
+            // Anything else is a trigger; EPOLLERR means it went away
+            if (ready[i].events & EPOLLERR) {
+                epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+                loop->triggers--;
+            }
+        }
+    }
+}
@@ -0,0 +1,230 @@
+#include "sysmon.h"
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+// On-disk ring of binary sample records.
+//
+// The file is a one-page header followed by slot_count fixed-size slots.
+// Each slot starts with a 64-bit sequence word used as a seqlock: the writer
+// makes it odd while the slot is being filled and stores 2 * (index + 1)
+// once the record for sample number "index" is complete. Readers skip slots
+// whose sequence is odd or changes while they copy, so neither a concurrent
+// writer nor a crash in the middle of a write can produce a torn sample.
+
+#define HISTORY_MAGIC   0x5453484e4f4d53ull   // "SMONHST"
+#define HISTORY_VERSION 1
+#define HISTORY_HEADER_SIZE 4096
+
+typedef struct {
+    uint64_t magic;                     // HISTORY_MAGIC
+    uint32_t version;                   // HISTORY_VERSION
+    uint32_t slot_size;                 // Bytes per slot, multiple of 8
+    uint64_t slot_count;                // Number of slots in the ring
+    uint64_t head;                      // Samples ever written (next index)
+} history_header_t;
+
+// Sequence word at the start of every slot, followed by the record
+typedef struct {
+    uint64_t seq;
+} history_slot_t;
+
+static history_header_t *history_hdr(const history_t *h) {
+    return (history_header_t *)h->map;
+}
+
+static history_slot_t *history_slot(const history_t *h, uint64_t index) {
+    uint64_t slot = index % h->slot_count;
+    return (history_slot_t *)(h->map + HISTORY_HEADER_SIZE + slot * h->slot_size);
+}
+
+// Maps an existing or new ring file. writable creates/initializes it with
+// slot_count slots when the file is missing or has a different geometry.
+static int history_map(history_t *h, const char *path, int writable, uint64_t slot_count) {
+    memset(h, 0, sizeof(history_t));
+    h->fd = open(path, (writable ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0644);
+    if (h->fd < 0) return -1;
+
+    // Only one writer may own a ring at a time; lock before any truncation
+    if (writable && flock(h->fd, LOCK_EX | LOCK_NB) != 0) goto fail;
+
+    // Slots are sized for the cores present at startup
+    uint32_t slot_size = (uint32_t)((sizeof(history_slot_t) + record_max_size(cpu_core_count()) + 7)
+                                    & ~(size_t)7);
+    struct stat st;
+    if (fstat(h->fd, &st) != 0) goto fail;
+
+    history_header_t existing;
+    int valid = 0;
+    if ((size_t)st.st_size >= sizeof(existing) &&
+        pread(h->fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing)) {
+        valid = existing.magic == HISTORY_MAGIC && existing.version == HISTORY_VERSION &&
+                existing.slot_count > 0 &&
+                (uint64_t)st.st_size >= HISTORY_HEADER_SIZE + existing.slot_count * existing.slot_size;
+    }
+
+    if (!writable) {
+        if (!valid) {
+            errno = EINVAL;
+            goto fail;
+        }
+        slot_size = existing.slot_size;
+        slot_count = existing.slot_count;
+    } else if (!valid || existing.slot_size != slot_size || existing.slot_count != slot_count) {
+        // Start a fresh ring: truncating zeroes every slot sequence
+        if (ftruncate(h->fd, 0) != 0 ||
+            ftruncate(h->fd, (off_t)(HISTORY_HEADER_SIZE + slot_count * slot_size)) != 0) {
+            goto fail;
+        }
+        valid = 0;
+    }
+
+    h->size = HISTORY_HEADER_SIZE + slot_count * slot_size;
+    h->slot_size = slot_size;
+    h->slot_count = slot_count;
+    h->map = mmap(NULL, h->size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                  MAP_SHARED, h->fd, 0);
+    if (h->map == MAP_FAILED) {
+        h->map = NULL;
+        goto fail;
+    }
+
+    if (writable && !valid) {
+        history_header_t *hdr = history_hdr(h);
+        hdr->version = HISTORY_VERSION;
+        hdr->slot_size = slot_size;
+        hdr->slot_count = slot_count;
+        hdr->head = 0;
+        __atomic_store_n(&hdr->magic, HISTORY_MAGIC, __ATOMIC_RELEASE);
+    }
+    return 0;
+
+fail:
+    history_close(h);
+    return -1;
+}
+
+int history_open_writer(history_t *h, const char *path, uint64_t slot_count) {
+    return history_map(h, path, 1, slot_count);
+}
+
+int history_open_reader(history_t *h, const char *path) {
+    return history_map(h, path, 0, 0);
+}
+
+void history_close(history_t *h) {
+    if (h->map) munmap(h->map, h->size);
+    if (h->fd >= 0) close(h->fd);
+    memset(h, 0, sizeof(history_t));
+    h->fd = -1;
+}
+
+// Appends a sample, encoding it straight into its slot (no allocation)
+void history_append(history_t *h, const system_info_t *info) {
+    history_header_t *hdr = history_hdr(h);
+    uint64_t index = hdr->head;
+    history_slot_t *slot = history_slot(h, index);
+
+    // Mark the slot as being written before touching the record
+    __atomic_store_n(&slot->seq, 2 * index + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    record_encode(info, slot + 1, h->slot_size - sizeof(history_slot_t));
+
+    __atomic_store_n(&slot->seq, 2 * index + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&hdr->head, index + 1, __ATOMIC_RELEASE);
+}
+
+// Number of samples ever written; the ring holds the last slot_count of them
+uint64_t history_head(const history_t *h) {
+    return __atomic_load_n(&history_hdr(h)->head, __ATOMIC_ACQUIRE);
+}
+
+// Oldest sample index still present in the ring
+uint64_t history_tail(const history_t *h) {
+    uint64_t head = history_head(h);
+    return head > h->slot_count ? head - h->slot_count : 0;
+}
+
+// Copies sample number index out of the ring and decodes it.
+// Returns -1 if the slot was overwritten, torn or is being written.
+int history_read(const history_t *h, uint64_t index, void *scratch, system_info_t *info) {
+    const history_slot_t *slot = history_slot(h, index);
+    uint64_t expected = 2 * index + 2;
+    size_t record_size = h->slot_size - sizeof(history_slot_t);
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != expected) return -1;
+    memcpy(scratch, slot + 1, record_size);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != expected) return -1;
+
+    return record_decode(scratch, record_size, info);
+}
+
+// Finds the first sample at or after the given wall-clock time (binary
+// search over the ring, which is ordered by time)
+static uint64_t history_seek(const history_t *h, double when, void *scratch, system_info_t *info) {
+    uint64_t lo = history_tail(h);
+    uint64_t hi = history_head(h);
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (history_read(h, mid, scratch, info) == 0 && info->timestamp >= when) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Renders the samples with from <= timestamp <= to. With follow set the
+// reader polls for new samples on every tick of loop until it quits.
+int history_replay(const char *path, double from, double to, int follow,
+                   history_render_fn render, void *ctx, event_loop_t *loop) {
+    history_t h;
+    system_info_t info;
+
+    if (history_open_reader(&h, path) != 0) return -1;
+
+    void *scratch = malloc(h.slot_size);
+    if (!scratch) {
+        history_close(&h);
+        return -1;
+    }
+
+    uint64_t index = history_seek(&h, from, scratch, &info);
+    int rendered = 0;
+
+    for (;;) {
+        uint64_t head = history_head(&h);
+
+        // Skip samples that were overwritten while we were behind
+        if (index < history_tail(&h)) index = history_tail(&h);
+
+        for (; index < head; index++) {
+            if (history_read(&h, index, scratch, &info) != 0) continue;
+            if (info.timestamp < from) continue;
+            if (info.timestamp > to) {
+                follow = 0;
+                break;
+            }
+            render(&info, ctx);
+            rendered++;
+        }
+
+        if (!follow || !loop) break;
+
+        event_t event;
+        do {
+            if (event_loop_next(loop, &event) != 0) event.type = EVENT_QUIT;
+        } while (event.type == EVENT_KEY);
+        if (event.type == EVENT_QUIT) break;
+    }
+
+    free(scratch);
+    history_close(&h);
+    return rendered;
+}
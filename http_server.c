@@ -0,0 +1,370 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <netdb.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+// HTTP endpoint of --serve: /metrics in the Prometheus text format.
+//
+// The server never collects. Each sample is serialized once, when it is
+// taken, into one of two snapshot buffers; scrapes are answered from the
+// front one with a single writev() of the response head and the snapshot
+// bytes. A connection that could not send everything at once keeps a
+// reference to its snapshot, so the next sample goes into the other buffer;
+// a connection still holding that one a sample later is too slow and is
+// dropped.
+//
+// Everything runs on the sampling thread: the listening socket and the
+// connections sit in the server's own epoll set, whose descriptor the event
+// loop watches, and http_server_poll() handles whatever is ready without
+// blocking.
+
+// epoll tag of the listening socket; connections are tagged by slot
+#define LISTEN_TAG HTTP_MAX_CONNS
+
+static const char index_body[] = "sysmon exporter: metrics at /metrics\n";
+
+static double monotonic_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int watch_fd(http_server_t *srv, int op, int fd, uint32_t events, uint32_t tag) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u32 = tag;
+    return epoll_ctl(srv->epfd, op, fd, &ev);
+}
+
+static void conn_close(http_server_t *srv, http_conn_t *conn) {
+    if (conn->snapshot >= 0) srv->refs[conn->snapshot]--;
+    epoll_ctl(srv->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    memset(conn, 0, sizeof(http_conn_t));
+    conn->fd = -1;
+    conn->snapshot = -1;
+}
+
+// Binds a UNIX socket, replacing a stale socket file left by an earlier run
+static int listen_unix(http_server_t *srv, const char *path) {
+    struct sockaddr_un addr;
+    struct stat st;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path));
+
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    snprintf(srv->unix_path, sizeof(srv->unix_path), "%s", path);
+    return fd;
+}
+
+// Binds HOST:PORT, [V6]:PORT or :PORT (every address)
+static int listen_tcp(const char *spec) {
+    char host[256];
+    const char *colon = strrchr(spec, ':');
+
+    if (!colon || colon[1] == '\0' || (size_t)(colon - spec) >= sizeof(host)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(host, spec, (size_t)(colon - spec));
+    host[colon - spec] = '\0';
+
+    // Brackets only delimit an IPv6 literal
+    char *name = host;
+    size_t len = strlen(host);
+    if (len >= 2 && host[0] == '[' && host[len - 1] == ']') {
+        host[len - 1] = '\0';
+        name = host + 1;
+    }
+
+    struct addrinfo hints, *list;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    int gai = getaddrinfo(*name ? name : NULL, colon + 1, &hints, &list);
+    if (gai != 0) {
+        errno = gai == EAI_SYSTEM ? errno : EINVAL;
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = list; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(list);
+    return fd;
+}
+
+// Listens on addr: "unix:PATH" or an absolute path for a UNIX socket,
+// otherwise HOST:PORT
+int http_server_open(http_server_t *srv, const char *addr) {
+    memset(srv, 0, sizeof(http_server_t));
+    srv->epfd = srv->listen_fd = -1;
+    srv->front = -1;
+
+    // A client that hangs up mid-response must not kill the collector
+    signal(SIGPIPE, SIG_IGN);
+
+    srv->conns = calloc(HTTP_MAX_CONNS, sizeof(http_conn_t));
+    if (!srv->conns) return -1;
+    for (int i = 0; i < HTTP_MAX_CONNS; i++) {
+        srv->conns[i].fd = -1;
+        srv->conns[i].snapshot = -1;
+    }
+    if (output_open_memory(&srv->snapshots[0]) != 0 ||
+        output_open_memory(&srv->snapshots[1]) != 0) {
+        goto fail;
+    }
+
+    if (strncmp(addr, "unix:", 5) == 0) {
+        srv->listen_fd = listen_unix(srv, addr + 5);
+    } else if (addr[0] == '/') {
+        srv->listen_fd = listen_unix(srv, addr);
+    } else {
+        srv->listen_fd = listen_tcp(addr);
+    }
+    if (srv->listen_fd < 0 || listen(srv->listen_fd, HTTP_MAX_CONNS) != 0) goto fail;
+
+    srv->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (srv->epfd < 0 || watch_fd(srv, EPOLL_CTL_ADD, srv->listen_fd, EPOLLIN, LISTEN_TAG) != 0) {
+        goto fail;
+    }
+    return 0;
+
+fail:
+    http_server_close(srv);
+    return -1;
+}
+
+void http_server_close(http_server_t *srv) {
+    if (srv->conns) {
+        for (int i = 0; i < HTTP_MAX_CONNS; i++) {
+            if (srv->conns[i].fd >= 0) conn_close(srv, &srv->conns[i]);
+        }
+    }
+    if (srv->listen_fd >= 0) close(srv->listen_fd);
+    if (srv->unix_path[0]) unlink(srv->unix_path);
+    if (srv->epfd >= 0) close(srv->epfd);
+    output_close(&srv->snapshots[0]);
+    output_close(&srv->snapshots[1]);
+    free(srv->conns);
+    memset(srv, 0, sizeof(http_server_t));
+    srv->epfd = srv->listen_fd = -1;
+    srv->front = -1;
+}
+
+// Serializes a sample into the back snapshot and makes it the front one.
+// Connections still sending the back snapshot are a sample behind and are
+// dropped; so are connections idle for HTTP_IDLE_TIMEOUT seconds.
+void http_server_publish(http_server_t *srv, const system_info_t *info) {
+    int back = srv->front < 0 ? 0 : 1 - srv->front;
+    double now = monotonic_now();
+
+    for (int i = 0; i < HTTP_MAX_CONNS; i++) {
+        http_conn_t *conn = &srv->conns[i];
+        if (conn->fd < 0) continue;
+        if (conn->snapshot == back || now - conn->last_active > HTTP_IDLE_TIMEOUT) {
+            conn_close(srv, conn);
+        }
+    }
+
+    out_writer_t *w = &srv->snapshots[back];
+    w->len = 0;
+    if (output_write_sample(w, FORMAT_PROMETHEUS, info) != 0) return;
+    srv->front = back;
+}
+
+// Fills in the response to the request at the start of conn->request
+static void conn_respond(http_server_t *srv, http_conn_t *conn, size_t request_len) {
+    const char *req = conn->request;
+    const char *status = "200 OK";
+    const char *type = "text/plain; version=0.0.4; charset=utf-8";
+    const char *body = NULL;
+    size_t body_len = 0;
+
+    // Request line: METHOD SP PATH[?QUERY] SP VERSION
+    size_t method_len = strcspn(req, " \r\n");
+    const char *path = req + method_len + (req[method_len] == ' ');
+    size_t path_len = strcspn(path, " ?\r\n");
+    int head_only = method_len == 4 && strncmp(req, "HEAD", 4) == 0;
+    int get = method_len == 3 && strncmp(req, "GET", 3) == 0;
+    const char *version = path + strcspn(path, " \r\n");
+
+    // HTTP/1.1 keeps the connection unless told otherwise
+    conn->keep_alive = strncmp(version, " HTTP/1.1", 9) == 0 &&
+                       !strcasestr(req, "\r\nConnection: close");
+
+    if (!get && !head_only) {
+        status = "405 Method Not Allowed";
+        conn->keep_alive = 0;
+    } else if (path_len == 8 && strncmp(path, "/metrics", 8) == 0) {
+        if (srv->front < 0) {
+            status = "503 Service Unavailable";
+        } else {
+            conn->snapshot = srv->front;
+            srv->refs[srv->front]++;
+            body = srv->snapshots[srv->front].buf;
+            body_len = srv->snapshots[srv->front].len;
+        }
+    } else if (path_len == 1 && path[0] == '/') {
+        type = "text/plain; charset=utf-8";
+        body = index_body;
+        body_len = sizeof(index_body) - 1;
+    } else {
+        status = "404 Not Found";
+    }
+
+    int n = snprintf(conn->head, sizeof(conn->head),
+                     "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                     "Connection: %s\r\n\r\n",
+                     status, type, body_len, conn->keep_alive ? "keep-alive" : "close");
+    conn->head_len = (size_t)n < sizeof(conn->head) ? (size_t)n : sizeof(conn->head) - 1;
+    conn->body = head_only ? NULL : body;
+    conn->body_len = head_only ? 0 : body_len;
+    conn->sent = 0;
+    conn->responding = 1;
+
+    // Keep pipelined bytes for the next request
+    conn->request_len -= request_len;
+    memmove(conn->request, conn->request + request_len, conn->request_len);
+}
+
+// Sends what is left of the response; returns 1 when it is all out, 0 when
+// the socket is full and -1 when the connection failed
+static int conn_send(http_server_t *srv, http_conn_t *conn) {
+    while (conn->sent < conn->head_len + conn->body_len) {
+        struct iovec iov[2];
+        int count = 0;
+
+        if (conn->sent < conn->head_len) {
+            iov[count].iov_base = conn->head + conn->sent;
+            iov[count++].iov_len = conn->head_len - conn->sent;
+        }
+        size_t body_sent = conn->sent > conn->head_len ? conn->sent - conn->head_len : 0;
+        if (conn->body_len > body_sent) {
+            iov[count].iov_base = (char *)conn->body + body_sent;
+            iov[count++].iov_len = conn->body_len - body_sent;
+        }
+
+        ssize_t n = writev(conn->fd, iov, count);
+        selfstat_io(1, n > 0 ? (unsigned long)n : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN ? 0 : -1;
+        }
+        conn->sent += (size_t)n;
+    }
+
+    if (conn->snapshot >= 0) {
+        srv->refs[conn->snapshot]--;
+        conn->snapshot = -1;
+    }
+    conn->responding = 0;
+    return 1;
+}
+
+// Reads, answers and sends on a connection for as long as it does not block
+static void conn_service(http_server_t *srv, http_conn_t *conn, int slot) {
+    for (;;) {
+        if (conn->responding) {
+            int done = conn_send(srv, conn);
+            if (done < 0 || (done > 0 && !conn->keep_alive)) {
+                conn_close(srv, conn);
+                return;
+            }
+            // Wait for room only while a response is stuck
+            if (done == 0) {
+                if (!conn->writing) watch_fd(srv, EPOLL_CTL_MOD, conn->fd, EPOLLOUT, (uint32_t)slot);
+                conn->writing = 1;
+                return;
+            }
+            if (conn->writing) watch_fd(srv, EPOLL_CTL_MOD, conn->fd, EPOLLIN, (uint32_t)slot);
+            conn->writing = 0;
+        }
+
+        // A complete request may already be buffered (pipelining)
+        conn->request[conn->request_len] = '\0';
+        char *end = strstr(conn->request, "\r\n\r\n");
+        if (end) {
+            conn_respond(srv, conn, (size_t)(end + 4 - conn->request));
+            continue;
+        }
+
+        if (conn->request_len == sizeof(conn->request) - 1) {
+            conn_close(srv, conn);      // Request head too large
+            return;
+        }
+        ssize_t n = read(conn->fd, conn->request + conn->request_len,
+                         sizeof(conn->request) - 1 - conn->request_len);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        if (n <= 0) {
+            conn_close(srv, conn);
+            return;
+        }
+        conn->request_len += (size_t)n;
+        conn->last_active = monotonic_now();
+    }
+}
+
+static void accept_all(http_server_t *srv) {
+    for (;;) {
+        int fd = accept4(srv->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        int slot = 0;
+        while (slot < HTTP_MAX_CONNS && srv->conns[slot].fd >= 0) slot++;
+        if (slot == HTTP_MAX_CONNS ||
+            watch_fd(srv, EPOLL_CTL_ADD, fd, EPOLLIN, (uint32_t)slot) != 0) {
+            close(fd);
+            continue;
+        }
+        http_conn_t *conn = &srv->conns[slot];
+        conn->fd = fd;
+        conn->last_active = monotonic_now();
+    }
+}
+
+// Handles every ready socket without blocking
+void http_server_poll(http_server_t *srv) {
+    struct epoll_event ready[EVENT_LOOP_BATCH];
+    int n;
+
+    while ((n = epoll_wait(srv->epfd, ready, EVENT_LOOP_BATCH, 0)) > 0) {
+        for (int i = 0; i < n; i++) {
+            uint32_t tag = ready[i].data.u32;
+            if (tag == LISTEN_TAG) {
+                accept_all(srv);
+            } else if (srv->conns[tag].fd >= 0) {
+                conn_service(srv, &srv->conns[tag], (int)tag);
+            }
+        }
+    }
+}
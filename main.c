@@ -1,60 +1,287 @@
 #include "sysmon.h"
-#include <signal.h>
+#include <errno.h>
 #include <getopt.h>
 
-static volatile int running = 1;
-
-void signal_handler(int sig) {
-    if (sig == SIGINT || sig == SIGTERM) {
-        running = 0;
-    }
-}
-
 void print_usage(const char *prog_name) {
     printf("Usage: %s [options]\n", prog_name);
     printf("\nOptions:\n");
-    printf("  -w, --watch           Continuous monitor mode (updates every 2s)\n");
+    printf("  -w, --watch           Continuous monitor mode (q or Ctrl-C quits, r refreshes)\n");
+    printf("  -i, --interval MS     Watch sampling period in milliseconds (min %d, default %d)\n",
+           MIN_INTERVAL_MS, DEFAULT_INTERVAL_MS);
+    printf("      --no-adaptive     Read every section on every watch sample (by default the\n"
+           "                        process, cgroup and mount scans back off while unchanged)\n");
     printf("  -c, --cpu             Show only CPU information\n");
     printf("  -m, --memory          Show only memory information\n");
     printf("  -u, --uptime          Show only system uptime\n");
     printf("  -d, --disk            Show only disk information\n");
+    printf("  -n, --net             Show only network interface rates\n");
+    printf("      --tcp-states      Also count TCP sockets per state (implies --net)\n");
+    printf("  -P, --pressure        Show only pressure stall information (PSI)\n");
+    printf("  -S, --sensors         Show only temperatures, fans and RAPL power\n");
+    printf("      --psi-trigger MS[/WINDOW]\n"
+           "                        Wake watch mode when tasks stall MS ms within WINDOW ms\n"
+           "                        (default %d) and sample every %d ms for %d samples\n",
+           PSI_TRIGGER_WINDOW_MS, PSI_BURST_INTERVAL_MS, PSI_BURST_SAMPLES);
+    printf("      --cgroups         Show the cgroup v2 tree ranked by CPU (not part of --all)\n");
+    printf("      --windows         Sample CPU, memory, disk and network every %d ms and show\n"
+           "                        min/mean/max and p50/p95/p99 over 10s, 1m and 5m (watch mode,\n"
+           "                        not part of --all)\n", DEFAULT_FAST_INTERVAL_MS);
+    printf("      --fast-interval MS  Sampling period of --windows (at least %d ms)\n",
+           MIN_FAST_INTERVAL_MS);
     printf("  -p, --processes       Show only top processes\n");
     printf("  -a, --all             Show all information (default)\n");
+    printf("  -k, --top N           Number of top processes to show (1-%d, default %d)\n",
+           MAX_TOP_PROCESSES, DEFAULT_TOP_PROCESSES);
+    printf("  -s, --sort KEY        Rank processes by cpu, rss, io or threads (default cpu)\n");
+    printf("  -j, --threads N       Scan processes with N threads (default 1)\n");
+    printf("  -f, --format FMT      Output format: text, jsonl, csv, bin or prom (default text)\n");
+    printf("  -o, --output FILE     Append machine-readable output to FILE instead of stdout\n");
+    printf("  -r, --record FILE     Keep samples in an on-disk ring file\n");
+    printf("      --history N       Samples kept by --record (default %d)\n", DEFAULT_HISTORY_SLOTS);
+    printf("  -R, --replay FILE     Render samples from a ring file instead of collecting\n");
+    printf("      --from TIME       Replay start: epoch seconds, -N[s|m|h] ago or \"YYYY-MM-DD HH:MM:SS\"\n");
+    printf("      --to TIME         Replay end (same formats, default: newest sample)\n");
+    printf("      --follow          Keep rendering new samples as they are recorded\n");
+    printf("      --self-stats      Profile sysmon itself: time, CPU, syscalls and bytes per\n"
+           "                        collector and render (panel, or \"self\" in jsonl)\n");
+    printf("      --proc-root DIR   Read procfs from DIR instead of /proc (fixtures, containers)\n");
+    printf("      --sys-root DIR    Read sysfs from DIR instead of /sys\n");
+    printf("      --daemon          Collect on every interval and publish the samples in shared\n"
+           "                        memory without rendering (also when run as sysmond)\n");
+    printf("      --attach          Render the samples sysmond publishes instead of collecting\n");
+    printf("      --serve ADDR      Serve /metrics (Prometheus) on HOST:PORT, :PORT or a UNIX\n"
+           "                        socket path; runs without rendering unless --watch is given\n");
+    printf("      --shm NAME        Shared-memory object of --daemon and --attach (default %s)\n",
+           DEFAULT_SHM_NAME);
+    printf("      --proc-events     Track processes from kernel fork events instead of listing\n"
+           "                        /proc every refresh (falls back if the kernel refuses)\n");
     printf("  -h, --help            Show this help\n");
     printf("\nExamples:\n");
     printf("  %s                    Show all information once\n", prog_name);
     printf("  %s --watch            Continuous monitor mode\n", prog_name);
+    printf("  %s -w -i 500          Sample every 500 ms\n", prog_name);
+    printf("  %s -w --no-adaptive   Rescan processes and mounts on every sample\n", prog_name);
     printf("  %s --cpu --memory     Show only CPU and memory\n", prog_name);
+    printf("  %s -w -n --tcp-states Watch interface rates and TCP socket states\n", prog_name);
+    printf("  %s -p --top 20 --sort rss  Show the 20 largest processes\n", prog_name);
+    printf("  %s -w --psi-trigger 100  Burst-sample when a stall passes 100 ms per second\n", prog_name);
+    printf("  %s -w -a --cgroups    Watch everything plus the busiest cgroups\n", prog_name);
+    printf("  %s -w -a --windows    Watch everything plus 10s/1m/5m percentiles\n", prog_name);
+    printf("  %s --watch --format jsonl  Stream samples as JSON Lines\n", prog_name);
+    printf("  %s --serve 127.0.0.1:9100  Prometheus endpoint at /metrics\n", prog_name);
+    printf("  %s --watch --record /var/tmp/sysmon.ring\n", prog_name);
+    printf("  %s --replay /var/tmp/sysmon.ring --from -10m\n", prog_name);
+    printf("  sysmond --cgroups &   %s --watch --attach  One collector, many viewers\n", prog_name);
+}
+
+// Where and how samples are rendered
+typedef struct {
+    output_format_t format;             // Output format
+    out_writer_t writer;                // Writer for machine-readable formats
+    int show_flags;                     // Sections to display in text mode
+    int clear;                          // Redraw frames in place (watch, follow)
+    int self_stats;                     // Show the self-profiling panel
+    const event_loop_t *loop;           // Loop whose status the frames show
+    int failed;                         // Writing output failed
+} render_ctx_t;
+
+static void render_sample(const system_info_t *info, void *opaque) {
+    render_ctx_t *ctx = opaque;
+    selfstat_span_t span;
+
+    selfstat_begin(&span, PROBE_RENDER);
+
+    if (ctx->format == FORMAT_TEXT) {
+        // Repeated frames go through the screen renderer, which only
+        // rewrites the cells that changed since the previous frame
+        FILE *frame = ctx->clear ? screen_begin() : NULL;
+        if (frame) {
+            display_set_output(frame);
+            display_system_info(info, ctx->show_flags);
+            if (ctx->self_stats) display_self_stats();
+            if (ctx->loop) display_status(ctx->loop);
+            display_set_output(stdout);
+            if (screen_end() != 0) ctx->failed = 1;
+        } else {
+            display_system_info(info, ctx->show_flags);
+            if (ctx->self_stats) display_self_stats();
+            fflush(stdout);
+        }
+    } else if (output_write_sample(&ctx->writer, ctx->format, info) != 0) {
+        ctx->failed = 1;
+    }
+
+    selfstat_end(&span);
+}
+
+// Parses a --from/--to time: epoch seconds, "-N[s|m|h|d]" before now, or
+// local "YYYY-MM-DD HH:MM[:SS]". Returns -1 if the format is not recognized.
+static int parse_time_spec(const char *spec, double *when) {
+    char *end;
+
+    if (spec[0] == '-') {
+        double amount = strtod(spec + 1, &end);
+        double unit = 1.0;
+        if (end == spec + 1) return -1;
+        switch (*end) {
+            case '\0':
+            case 's': unit = 1.0; break;
+            case 'm': unit = 60.0; break;
+            case 'h': unit = 3600.0; break;
+            case 'd': unit = 86400.0; break;
+            default:  return -1;
+        }
+        *when = (double)time(NULL) - amount * unit;
+        return 0;
+    }
+
+    double epoch = strtod(spec, &end);
+    if (end != spec && *end == '\0') {
+        *when = epoch;
+        return 0;
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    end = strptime(spec, "%Y-%m-%d %H:%M", &tm);
+    if (end && *end == ':') end = strptime(end, ":%S", &tm);
+    if (!end || *end != '\0') return -1;
+    tm.tm_isdst = -1;
+    *when = (double)mktime(&tm);
+    return 0;
+}
+
+// Maps a --format argument to its format, returns -1 if unknown
+static int parse_format(const char *name) {
+    if (strcmp(name, "text") == 0) return FORMAT_TEXT;
+    if (strcmp(name, "jsonl") == 0) return FORMAT_JSONL;
+    if (strcmp(name, "csv") == 0) return FORMAT_CSV;
+    if (strcmp(name, "bin") == 0) return FORMAT_BINARY;
+    if (strcmp(name, "prom") == 0) return FORMAT_PROMETHEUS;
+    return -1;
+}
+
+// Maps a --sort argument to its key, returns -1 if unknown
+static int parse_sort_key(const char *name) {
+    if (strcmp(name, "cpu") == 0) return SORT_CPU;
+    if (strcmp(name, "rss") == 0) return SORT_RSS;
+    if (strcmp(name, "io") == 0) return SORT_IO;
+    if (strcmp(name, "threads") == 0) return SORT_THREADS;
+    return -1;
+}
+
+// Parses a --psi-trigger "STALL_MS[/WINDOW_MS]" within the kernel's limits
+static int parse_psi_trigger(const char *spec, long *stall_ms, long *window_ms) {
+    char *end;
+
+    *stall_ms = strtol(spec, &end, 10);
+    if (end == spec) return -1;
+    if (*end == '/') {
+        const char *window = end + 1;
+        *window_ms = strtol(window, &end, 10);
+        if (end == window) return -1;
+    }
+    if (*end != '\0') return -1;
+    return *stall_ms > 0 && *window_ms >= 500 && *window_ms <= 10000 &&
+           *stall_ms <= *window_ms ? 0 : -1;
 }
 
 int main(int argc, char *argv[]) {
     int watch_mode = 0;     // Flag for continuous monitoring mode
     int show_flags = 0;     // Bit flags for what information to display
+    int scan_threads = 1;                   // Threads used for the process scan
+    output_format_t format = FORMAT_TEXT;   // Output format
+    const char *output_path = NULL;         // Machine-readable output file
+    const char *record_path = NULL;         // Ring file samples are appended to
+    const char *replay_path = NULL;         // Ring file to render instead of collecting
+    long history_slots = DEFAULT_HISTORY_SLOTS;
+    double replay_from = 0.0;               // Replay window start (epoch seconds)
+    double replay_to = 1e300;               // Replay window end
+    int follow = 0;                         // Keep tailing the replayed ring
+    long interval_ms = 0;                   // Sampling period, 0 until set
+    int self_stats = 0;                     // Profile the collectors and renders
+    int proc_events = 0;                    // Track processes from kernel events
+    int proc_root_set = 0;                  // --proc-root given
+    long psi_stall_ms = 0;                  // PSI trigger threshold, 0 for none
+    long psi_window_ms = PSI_TRIGGER_WINDOW_MS;
+    int adaptive = 1;                       // Per-collector periods in watch mode
+    int daemon_mode = 0;                    // Publish samples instead of rendering them
+    int attach = 0;                         // Render published samples
+    const char *shm_name = DEFAULT_SHM_NAME;
+    const char *serve_addr = NULL;          // --serve listening address
+    long fast_ms = DEFAULT_FAST_INTERVAL_MS; // Fast sampling period of --windows
+    collect_options_t options = {
+        .top_count = DEFAULT_TOP_PROCESSES,
+        .sort_key = SORT_CPU,
+    };
 
-    // Set up signal handlers for graceful exit
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    // Long-only options use values outside the character range
+    enum { OPT_HISTORY = 256, OPT_FROM, OPT_TO, OPT_FOLLOW, OPT_SELF_STATS,
+           OPT_PROC_ROOT, OPT_SYS_ROOT, OPT_TCP_STATES,
+           OPT_PROC_EVENTS, OPT_CGROUPS, OPT_PSI_TRIGGER, OPT_NO_ADAPTIVE,
+           OPT_DAEMON, OPT_ATTACH, OPT_SHM, OPT_SERVE, OPT_WINDOWS,
+           OPT_FAST_INTERVAL };
 
     // Define command line options
     static struct option long_options[] = {
         {"watch",     no_argument, 0, 'w'},
+        {"interval",  required_argument, 0, 'i'},
+        {"no-adaptive", no_argument,     0, OPT_NO_ADAPTIVE},
         {"cpu",       no_argument, 0, 'c'},
         {"memory",    no_argument, 0, 'm'},
         {"uptime",    no_argument, 0, 'u'},
         {"disk",      no_argument, 0, 'd'},
+        {"net",       no_argument, 0, 'n'},
+        {"tcp-states", no_argument,      0, OPT_TCP_STATES},
+        {"pressure",  no_argument, 0, 'P'},
+        {"sensors",   no_argument, 0, 'S'},
+        {"psi-trigger", required_argument, 0, OPT_PSI_TRIGGER},
+        {"cgroups",   no_argument,       0, OPT_CGROUPS},
+        {"windows",   no_argument,       0, OPT_WINDOWS},
+        {"fast-interval", required_argument, 0, OPT_FAST_INTERVAL},
         {"processes", no_argument, 0, 'p'},
         {"all",       no_argument, 0, 'a'},
+        {"top",       required_argument, 0, 'k'},
+        {"sort",      required_argument, 0, 's'},
+        {"threads",   required_argument, 0, 'j'},
+        {"format",    required_argument, 0, 'f'},
+        {"output",    required_argument, 0, 'o'},
+        {"record",    required_argument, 0, 'r'},
+        {"history",   required_argument, 0, OPT_HISTORY},
+        {"replay",    required_argument, 0, 'R'},
+        {"from",      required_argument, 0, OPT_FROM},
+        {"to",        required_argument, 0, OPT_TO},
+        {"follow",    no_argument,       0, OPT_FOLLOW},
+        {"self-stats", no_argument,      0, OPT_SELF_STATS},
+        {"proc-root", required_argument, 0, OPT_PROC_ROOT},
+        {"proc-events", no_argument,     0, OPT_PROC_EVENTS},
+        {"daemon",    no_argument,       0, OPT_DAEMON},
+        {"attach",    no_argument,       0, OPT_ATTACH},
+        {"shm",       required_argument, 0, OPT_SHM},
+        {"serve",     required_argument, 0, OPT_SERVE},
+        {"sys-root",  required_argument, 0, OPT_SYS_ROOT},
         {"help",      no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     // Parse command line arguments
     int opt;
-    while ((opt = getopt_long(argc, argv, "wcmudpah", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "wi:cmudnPSpak:s:j:f:o:r:R:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'w':
                 watch_mode = 1;
                 break;
+            case 'i':
+                interval_ms = atol(optarg);
+                if (interval_ms < MIN_INTERVAL_MS) {
+                    fprintf(stderr, "Invalid --interval value: %s (at least %d ms)\n",
+                            optarg, MIN_INTERVAL_MS);
+                    return 1;
+                }
+                break;
+            case OPT_NO_ADAPTIVE:
+                adaptive = 0;
+                break;
             case 'c':
                 show_flags |= SHOW_CPU;
                 break;
@@ -67,11 +294,134 @@ int main(int argc, char *argv[]) {
             case 'd':
                 show_flags |= SHOW_DISK;
                 break;
+            case 'n':
+                show_flags |= SHOW_NET;
+                break;
+            case OPT_TCP_STATES:
+                options.tcp_states = 1;
+                show_flags |= SHOW_NET;
+                break;
+            case 'P':
+                show_flags |= SHOW_PRESSURE;
+                break;
+            case 'S':
+                show_flags |= SHOW_SENSORS;
+                break;
+            case OPT_PSI_TRIGGER:
+                if (parse_psi_trigger(optarg, &psi_stall_ms, &psi_window_ms) != 0) {
+                    fprintf(stderr, "Invalid --psi-trigger value: %s (stall ms up to the window, "
+                            "window 500-10000 ms)\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_CGROUPS:
+                show_flags |= SHOW_CGROUPS;
+                break;
+            case OPT_WINDOWS:
+                show_flags |= SHOW_WINDOWS;
+                break;
+            case OPT_FAST_INTERVAL:
+                fast_ms = atol(optarg);
+                if (fast_ms < MIN_FAST_INTERVAL_MS) {
+                    fprintf(stderr, "Invalid --fast-interval value: %s (at least %d ms)\n",
+                            optarg, MIN_FAST_INTERVAL_MS);
+                    return 1;
+                }
+                break;
             case 'p':
                 show_flags |= SHOW_PROC;
                 break;
             case 'a':
-                show_flags = SHOW_ALL;
+                show_flags |= SHOW_ALL;
+                break;
+            case 'k':
+                options.top_count = atoi(optarg);
+                if (options.top_count < 1 || options.top_count > MAX_TOP_PROCESSES) {
+                    fprintf(stderr, "Invalid --top value: %s (1-%d)\n", optarg, MAX_TOP_PROCESSES);
+                    return 1;
+                }
+                break;
+            case 's': {
+                int key = parse_sort_key(optarg);
+                if (key < 0) {
+                    fprintf(stderr, "Invalid --sort key: %s (cpu, rss, io, threads)\n", optarg);
+                    return 1;
+                }
+                options.sort_key = (proc_sort_t)key;
+                break;
+            }
+            case 'f': {
+                int fmt = parse_format(optarg);
+                if (fmt < 0) {
+                    fprintf(stderr, "Invalid --format: %s (text, jsonl, csv, bin, prom)\n", optarg);
+                    return 1;
+                }
+                format = (output_format_t)fmt;
+                break;
+            }
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'r':
+                record_path = optarg;
+                break;
+            case OPT_HISTORY:
+                history_slots = atol(optarg);
+                if (history_slots < 1) {
+                    fprintf(stderr, "Invalid --history value: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'R':
+                replay_path = optarg;
+                break;
+            case OPT_FROM:
+            case OPT_TO:
+                if (parse_time_spec(optarg, opt == OPT_FROM ? &replay_from : &replay_to) != 0) {
+                    fprintf(stderr, "Invalid time: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_FOLLOW:
+                follow = 1;
+                break;
+            case OPT_SELF_STATS:
+                self_stats = 1;
+                break;
+            case OPT_PROC_EVENTS:
+                proc_events = 1;
+                break;
+            case OPT_DAEMON:
+                daemon_mode = 1;
+                break;
+            case OPT_ATTACH:
+                attach = 1;
+                break;
+            case OPT_SHM:
+                if (optarg[0] != '/' || strchr(optarg + 1, '/') || strlen(optarg) >= 64) {
+                    fprintf(stderr, "Invalid --shm name: %s (/NAME, no other slashes)\n", optarg);
+                    return 1;
+                }
+                shm_name = optarg;
+                break;
+            case OPT_SERVE:
+                serve_addr = optarg;
+                break;
+            case OPT_PROC_ROOT:
+            case OPT_SYS_ROOT:
+                if (sysmon_set_roots(opt == OPT_PROC_ROOT ? optarg : NULL,
+                                     opt == OPT_SYS_ROOT ? optarg : NULL) != 0) {
+                    perror(optarg);
+                    return 1;
+                }
+                if (opt == OPT_PROC_ROOT) proc_root_set = 1;
+                break;
+            case 'j':
+                scan_threads = atoi(optarg);
+                if (scan_threads < 1 || scan_threads > MAX_SCAN_THREADS) {
+                    fprintf(stderr, "Invalid --threads value: %s (1-%d)\n", optarg, MAX_SCAN_THREADS);
+                    return 1;
+                }
                 break;
             case 'h':
                 print_usage(argv[0]);
@@ -82,67 +432,275 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    // If no specific flags set, show everything
+    // Started as sysmond, the binary is the publisher
+    const char *base = strrchr(argv[0], '/');
+    if (strcmp(base ? base + 1 : argv[0], "sysmond") == 0) daemon_mode = 1;
+
+    if (daemon_mode + attach + (replay_path != NULL) > 1) {
+        fprintf(stderr, "sysmon: --daemon, --attach and --replay exclude each other\n");
+        return 1;
+    }
+
+    if (serve_addr && (attach || replay_path)) {
+        fprintf(stderr, "sysmon: --serve collects itself; it excludes --attach and --replay\n");
+        return 1;
+    }
+
+    // The daemon and the endpoint sample until they are stopped, rendering
+    // nothing unless watch mode was asked for as well
+    int headless = daemon_mode || (serve_addr && !watch_mode);
+    if (daemon_mode || serve_addr) watch_mode = 1;
+
+    // If no specific flags set, show everything; a replay or a client also
+    // shows the cgroup tree when it was collected
     if (show_flags == 0) {
-        show_flags = SHOW_ALL;
+        show_flags = (replay_path || attach) ? SHOW_ALL | SHOW_CGROUPS : SHOW_ALL;
     }
 
-    system_info_t info;
+    // A client renders at the publisher's period unless told otherwise
+    shm_segment_t segment;
+    if (attach) {
+        if (shm_reader_open(&segment, shm_name) != 0) {
+            fprintf(stderr, "sysmon: nothing published at %s (%s); start sysmond first\n",
+                    shm_name, strerror(errno));
+            return 1;
+        }
+        if (interval_ms == 0) interval_ms = segment.interval_ms;
+    }
+
+    // Watch samples every interval; follow polls the ring at a short period
+    // unless one was given
+    if (interval_ms == 0) {
+        interval_ms = (replay_path && follow) ? 100 : DEFAULT_INTERVAL_MS;
+    }
+
+    // Repeating modes run on the event loop. It blocks the signals it handles,
+    // so it must be opened before any scan thread is started.
+    event_loop_t loop;
+    int looping = replay_path ? follow : watch_mode;
+    if (looping && event_loop_open(&loop, interval_ms, format == FORMAT_TEXT && !headless) != 0) {
+        perror("Error setting up event loop");
+        return 1;
+    }
+
+    render_ctx_t render = {
+        .format = format,
+        .show_flags = show_flags,
+        .clear = watch_mode || follow,
+        .loop = (looping && !replay_path && !attach) ? &loop : NULL,
+        .self_stats = self_stats && !replay_path && !attach && format == FORMAT_TEXT,
+    };
+    if (format != FORMAT_TEXT && !headless && output_open(&render.writer, output_path) != 0) {
+        perror("Error opening output");
+        return 1;
+    }
 
-    // Main monitoring loop
-    do {
-        if (watch_mode) {
-            clear_screen();
+    // Replay mode renders recorded samples and never reads /proc
+    if (replay_path) {
+        int rendered = history_replay(replay_path, replay_from, replay_to, follow,
+                                      render_sample, &render, looping ? &loop : NULL);
+        if (format != FORMAT_TEXT) {
+            output_close(&render.writer);
+        } else {
+            screen_close();
+        }
+        if (looping) {
+            event_loop_close(&loop);
         }
+        if (rendered < 0) {
+            perror("Error reading history file");
+            return 1;
+        }
+        return 0;
+    }
 
-        display_header();
+    // A client renders what the daemon collected and never reads /proc
+    if (attach) {
+        int rendered = shm_follow(&segment, watch_mode, render_sample, &render,
+                                  looping ? &loop : NULL);
+        int failed = rendered == 0 && !watch_mode;
+        if (failed) perror("Error reading published sample");
+        shm_reader_close(&segment);
+        if (format != FORMAT_TEXT) {
+            output_close(&render.writer);
+        } else {
+            screen_close();
+        }
+        if (looping) {
+            event_loop_close(&loop);
+        }
+        return failed ? 1 : 0;
+    }
 
-        // Initialize system info structure
-        memset(&info, 0, sizeof(system_info_t));
+    if (scan_threads > 1 && (show_flags & SHOW_PROC) &&
+        process_scan_set_threads(scan_threads) != 0) {
+        perror("Error starting scan threads");
+        return 1;
+    }
 
-        // Read and display CPU information if requested
-        if (show_flags & SHOW_CPU) {
-            if (read_cpu_info(&info.cpu) == 0) {
-                display_cpu_info(&info.cpu);
-            }
+    // Process events come from the running kernel, not from another procfs
+    // tree; without the subscription the scan keeps listing /proc
+    if (proc_events && (show_flags & SHOW_PROC)) {
+        if (proc_root_set) {
+            fprintf(stderr, "sysmon: --proc-events ignored with --proc-root\n");
+        } else if (proc_events_open() != 0) {
+            fprintf(stderr, "sysmon: process events unavailable (%s), listing /proc instead\n",
+                    strerror(errno));
         }
+    }
 
-        // Read and display memory information if requested
-        if (show_flags & SHOW_MEMORY) {
-            if (read_memory_info(&info.memory) == 0) {
-                display_memory_info(&info.memory);
+    // Stall triggers wake the watch loop; like process events they belong to
+    // the running kernel
+    if (psi_stall_ms > 0) {
+        if (!watch_mode) {
+            fprintf(stderr, "sysmon: --psi-trigger only applies to --watch\n");
+        } else if (proc_root_set) {
+            fprintf(stderr, "sysmon: --psi-trigger ignored with --proc-root\n");
+        } else if (pressure_triggers_open(psi_stall_ms, psi_window_ms) == 0) {
+            fprintf(stderr, "sysmon: stall triggers unavailable (%s)\n", strerror(errno));
+        } else {
+            for (int r = 0; r < PSI_RESOURCES; r++) {
+                int fd = pressure_trigger_fd(r);
+                if (fd >= 0 && event_loop_add_trigger(&loop, fd) != 0) {
+                    perror("Error watching stall trigger");
+                }
             }
         }
+    }
 
-        // Read and display uptime information if requested
-        if (show_flags & SHOW_UPTIME) {
-            if (read_uptime_info(&info.uptime) == 0) {
-                display_uptime_info(&info.uptime);
-            }
+    // The rolling windows fill from their own timer between samples, so they
+    // need the loop; the published and recorded samples leave them out
+    if (show_flags & SHOW_WINDOWS) {
+        if (!watch_mode) {
+            fprintf(stderr, "sysmon: --windows only applies to --watch\n");
+            show_flags &= ~SHOW_WINDOWS;
+        } else if (aggregate_open(cpu_core_count()) != 0 ||
+                   event_loop_add_fast(&loop, fast_ms) != 0) {
+            perror("Error starting fast sampling");
+            return 1;
+        }
+    }
+
+    // A single sample reads everything anyway; watch mode reuses the slow
+    // scans while they are not due
+    options.show_flags = show_flags;
+    options.adaptive = watch_mode && adaptive;
+    options.interval_ms = interval_ms;
+    selfstat_enable(self_stats);
+
+    history_t history;
+    if (record_path && history_open_writer(&history, record_path, (uint64_t)history_slots) != 0) {
+        perror("Error opening history file");
+        return 1;
+    }
+
+    // Open the segment last, so a daemon that fails to start publishes nothing
+    if (daemon_mode && shm_publisher_open(&segment, shm_name, interval_ms) != 0) {
+        fprintf(stderr, "sysmon: cannot publish at %s: %s\n", shm_name,
+                errno == EWOULDBLOCK ? "another sysmond owns it" : strerror(errno));
+        return 1;
+    }
+
+    // Scrapes are answered between samples from the loop
+    http_server_t server;
+    if (serve_addr) {
+        if (http_server_open(&server, serve_addr) != 0) {
+            fprintf(stderr, "sysmon: cannot serve on %s: %s\n", serve_addr, strerror(errno));
+            return 1;
+        }
+        if (event_loop_add_server(&loop, server.epfd) != 0) {
+            perror("Error watching the server sockets");
+            return 1;
+        }
+    }
+
+    system_info_t info;
+    int burst_sample = 0;   // The sample is part of a stall burst
+
+    // Main monitoring loop: one sample now, then one per timer tick
+    for (;;) {
+        collect_system_info(&info, &options);
+        options.refresh = 0;
+        info.pressure.burst = burst_sample;
+
+        if (record_path) {
+            history_append(&history, &info);
+        }
+
+        if (daemon_mode) {
+            shm_publish(&segment, &info);
+        }
+        if (serve_addr) {
+            http_server_publish(&server, &info);
+        }
+        if (!headless) {
+            render_sample(&info, &render);
+        }
+        if (render.failed) {
+            perror("Error writing output");
+            break;
         }
 
-        // Read and display disk information if requested
-        if (show_flags & SHOW_DISK) {
-            if (read_disk_info(&info.disk) == 0) {
-                display_disk_info(&info.disk);
+        if (!watch_mode) break;
+
+        // Wait for the next period boundary, a refresh key, a stall trigger
+        // or a quit request, answering scrapes and taking fast samples meanwhile
+        event_t event;
+        for (;;) {
+            if (event_loop_next(&loop, &event) != 0) {
+                perror("Error waiting for events");
+                event.type = EVENT_QUIT;
+            }
+            if (event.type == EVENT_SERVE) {
+                http_server_poll(&server);
+            } else if (event.type == EVENT_FAST) {
+                collect_fast(&options);
+            } else if (event.type != EVENT_KEY || event.key == 'r') {
+                break;
             }
         }
 
-        // Read and display process information if requested
-        if (show_flags & SHOW_PROC) {
-            info.process_count = read_top_processes(info.top_processes, 10);
-            if (info.process_count > 0) {
-                display_processes(info.top_processes, info.process_count);
+        if (event.type == EVENT_QUIT) break;
+
+        // The refresh key reads every section, due or not
+        if (event.type == EVENT_KEY) options.refresh = 1;
+
+        // A stall is sampled right away, then at the burst period for a while
+        if (event.type == EVENT_STALL) {
+            for (int i = 0; i < event.stall_count; i++) pressure_trigger_fired(event.stall_fds[i]);
+            if (event_loop_burst(&loop, PSI_BURST_INTERVAL_MS, PSI_BURST_SAMPLES) != 0) {
+                perror("Error starting burst sampling");
             }
         }
+        burst_sample = event.type == EVENT_STALL || event.burst;
 
-        // In watch mode, wait before next update
-        if (watch_mode && running) {
-            fflush(stdout);
-            sleep(2);
+        // The text frame shows the overrun count; keep other streams clean
+        if (event.missed > 0 && (format != FORMAT_TEXT || headless)) {
+            fprintf(stderr, "sysmon: sampling overran the %ld ms interval, %llu period(s) skipped\n",
+                    interval_ms, (unsigned long long)event.missed);
         }
+    }
 
-    } while (watch_mode && running);
+    if (record_path) {
+        history_close(&history);
+    }
+    if (daemon_mode) {
+        shm_publisher_close(&segment);
+    }
+    if (serve_addr) {
+        http_server_close(&server);
+    }
+    proc_events_close();
+    pressure_triggers_close();
+    aggregate_close();
+    if (format != FORMAT_TEXT && !headless) {
+        output_close(&render.writer);
+    } else {
+        screen_close();
+    }
+    if (looping) {
+        event_loop_close(&loop);
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,45 +1,311 @@
 #include "sysmon.h"
 
+// Memory collector: /proc/meminfo, the /proc/vmstat counters that tell about
+// reclaim and faults, and the meminfo of every NUMA node.
+//
+// All three files are "key value" lists. Keys are looked up in a perfect
+// hash of the keys wanted: one FNV-1a pass over the key and a single string
+// compare, whatever the key, instead of a chain of compares per line. The
+// hash seed is searched once so that the wanted keys never collide; any
+// other key lands on an empty slot or fails the one compare.
+
+// Slots of a key table; a power of two well above the number of keys
+#define KEY_SLOTS 256
+
+typedef struct {
+    const char *const *keys;            // Wanted keys, indexed by their value slot
+    int count;
+    int built;                          // seed and slots are set
+    uint32_t seed;
+    uint8_t slots[KEY_SLOTS];           // Key index + 1, 0 for an empty slot
+} key_table_t;
+
+#define KEY_TABLE(names) { (names), (int)(sizeof(names) / sizeof((names)[0])), 0, 0, {0} }
+
+// /proc/meminfo keys, in kB apart from the huge page counts
+enum {
+    MI_TOTAL, MI_FREE, MI_AVAILABLE, MI_BUFFERS, MI_CACHED, MI_SWAP_TOTAL, MI_SWAP_FREE,
+    MI_SHMEM, MI_SRECLAIMABLE, MI_SUNRECLAIM, MI_DIRTY, MI_WRITEBACK, MI_ANON,
+    MI_ACTIVE_FILE, MI_INACTIVE_FILE, MI_HUGE_TOTAL, MI_HUGE_FREE, MI_HUGE_SIZE,
+    MI_KEYS
+};
+
+static const char *const meminfo_keys[MI_KEYS] = {
+    [MI_TOTAL] = "MemTotal", [MI_FREE] = "MemFree", [MI_AVAILABLE] = "MemAvailable",
+    [MI_BUFFERS] = "Buffers", [MI_CACHED] = "Cached", [MI_SWAP_TOTAL] = "SwapTotal",
+    [MI_SWAP_FREE] = "SwapFree", [MI_SHMEM] = "Shmem", [MI_SRECLAIMABLE] = "SReclaimable",
+    [MI_SUNRECLAIM] = "SUnreclaim", [MI_DIRTY] = "Dirty", [MI_WRITEBACK] = "Writeback",
+    [MI_ANON] = "AnonPages", [MI_ACTIVE_FILE] = "Active(file)",
+    [MI_INACTIVE_FILE] = "Inactive(file)", [MI_HUGE_TOTAL] = "HugePages_Total",
+    [MI_HUGE_FREE] = "HugePages_Free", [MI_HUGE_SIZE] = "Hugepagesize",
+};
+
+// /proc/vmstat event counters turned into rates
+enum {
+    VM_PGFAULT, VM_PGMAJFAULT, VM_PSWPIN, VM_PSWPOUT, VM_PGSCAN_KSWAPD, VM_PGSCAN_DIRECT,
+    VM_PGSTEAL_KSWAPD, VM_PGSTEAL_DIRECT, VM_COMPACT_STALL, VM_OOM_KILL, VM_NUMA_MISS,
+    VM_KEYS
+};
+
+static const char *const vmstat_keys[VM_KEYS] = {
+    [VM_PGFAULT] = "pgfault", [VM_PGMAJFAULT] = "pgmajfault", [VM_PSWPIN] = "pswpin",
+    [VM_PSWPOUT] = "pswpout", [VM_PGSCAN_KSWAPD] = "pgscan_kswapd",
+    [VM_PGSCAN_DIRECT] = "pgscan_direct", [VM_PGSTEAL_KSWAPD] = "pgsteal_kswapd",
+    [VM_PGSTEAL_DIRECT] = "pgsteal_direct", [VM_COMPACT_STALL] = "compact_stall",
+    [VM_OOM_KILL] = "oom_kill", [VM_NUMA_MISS] = "numa_miss",
+};
+
+// Per-node meminfo keys, after the "Node N " prefix
+enum { NI_TOTAL, NI_FREE, NI_FILE, NI_ANON, NI_SHMEM, NI_SRECLAIMABLE, NI_KEYS };
+
+static const char *const node_keys[NI_KEYS] = {
+    [NI_TOTAL] = "MemTotal", [NI_FREE] = "MemFree", [NI_FILE] = "FilePages",
+    [NI_ANON] = "AnonPages", [NI_SHMEM] = "Shmem", [NI_SRECLAIMABLE] = "SReclaimable",
+};
+
+static key_table_t meminfo_table = KEY_TABLE(meminfo_keys);
+static key_table_t vmstat_table = KEY_TABLE(vmstat_keys);
+static key_table_t node_table = KEY_TABLE(node_keys);
+
+// Persistent handles for /proc/meminfo and /proc/vmstat
+static proc_file_t meminfo_file = PROC_FILE_INIT("/proc/meminfo");
+static proc_file_t vmstat_file = PROC_FILE_INIT("/proc/vmstat");
+
+// vmstat counters of the last sample, for the rates
+static unsigned long vmstat_prev[VM_KEYS];
+static uint64_t vmstat_prev_present = 0;
+static double vmstat_time = 0.0;        // CLOCK_MONOTONIC time of the last sample
+
+// NUMA nodes are listed once per root generation and their meminfo files
+// kept open
+static proc_file_t node_files[MAX_NUMA_NODES];
+static char node_paths[MAX_NUMA_NODES][64];
+static int node_ids[MAX_NUMA_NODES];
+static int node_count = 0;
+static int nodes_listed = 0;
+static unsigned int nodes_generation = 0;
+
+static uint32_t key_hash(const char *key, size_t len, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+
+    for (size_t i = 0; i < len; i++) hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+    return hash ^ (hash >> 16);
+}
+
+// Searches a seed under which no two wanted keys share a slot
+static void key_table_build(key_table_t *table) {
+    for (uint32_t seed = 0;; seed++) {
+        int collided = 0;
+
+        memset(table->slots, 0, sizeof(table->slots));
+        for (int i = 0; i < table->count && !collided; i++) {
+            uint8_t *slot = &table->slots[key_hash(table->keys[i], strlen(table->keys[i]), seed) &
+                                          (KEY_SLOTS - 1)];
+            if (*slot) collided = 1;
+            *slot = (uint8_t)(i + 1);
+        }
+        if (!collided) {
+            table->seed = seed;
+            table->built = 1;
+            return;
+        }
+    }
+}
+
+// Index of a wanted key, -1 for any other
+static int key_lookup(const key_table_t *table, const char *key, size_t len) {
+    int index = table->slots[key_hash(key, len, table->seed) & (KEY_SLOTS - 1)] - 1;
+
+    if (index < 0 || strncmp(table->keys[index], key, len) != 0 ||
+        table->keys[index][len] != '\0') {
+        return -1;
+    }
+    return index;
+}
+
+// Parses every "key value" or "key: value" line of buf into values, indexed
+// like the table's keys. Node meminfo lines start with "Node N ", which is
+// skipped. Returns a bit per key found.
+static uint64_t parse_keyed(key_table_t *table, const char *buf, unsigned long *values) {
+    uint64_t present = 0;
+
+    if (!table->built) key_table_build(table);
+
+    for (const char *line = buf; *line; line = scan_next_line(line)) {
+        const char *key = line;
+        if (strncmp(key, "Node ", 5) == 0) {
+            key = scan_skip_spaces(key + 5);
+            while (*key >= '0' && *key <= '9') key++;
+            key = scan_skip_spaces(key);
+        }
+
+        const char *end = key;
+        while (*end && *end != ':' && *end != ' ' && *end != '\n') end++;
+        if (*end != ':' && *end != ' ') continue;
+
+        int index = key_lookup(table, key, (size_t)(end - key));
+        if (index >= 0 && scan_ulong(end + 1, &values[index])) present |= 1ull << index;
+    }
+    return present;
+}
+
+// used = total - free - buffers - page cache, counting reclaimable slab as
+// cache and shmem (which cannot be dropped) as used
+static unsigned long used_kb(unsigned long total, unsigned long free, unsigned long buffers,
+                             unsigned long cached, unsigned long reclaimable,
+                             unsigned long shmem) {
+    unsigned long cache = cached + reclaimable;
+    cache = cache > shmem ? cache - shmem : 0;
+
+    unsigned long unused = free + buffers + cache;
+    return total > unused ? total - unused : 0;
+}
+
+// Lists /sys/devices/system/node/node*; no directory means no NUMA nodes
+static void list_nodes(void) {
+    char path[PATH_MAX];
+    struct dirent *entry;
+
+    if (nodes_listed && nodes_generation == sysmon_root_generation()) return;
+
+    for (int i = 0; i < node_count; i++) proc_file_close(&node_files[i]);
+    node_count = 0;
+    nodes_listed = 1;
+    nodes_generation = sysmon_root_generation();
+
+    DIR *dir = opendir(sysmon_path("/sys/devices/system/node", path, sizeof(path)));
+    if (!dir) return;
+
+    while ((entry = readdir(dir)) != NULL && node_count < MAX_NUMA_NODES) {
+        unsigned long id;
+        const char *end;
+        if (strncmp(entry->d_name, "node", 4) != 0 ||
+            !(end = scan_ulong(entry->d_name + 4, &id)) || *end != '\0') {
+            continue;
+        }
+        node_ids[node_count++] = (int)id;
+    }
+    closedir(dir);
+
+    qsort(node_ids, (size_t)node_count, sizeof(int), compare_ints);
+    for (int i = 0; i < node_count; i++) {
+        snprintf(node_paths[i], sizeof(node_paths[i]), "/sys/devices/system/node/node%d/meminfo",
+                 node_ids[i]);
+        node_files[i] = (proc_file_t)PROC_FILE_INIT(node_paths[i]);
+    }
+}
+
+static void read_nodes(memory_info_t *memory) {
+    unsigned long values[NI_KEYS];
+
+    list_nodes();
+    for (int i = 0; i < node_count && memory->numa_count < MAX_NUMA_NODES; i++) {
+        if (proc_file_read(&node_files[i]) < 0) continue;
+
+        memset(values, 0, sizeof(values));
+        parse_keyed(&node_table, node_files[i].buf, values);
+        if (values[NI_TOTAL] == 0) continue;
+
+        numa_node_t *node = &memory->numa[memory->numa_count++];
+        node->id = node_ids[i];
+        node->total_kb = values[NI_TOTAL];
+        node->free_kb = values[NI_FREE];
+        node->file_kb = values[NI_FILE];
+        node->anon_kb = values[NI_ANON];
+        // FilePages includes the buffers
+        node->used_kb = used_kb(values[NI_TOTAL], values[NI_FREE], 0, values[NI_FILE],
+                                values[NI_SRECLAIMABLE], values[NI_SHMEM]);
+        node->usage_percent = (double)node->used_kb * 100.0 / (double)node->total_kb;
+    }
+}
+
+// Per-second rate of a counter, -1 when it is missing from either sample
+static double vmstat_rate(const unsigned long *cur, uint64_t present, int a, int b,
+                          double elapsed) {
+    uint64_t wanted = (1ull << a) | (b >= 0 ? 1ull << b : 0);
+    if ((present & wanted) != wanted || (vmstat_prev_present & wanted) != wanted ||
+        elapsed <= 0) {
+        return -1.0;
+    }
+
+    unsigned long delta = cur[a] - vmstat_prev[a];
+    if (b >= 0) delta += cur[b] - vmstat_prev[b];
+    return (double)delta / elapsed;
+}
+
+static void read_vmstat(memory_info_t *memory) {
+    unsigned long cur[VM_KEYS];
+    struct timespec now;
+
+    memory->pgfault_per_sec = memory->pgmajfault_per_sec = -1.0;
+    memory->pswpin_per_sec = memory->pswpout_per_sec = -1.0;
+    memory->pgscan_per_sec = memory->pgsteal_per_sec = -1.0;
+    memory->compact_stall_per_sec = memory->numa_miss_per_sec = -1.0;
+    memory->oom_kills = -1;
+
+    if (proc_file_read(&vmstat_file) < 0) return;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec + now.tv_nsec / 1e9;
+    double elapsed = time - vmstat_time;
+
+    memset(cur, 0, sizeof(cur));
+    uint64_t present = parse_keyed(&vmstat_table, vmstat_file.buf, cur);
+
+    memory->pgfault_per_sec = vmstat_rate(cur, present, VM_PGFAULT, -1, elapsed);
+    memory->pgmajfault_per_sec = vmstat_rate(cur, present, VM_PGMAJFAULT, -1, elapsed);
+    memory->pswpin_per_sec = vmstat_rate(cur, present, VM_PSWPIN, -1, elapsed);
+    memory->pswpout_per_sec = vmstat_rate(cur, present, VM_PSWPOUT, -1, elapsed);
+    memory->pgscan_per_sec = vmstat_rate(cur, present, VM_PGSCAN_KSWAPD, VM_PGSCAN_DIRECT,
+                                         elapsed);
+    memory->pgsteal_per_sec = vmstat_rate(cur, present, VM_PGSTEAL_KSWAPD, VM_PGSTEAL_DIRECT,
+                                          elapsed);
+    memory->compact_stall_per_sec = vmstat_rate(cur, present, VM_COMPACT_STALL, -1, elapsed);
+    memory->numa_miss_per_sec = vmstat_rate(cur, present, VM_NUMA_MISS, -1, elapsed);
+    if ((present & vmstat_prev_present) & (1ull << VM_OOM_KILL)) {
+        memory->oom_kills = (long long)(cur[VM_OOM_KILL] - vmstat_prev[VM_OOM_KILL]);
+    }
+
+    memcpy(vmstat_prev, cur, sizeof(cur));
+    vmstat_prev_present = present;
+    vmstat_time = time;
+}
+
 int read_memory_info(memory_info_t *memory) {
-    FILE *fp;
-    char line[MAX_LINE_LEN];
-    char key[64];
-    unsigned long value;
+    unsigned long values[MI_KEYS];
 
     memset(memory, 0, sizeof(memory_info_t));
 
     // Read memory information from /proc/meminfo
-    fp = fopen("/proc/meminfo", "r");
-    if (!fp) {
-        perror("Error opening /proc/meminfo");
+    if (proc_file_read(&meminfo_file) < 0) {
+        perror("Error reading /proc/meminfo");
         return -1;
     }
 
-    // Parse each line of /proc/meminfo
-    while (fgets(line, sizeof(line), fp)) {
-        if (sscanf(line, "%63s %lu", key, &value) == 2) {
-            // Extract relevant memory statistics
-            if (strcmp(key, "MemTotal:") == 0) {
-                memory->total = value;
-            } else if (strcmp(key, "MemFree:") == 0) {
-                memory->free = value;
-            } else if (strcmp(key, "MemAvailable:") == 0) {
-                memory->available = value;
-            } else if (strcmp(key, "Buffers:") == 0) {
-                memory->buffers = value;
-            } else if (strcmp(key, "Cached:") == 0) {
-                memory->cached = value;
-            } else if (strcmp(key, "SwapTotal:") == 0) {
-                memory->swap_total = value;
-            } else if (strcmp(key, "SwapFree:") == 0) {
-                memory->swap_free = value;
-            }
-        }
-    }
-    fclose(fp);
+    memset(values, 0, sizeof(values));
+    parse_keyed(&meminfo_table, meminfo_file.buf, values);
+
+    memory->total = values[MI_TOTAL];
+    memory->free = values[MI_FREE];
+    memory->available = values[MI_AVAILABLE];
+    memory->buffers = values[MI_BUFFERS];
+    memory->cached = values[MI_CACHED];
+    memory->swap_total = values[MI_SWAP_TOTAL];
+    memory->swap_free = values[MI_SWAP_FREE];
+    memory->shmem = values[MI_SHMEM];
+    memory->slab_reclaimable = values[MI_SRECLAIMABLE];
+    memory->slab_unreclaimable = values[MI_SUNRECLAIM];
+    memory->dirty = values[MI_DIRTY];
+    memory->writeback = values[MI_WRITEBACK];
+    memory->anon = values[MI_ANON];
+    memory->file = values[MI_ACTIVE_FILE] + values[MI_INACTIVE_FILE];
+    memory->hugepages_total = values[MI_HUGE_TOTAL];
+    memory->hugepages_free = values[MI_HUGE_FREE];
+    memory->hugepage_size = values[MI_HUGE_SIZE];
 
     // Calculate derived memory statistics
-    memory->used = memory->total - memory->free - memory->buffers - memory->cached;
+    memory->used = used_kb(memory->total, memory->free, memory->buffers, memory->cached,
+                           memory->slab_reclaimable, memory->shmem);
     memory->swap_used = memory->swap_total - memory->swap_free;
 
     // Calculate usage percentages
@@ -51,5 +317,7 @@ int read_memory_info(memory_info_t *memory) {
         memory->swap_percent = (double)memory->swap_used * 100.0 / memory->swap_total;
     }
 
+    read_vmstat(memory);
+    read_nodes(memory);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,241 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+
+// Network collector: per-interface rates from /proc/net/dev counter deltas
+// and, on request, TCP socket counts per state.
+//
+// The socket counts come from a NETLINK_SOCK_DIAG dump instead of
+// /proc/net/tcp{,6}: the kernel sends fixed-size binary records with no
+// text formatting and no address columns to parse, which stays cheap at
+// hundreds of thousands of sockets.
+
+// /proc/net/dev counters used per interface, in file order after "name:"
+enum {
+    ND_RX_BYTES,
+    ND_RX_PACKETS,
+    ND_RX_ERRORS,
+    ND_RX_DROPS,
+    ND_RX_FIFO,
+    ND_RX_FRAME,
+    ND_RX_COMPRESSED,
+    ND_RX_MULTICAST,
+    ND_TX_BYTES,
+    ND_TX_PACKETS,
+    ND_TX_ERRORS,
+    ND_TX_DROPS,
+    ND_FIELDS
+};
+
+typedef struct {
+    char name[32];
+    int has_prev;                       // prev holds the counters of the last sample
+    int seen;                           // Listed in the current sample
+    unsigned long prev[ND_FIELDS];
+} net_state_t;
+
+static proc_file_t net_dev_file = PROC_FILE_INIT("/proc/net/dev");
+static net_state_t *net_states = NULL;
+static int net_state_count = 0;
+static int net_state_cap = 0;
+static net_if_t *interfaces = NULL;     // Handed out in net_info_t
+static int interface_cap = 0;
+static double net_dev_time = 0.0;       // CLOCK_MONOTONIC time of the last sample
+
+// Persistent sock_diag socket and its receive buffer
+#define SOCK_DIAG_BUF_SIZE 65536
+static int diag_fd = -1;
+static char *diag_buf = NULL;
+
+// Kernel TCP state numbers past the exported ones (include/net/tcp_states.h)
+#define TCP_STATE_SYN_RECV     3
+#define TCP_STATE_NEW_SYN_RECV 12       // Request socket of a listener
+
+static const char *tcp_state_names[NET_TCP_STATES] = {
+    "", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2",
+    "TIME_WAIT", "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING",
+};
+
+const char *net_tcp_state_name(int state) {
+    return state > 0 && state < NET_TCP_STATES ? tcp_state_names[state] : "";
+}
+
+// Finds or adds the state of an interface; hint is where it was last time
+static net_state_t *net_state(const char *name, size_t len, int hint) {
+    if (len >= sizeof(net_states[0].name)) len = sizeof(net_states[0].name) - 1;
+
+    if (hint < net_state_count && strncmp(net_states[hint].name, name, len) == 0 &&
+        net_states[hint].name[len] == '\0') {
+        return &net_states[hint];
+    }
+    for (int i = 0; i < net_state_count; i++) {
+        if (strncmp(net_states[i].name, name, len) == 0 && net_states[i].name[len] == '\0') {
+            return &net_states[i];
+        }
+    }
+
+    net_state_t *grown = grow_array(net_states, &net_state_cap, net_state_count + 1,
+                                    sizeof(net_state_t));
+    if (!grown) return NULL;
+    net_states = grown;
+    net_state_t *ns = &net_states[net_state_count++];
+    memset(ns, 0, sizeof(net_state_t));
+    memcpy(ns->name, name, len);
+    return ns;
+}
+
+// Samples /proc/net/dev into the public interface array; returns its length.
+// Lines after the two header lines look like
+//   "  eth0: 1234 56 0 0 0 0 0 0 7890 12 0 0 0 0 0 0"
+static int update_interfaces(net_info_t *net) {
+    struct timespec now;
+
+    if (proc_file_read(&net_dev_file) < 0) return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec + now.tv_nsec / 1e9;
+    double elapsed = time - net_dev_time;
+    net_dev_time = time;
+
+    for (int i = 0; i < net_state_count; i++) net_states[i].seen = 0;
+
+    const char *line = scan_next_line(scan_next_line(net_dev_file.buf));
+    int index = 0, count = 0;
+
+    for (; *line; line = scan_next_line(line), index++) {
+        const char *name = scan_skip_spaces(line);
+        const char *colon = strchr(name, ':');
+        const char *eol = strchr(name, '\n');
+        if (!colon || (eol && colon > eol)) continue;
+
+        unsigned long cur[ND_FIELDS];
+        const char *p = colon + 1;
+        int f;
+        for (f = 0; f < ND_FIELDS && (p = scan_ulong(p, &cur[f])) != NULL; f++) {
+        }
+        if (f < ND_FIELDS) continue;
+
+        net_state_t *ns = net_state(name, (size_t)(colon - name), index);
+        if (!ns) continue;
+        ns->seen = 1;
+
+        if (ns->has_prev && elapsed > 0) {
+            net_if_t *grown = grow_array(interfaces, &interface_cap, count + 1, sizeof(net_if_t));
+            if (!grown) return -1;
+            interfaces = grown;
+            net_if_t *nif = &interfaces[count++];
+            memcpy(nif->name, ns->name, sizeof(nif->name));
+            nif->rx_bytes_per_sec = (cur[ND_RX_BYTES] - ns->prev[ND_RX_BYTES]) / elapsed;
+            nif->tx_bytes_per_sec = (cur[ND_TX_BYTES] - ns->prev[ND_TX_BYTES]) / elapsed;
+            nif->rx_packets_per_sec = (cur[ND_RX_PACKETS] - ns->prev[ND_RX_PACKETS]) / elapsed;
+            nif->tx_packets_per_sec = (cur[ND_TX_PACKETS] - ns->prev[ND_TX_PACKETS]) / elapsed;
+            nif->rx_drops_per_sec = (cur[ND_RX_DROPS] - ns->prev[ND_RX_DROPS]) / elapsed;
+            nif->tx_drops_per_sec = (cur[ND_TX_DROPS] - ns->prev[ND_TX_DROPS]) / elapsed;
+            nif->rx_errors_per_sec = (cur[ND_RX_ERRORS] - ns->prev[ND_RX_ERRORS]) / elapsed;
+            nif->tx_errors_per_sec = (cur[ND_TX_ERRORS] - ns->prev[ND_TX_ERRORS]) / elapsed;
+
+            if (strcmp(nif->name, "lo") != 0) {
+                net->rx_bytes_per_sec += nif->rx_bytes_per_sec;
+                net->tx_bytes_per_sec += nif->tx_bytes_per_sec;
+            }
+        }
+        memcpy(ns->prev, cur, sizeof(ns->prev));
+        ns->has_prev = 1;
+    }
+
+    // Interfaces that went away start over if they come back
+    for (int i = 0; i < net_state_count; i++) {
+        if (!net_states[i].seen) net_states[i].has_prev = 0;
+    }
+    return count;
+}
+
+// Opens the sock_diag socket on first use
+static int sock_diag_open(void) {
+    if (diag_fd >= 0) return 0;
+
+    diag_buf = diag_buf ? diag_buf : malloc(SOCK_DIAG_BUF_SIZE);
+    if (!diag_buf) return -1;
+
+    diag_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    selfstat_io(1, 0);
+    return diag_fd >= 0 ? 0 : -1;
+}
+
+// Dumps every TCP socket of one address family and counts them per state
+static int sock_diag_count(int family, uint32_t *states) {
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } request;
+    struct sockaddr_nl kernel = {.nl_family = AF_NETLINK};
+
+    memset(&request, 0, sizeof(request));
+    request.nlh.nlmsg_len = sizeof(request);
+    request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.nlh.nlmsg_seq = (uint32_t)family;
+    request.req.sdiag_family = (uint8_t)family;
+    request.req.sdiag_protocol = IPPROTO_TCP;
+    request.req.idiag_states = ~0u;        // Every state, TIME_WAIT included
+    request.req.idiag_ext = 0;             // No extensions: only the state is used
+
+    ssize_t sent = sendto(diag_fd, &request, sizeof(request), 0,
+                          (struct sockaddr *)&kernel, sizeof(kernel));
+    selfstat_io(1, sent > 0 ? (unsigned long)sent : 0);
+    if (sent != (ssize_t)sizeof(request)) return -1;
+
+    for (;;) {
+        ssize_t got = recv(diag_fd, diag_buf, SOCK_DIAG_BUF_SIZE, 0);
+        selfstat_io(1, got > 0 ? (unsigned long)got : 0);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        int len = (int)got;
+        for (struct nlmsghdr *h = (struct nlmsghdr *)diag_buf; NLMSG_OK(h, len);
+             h = NLMSG_NEXT(h, len)) {
+            if (h->nlmsg_type == NLMSG_DONE) return 0;
+            if (h->nlmsg_type == NLMSG_ERROR) return -1;
+            if (h->nlmsg_type != SOCK_DIAG_BY_FAMILY) continue;
+
+            const struct inet_diag_msg *msg = NLMSG_DATA(h);
+            int state = msg->idiag_state;
+            if (state == TCP_STATE_NEW_SYN_RECV) state = TCP_STATE_SYN_RECV;
+            if (state > 0 && state < NET_TCP_STATES) states[state]++;
+        }
+    }
+}
+
+int read_net_info(net_info_t *net, int tcp_states) {
+    memset(net, 0, sizeof(net_info_t));
+
+    int count = update_interfaces(net);
+    if (count < 0) {
+        perror("Error reading /proc/net/dev");
+        return -1;
+    }
+    net->interfaces = interfaces;
+    net->interface_count = count;
+
+    // Socket counts are optional: without them the interface rates still stand
+    if (tcp_states && sock_diag_open() == 0) {
+        // Kernels without IPv6 reject the second dump; IPv4 alone is fine
+        int v4 = sock_diag_count(AF_INET, net->tcp_states);
+        int v6 = v4 == 0 ? sock_diag_count(AF_INET6, net->tcp_states) : -1;
+
+        net->tcp_valid = v4 == 0;
+        if (!net->tcp_valid) memset(net->tcp_states, 0, sizeof(net->tcp_states));
+        if (v4 != 0 || v6 != 0) {
+            // A failed dump may leave replies queued: start over next time
+            close(diag_fd);
+            diag_fd = -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1545 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+
+// Serializers for the machine-readable output formats. Every sample is
+// composed into one buffer by hand-written formatters and emitted with
+// write(), so no printf runs per field and no color codes are produced.
+// A memory writer keeps the bytes instead, for the --serve snapshots.
+
+#define OUTPUT_BUF_SIZE 65536
+// Record bytes per core: usage, iowait, steal and irq
+#define CORE_RECORD_SIZE (4 * sizeof(double))
+
+int output_open(out_writer_t *w, const char *path) {
+    memset(w, 0, sizeof(out_writer_t));
+
+    if (path) {
+        w->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (w->fd < 0) return -1;
+        w->owns_fd = 1;
+    } else {
+        w->fd = STDOUT_FILENO;
+    }
+
+    w->buf = malloc(OUTPUT_BUF_SIZE);
+    if (!w->buf) {
+        output_close(w);
+        return -1;
+    }
+    w->cap = OUTPUT_BUF_SIZE;
+    return 0;
+}
+
+// Opens a writer that accumulates everything in its buffer
+int output_open_memory(out_writer_t *w) {
+    memset(w, 0, sizeof(out_writer_t));
+    w->fd = -1;
+
+    w->buf = malloc(OUTPUT_BUF_SIZE);
+    if (!w->buf) return -1;
+    w->cap = OUTPUT_BUF_SIZE;
+    return 0;
+}
+
+// A memory writer doubles its buffer once it is half full
+static int output_grow(out_writer_t *w) {
+    if (w->len < w->cap / 2) return 0;
+
+    char *bigger = realloc(w->buf, w->cap * 2);
+    if (!bigger) {
+        w->len = 0;
+        return -1;
+    }
+    w->buf = bigger;
+    w->cap *= 2;
+    return 0;
+}
+
+// Writes out everything buffered so far
+int output_flush(out_writer_t *w) {
+    size_t done = 0;
+
+    if (w->fd < 0) return output_grow(w);
+
+    while (done < w->len) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+        selfstat_io(1, n > 0 ? (unsigned long)n : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            w->len = 0;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    w->len = 0;
+    return 0;
+}
+
+void output_close(out_writer_t *w) {
+    if (w->buf && w->fd >= 0) output_flush(w);
+    if (w->owns_fd && w->fd >= 0) close(w->fd);
+    free(w->buf);
+    memset(w, 0, sizeof(out_writer_t));
+    w->fd = -1;
+}
+
+void out_bytes(out_writer_t *w, const void *data, size_t n) {
+    const char *src = data;
+
+    while (n > 0) {
+        if (w->len == w->cap && output_flush(w) != 0) return;
+
+        size_t room = w->cap - w->len;
+        size_t chunk = n < room ? n : room;
+        memcpy(w->buf + w->len, src, chunk);
+        w->len += chunk;
+        src += chunk;
+        n -= chunk;
+    }
+}
+
+void out_str(out_writer_t *w, const char *s) {
+    out_bytes(w, s, strlen(s));
+}
+
+void out_char(out_writer_t *w, char c) {
+    if (w->len == w->cap && output_flush(w) != 0) return;
+    w->buf[w->len++] = c;
+}
+
+void out_u64(out_writer_t *w, unsigned long long v) {
+    char digits[24];
+    int n = 0;
+
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+
+    while (n > 0) out_char(w, digits[--n]);
+}
+
+void out_i64(out_writer_t *w, long long v) {
+    if (v < 0) {
+        out_char(w, '-');
+        out_u64(w, (unsigned long long)-(v + 1) + 1);
+    } else {
+        out_u64(w, (unsigned long long)v);
+    }
+}
+
+// Writes a double with a fixed number of decimals (at most 6).
+// Non-finite values are written as null and huge values drop their fraction.
+void out_fixed(out_writer_t *w, double v, int decimals) {
+    static const double scale[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+    if (v != v || v > 1e300 || v < -1e300) {
+        out_str(w, "null");
+        return;
+    }
+    if (v < 0) {
+        out_char(w, '-');
+        v = -v;
+    }
+    if (decimals > 6) decimals = 6;
+    if (v >= 1e15) {
+        out_u64(w, (unsigned long long)v);
+        return;
+    }
+
+    unsigned long long scaled = (unsigned long long)(v * scale[decimals] + 0.5);
+    unsigned long long whole = scaled / (unsigned long long)scale[decimals];
+    unsigned long long frac = scaled % (unsigned long long)scale[decimals];
+
+    out_u64(w, whole);
+    if (decimals > 0) {
+        char digits[8];
+        out_char(w, '.');
+        for (int i = decimals - 1; i >= 0; i--) {
+            digits[i] = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        out_bytes(w, digits, (size_t)decimals);
+    }
+}
+
+// Writes a JSON string literal, escaping quotes, backslashes and controls
+void out_json_string(out_writer_t *w, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+
+    out_char(w, '"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            out_char(w, '\\');
+            out_char(w, (char)c);
+        } else if (c < 0x20) {
+            out_str(w, "\\u00");
+            out_char(w, hex[c >> 4]);
+            out_char(w, hex[c & 0xf]);
+        } else {
+            out_char(w, (char)c);
+        }
+    }
+    out_char(w, '"');
+}
+
+// Writes a CSV field, quoting it when it contains separators or quotes
+static void out_csv_string(out_writer_t *w, const char *s) {
+    if (!strpbrk(s, ",\"\n\r")) {
+        out_str(w, s);
+        return;
+    }
+
+    out_char(w, '"');
+    for (; *s; s++) {
+        if (*s == '"') out_char(w, '"');
+        out_char(w, *s);
+    }
+    out_char(w, '"');
+}
+
+// JSON helpers: "key": value with a leading comma when not the first member
+static void json_key(out_writer_t *w, const char *key, int first) {
+    if (!first) out_char(w, ',');
+    out_char(w, '"');
+    out_str(w, key);
+    out_str(w, "\":");
+}
+
+static void json_u64(out_writer_t *w, const char *key, unsigned long long v, int first) {
+    json_key(w, key, first);
+    out_u64(w, v);
+}
+
+// Writes a rate that is negative when it was not sampled as null
+static void json_optional(out_writer_t *w, const char *key, double v) {
+    json_key(w, key, 0);
+    if (v >= 0) {
+        out_fixed(w, v, 2);
+    } else {
+        out_str(w, "null");
+    }
+}
+
+// Writes a count that is negative when it could not be read as null
+static void json_optional_u64(out_writer_t *w, const char *key, long long v) {
+    json_key(w, key, 0);
+    if (v >= 0) {
+        out_u64(w, (unsigned long long)v);
+    } else {
+        out_str(w, "null");
+    }
+}
+
+static void json_fixed(out_writer_t *w, const char *key, double v, int first) {
+    json_key(w, key, first);
+    out_fixed(w, v, 2);
+}
+
+// Writes one "some" or "full" line of a pressure file as an object
+static void json_psi_line(out_writer_t *w, const psi_line_t *line) {
+    out_char(w, '{');
+    json_fixed(w, "avg10", line->avg10, 1);
+    json_fixed(w, "avg60", line->avg60, 0);
+    json_fixed(w, "avg300", line->avg300, 0);
+    json_optional(w, "stall_percent", line->stall_percent);
+    json_u64(w, "total_usec", line->total_usec, 0);
+    out_char(w, '}');
+}
+
+static void write_jsonl(out_writer_t *w, const system_info_t *info) {
+    out_char(w, '{');
+    json_fixed(w, "timestamp", info->timestamp, 1);
+
+    if (info->valid_flags & SHOW_CPU) {
+        const cpu_info_t *cpu = &info->cpu;
+        json_key(w, "cpu", 0);
+        out_char(w, '{');
+        json_key(w, "model", 1);
+        out_json_string(w, cpu->model);
+        json_u64(w, "cores", (unsigned long long)cpu->cores, 0);
+        json_u64(w, "online", (unsigned long long)cpu->online, 0);
+        json_fixed(w, "total_usage", cpu->total_usage, 0);
+        json_fixed(w, "iowait", cpu->iowait_percent, 0);
+        json_fixed(w, "steal", cpu->steal_percent, 0);
+        json_fixed(w, "irq", cpu->irq_percent, 0);
+        json_fixed(w, "temperature", cpu->temperature, 0);
+        json_key(w, "usage", 0);
+        out_char(w, '[');
+        for (int i = 0; i < cpu->cores; i++) {
+            if (i > 0) out_char(w, ',');
+            if (cpu->usage[i] < 0) {
+                out_str(w, "null");         // Offline core
+            } else {
+                out_fixed(w, cpu->usage[i], 2);
+            }
+        }
+        out_str(w, "]}");
+    }
+
+    if (info->valid_flags & SHOW_MEMORY) {
+        const memory_info_t *mem = &info->memory;
+        json_key(w, "memory", 0);
+        out_char(w, '{');
+        json_u64(w, "total_kb", mem->total, 1);
+        json_u64(w, "available_kb", mem->available, 0);
+        json_u64(w, "used_kb", mem->used, 0);
+        json_u64(w, "free_kb", mem->free, 0);
+        json_u64(w, "buffers_kb", mem->buffers, 0);
+        json_u64(w, "cached_kb", mem->cached, 0);
+        json_u64(w, "swap_total_kb", mem->swap_total, 0);
+        json_u64(w, "swap_used_kb", mem->swap_used, 0);
+        json_u64(w, "swap_free_kb", mem->swap_free, 0);
+        json_fixed(w, "usage_percent", mem->usage_percent, 0);
+        json_fixed(w, "swap_percent", mem->swap_percent, 0);
+        json_u64(w, "shmem_kb", mem->shmem, 0);
+        json_u64(w, "slab_reclaimable_kb", mem->slab_reclaimable, 0);
+        json_u64(w, "slab_unreclaimable_kb", mem->slab_unreclaimable, 0);
+        json_u64(w, "dirty_kb", mem->dirty, 0);
+        json_u64(w, "writeback_kb", mem->writeback, 0);
+        json_u64(w, "anon_kb", mem->anon, 0);
+        json_u64(w, "file_kb", mem->file, 0);
+        json_u64(w, "hugepages_total", mem->hugepages_total, 0);
+        json_u64(w, "hugepages_free", mem->hugepages_free, 0);
+        json_u64(w, "hugepage_size_kb", mem->hugepage_size, 0);
+        json_optional(w, "pgfault_per_sec", mem->pgfault_per_sec);
+        json_optional(w, "pgmajfault_per_sec", mem->pgmajfault_per_sec);
+        json_optional(w, "pswpin_per_sec", mem->pswpin_per_sec);
+        json_optional(w, "pswpout_per_sec", mem->pswpout_per_sec);
+        json_optional(w, "pgscan_per_sec", mem->pgscan_per_sec);
+        json_optional(w, "pgsteal_per_sec", mem->pgsteal_per_sec);
+        json_optional(w, "compact_stall_per_sec", mem->compact_stall_per_sec);
+        json_optional(w, "numa_miss_per_sec", mem->numa_miss_per_sec);
+        json_optional_u64(w, "oom_kills", mem->oom_kills);
+        json_key(w, "numa", 0);
+        out_char(w, '[');
+        for (int i = 0; i < mem->numa_count; i++) {
+            const numa_node_t *node = &mem->numa[i];
+            if (i > 0) out_char(w, ',');
+            out_char(w, '{');
+            json_u64(w, "node", (unsigned long long)node->id, 1);
+            json_u64(w, "total_kb", node->total_kb, 0);
+            json_u64(w, "free_kb", node->free_kb, 0);
+            json_u64(w, "used_kb", node->used_kb, 0);
+            json_u64(w, "file_kb", node->file_kb, 0);
+            json_u64(w, "anon_kb", node->anon_kb, 0);
+            json_fixed(w, "usage_percent", node->usage_percent, 0);
+            out_char(w, '}');
+        }
+        out_str(w, "]}");
+    }
+
+    if (info->valid_flags & SHOW_UPTIME) {
+        json_key(w, "uptime", 0);
+        out_char(w, '{');
+        json_u64(w, "seconds", info->uptime.uptime_seconds, 1);
+        out_char(w, '}');
+    }
+
+    if (info->valid_flags & SHOW_DISK) {
+        const disk_info_t *disk = &info->disk;
+        json_key(w, "disk", 0);
+        out_char(w, '{');
+        json_key(w, "filesystem", 1);
+        out_json_string(w, disk->filesystem);
+        json_u64(w, "total_bytes", disk->total_bytes, 0);
+        json_u64(w, "used_bytes", disk->used_bytes, 0);
+        json_u64(w, "available_bytes", disk->available_bytes, 0);
+        json_fixed(w, "usage_percent", disk->usage_percent, 0);
+        json_key(w, "mounts", 0);
+        out_char(w, '[');
+        for (int i = 0; i < disk->mount_count; i++) {
+            const mount_info_t *m = &disk->mounts[i];
+            if (i > 0) out_char(w, ',');
+            out_char(w, '{');
+            json_key(w, "mount_point", 1);
+            out_json_string(w, m->mount_point);
+            json_key(w, "device", 0);
+            out_json_string(w, m->device);
+            json_key(w, "fstype", 0);
+            out_json_string(w, m->fstype);
+            json_u64(w, "total_bytes", m->total_bytes, 0);
+            json_u64(w, "used_bytes", m->used_bytes, 0);
+            json_u64(w, "available_bytes", m->available_bytes, 0);
+            json_fixed(w, "usage_percent", m->usage_percent, 0);
+            out_char(w, '}');
+        }
+        out_char(w, ']');
+        json_key(w, "devices", 0);
+        out_char(w, '[');
+        for (int i = 0; i < disk->device_count; i++) {
+            const disk_io_t *d = &disk->devices[i];
+            if (i > 0) out_char(w, ',');
+            out_char(w, '{');
+            json_key(w, "name", 1);
+            out_json_string(w, d->name);
+            json_fixed(w, "read_iops", d->read_iops, 0);
+            json_fixed(w, "write_iops", d->write_iops, 0);
+            json_fixed(w, "read_bytes_per_sec", d->read_bytes_per_sec, 0);
+            json_fixed(w, "write_bytes_per_sec", d->write_bytes_per_sec, 0);
+            json_fixed(w, "queue_depth", d->queue_depth, 0);
+            json_fixed(w, "await_ms", d->await_ms, 0);
+            json_fixed(w, "util_percent", d->util_percent, 0);
+            out_char(w, '}');
+        }
+        out_str(w, "]}");
+    }
+
+    if (info->valid_flags & SHOW_NET) {
+        const net_info_t *net = &info->net;
+        json_key(w, "net", 0);
+        out_char(w, '{');
+        json_fixed(w, "rx_bytes_per_sec", net->rx_bytes_per_sec, 1);
+        json_fixed(w, "tx_bytes_per_sec", net->tx_bytes_per_sec, 0);
+        json_key(w, "interfaces", 0);
+        out_char(w, '[');
+        for (int i = 0; i < net->interface_count; i++) {
+            const net_if_t *nif = &net->interfaces[i];
+            if (i > 0) out_char(w, ',');
+            out_char(w, '{');
+            json_key(w, "name", 1);
+            out_json_string(w, nif->name);
+            json_fixed(w, "rx_bytes_per_sec", nif->rx_bytes_per_sec, 0);
+            json_fixed(w, "tx_bytes_per_sec", nif->tx_bytes_per_sec, 0);
+            json_fixed(w, "rx_packets_per_sec", nif->rx_packets_per_sec, 0);
+            json_fixed(w, "tx_packets_per_sec", nif->tx_packets_per_sec, 0);
+            json_fixed(w, "rx_drops_per_sec", nif->rx_drops_per_sec, 0);
+            json_fixed(w, "tx_drops_per_sec", nif->tx_drops_per_sec, 0);
+            json_fixed(w, "rx_errors_per_sec", nif->rx_errors_per_sec, 0);
+            json_fixed(w, "tx_errors_per_sec", nif->tx_errors_per_sec, 0);
+            out_char(w, '}');
+        }
+        out_char(w, ']');
+        if (net->tcp_valid) {
+            json_key(w, "tcp_states", 0);
+            out_char(w, '{');
+            for (int state = 1; state < NET_TCP_STATES; state++) {
+                json_u64(w, net_tcp_state_name(state), net->tcp_states[state], state == 1);
+            }
+            out_char(w, '}');
+        }
+        out_char(w, '}');
+    }
+
+    if (info->valid_flags & SHOW_PRESSURE) {
+        const pressure_info_t *pressure = &info->pressure;
+        json_key(w, "pressure", 0);
+        out_str(w, pressure->burst ? "{\"burst\":true" : "{\"burst\":false");
+        for (int r = 0; r < PSI_RESOURCES; r++) {
+            const psi_info_t *psi = &pressure->resources[r];
+            json_key(w, psi_resource_name(r), 0);
+            out_char(w, '{');
+            json_key(w, "some", 1);
+            json_psi_line(w, &psi->some);
+            json_key(w, "full", 0);
+            if (psi->has_full) {
+                json_psi_line(w, &psi->full);
+            } else {
+                out_str(w, "null");
+            }
+            json_optional_u64(w, "stalls", psi->armed ? (long long)psi->stalls : -1);
+            out_char(w, '}');
+        }
+        out_char(w, '}');
+    }
+
+    if (info->valid_flags & SHOW_SENSORS) {
+        json_key(w, "sensors", 0);
+        out_char(w, '[');
+        for (int i = 0; i < info->sensors.count; i++) {
+            const sensor_t *sensor = &info->sensors.sensors[i];
+            if (i > 0) out_char(w, ',');
+            out_char(w, '{');
+            json_key(w, "chip", 1);
+            out_json_string(w, sensor->chip);
+            json_key(w, "label", 0);
+            out_json_string(w, sensor->label);
+            json_key(w, "kind", 0);
+            out_json_string(w, sensor_kind_name((sensor_kind_t)sensor->kind));
+            json_optional_u64(w, "package", sensor->package);
+            json_optional_u64(w, "core", sensor->core);
+            // Temperatures may be below zero, so validity is its own flag
+            json_key(w, "value", 0);
+            if (sensor->valid) {
+                out_fixed(w, sensor->value, 2);
+            } else {
+                out_str(w, "null");
+            }
+            json_optional(w, "max", sensor->max);
+            json_optional(w, "crit", sensor->crit);
+            out_char(w, '}');
+        }
+        out_char(w, ']');
+    }
+
+    if (info->valid_flags & SHOW_CGROUPS) {
+        const cgroup_tree_t *tree = &info->cgroups;
+        json_key(w, "cgroups", 0);
+        out_char(w, '{');
+        json_u64(w, "tracked", (unsigned long long)tree->tracked, 1);
+        json_key(w, "groups", 0);
+        out_char(w, '[');
+        for (int i = 0; i < tree->count; i++) {
+            const cgroup_info_t *cg = &tree->groups[i];
+            if (i > 0) out_char(w, ',');
+            out_char(w, '{');
+            json_key(w, "path", 1);
+            out_json_string(w, cg->path);
+            json_u64(w, "depth", (unsigned long long)cg->depth, 0);
+            json_fixed(w, "cpu_percent", cg->cpu_percent, 0);
+            json_optional(w, "throttled_percent", cg->throttled_percent);
+            json_optional_u64(w, "memory_bytes", cg->memory_bytes);
+            json_optional_u64(w, "anon_bytes", cg->anon_bytes);
+            json_optional_u64(w, "file_bytes", cg->file_bytes);
+            json_fixed(w, "read_bytes_per_sec", cg->read_bytes_per_sec, 0);
+            json_fixed(w, "write_bytes_per_sec", cg->write_bytes_per_sec, 0);
+            json_optional(w, "cpu_pressure", cg->cpu_pressure);
+            json_optional(w, "memory_pressure", cg->memory_pressure);
+            json_optional(w, "io_pressure", cg->io_pressure);
+            out_char(w, '}');
+        }
+        out_str(w, "]}");
+    }
+
+    if (info->valid_flags & SHOW_WINDOWS) {
+        const window_info_t *windows = &info->windows;
+        json_key(w, "windows", 0);
+        out_char(w, '{');
+        for (int i = 0; i < windows->count; i++) {
+            const series_stats_t *series = &windows->series[i];
+            json_key(w, series->name, i == 0);
+            out_char(w, '{');
+            json_fixed(w, "current", series->current, 1);
+            for (int win = 0; win < WINDOW_COUNT; win++) {
+                const window_stats_t *window = &series->windows[win];
+                json_key(w, window_name(win), 0);
+                if (window->count == 0) {
+                    out_str(w, "null");
+                    continue;
+                }
+                out_char(w, '{');
+                json_u64(w, "count", window->count, 1);
+                json_fixed(w, "min", window->min, 0);
+                json_fixed(w, "max", window->max, 0);
+                json_fixed(w, "mean", window->mean, 0);
+                json_fixed(w, "p50", window->p50, 0);
+                json_fixed(w, "p95", window->p95, 0);
+                json_fixed(w, "p99", window->p99, 0);
+                out_char(w, '}');
+            }
+            out_char(w, '}');
+        }
+        out_char(w, '}');
+    }
+
+    if (info->valid_flags & SHOW_PROC) {
+        json_key(w, "processes", 0);
+        out_char(w, '[');
+        for (int i = 0; i < info->process_count; i++) {
+            const process_info_t *proc = &info->top_processes[i];
+            if (i > 0) out_char(w, ',');
+            out_char(w, '{');
+            json_u64(w, "pid", (unsigned long long)proc->pid, 1);
+            json_key(w, "name", 0);
+            out_json_string(w, proc->name);
+            json_fixed(w, "cpu_percent", proc->cpu_percent, 0);
+            json_u64(w, "memory_kb", proc->memory_kb, 0);
+            json_key(w, "pss_kb", 0);
+            if (proc->pss_kb >= 0) {
+                out_u64(w, (unsigned long long)proc->pss_kb);
+            } else {
+                out_str(w, "null");
+            }
+            json_u64(w, "threads", (unsigned long long)proc->threads, 0);
+            json_optional(w, "io_rate", proc->io_rate);
+            json_optional(w, "read_bytes_per_sec", proc->read_bytes_per_sec);
+            json_optional(w, "write_bytes_per_sec", proc->write_bytes_per_sec);
+            json_optional(w, "voluntary_ctxsw_per_sec", proc->voluntary_ctxsw_per_sec);
+            json_optional(w, "involuntary_ctxsw_per_sec", proc->involuntary_ctxsw_per_sec);
+            json_fixed(w, "major_faults_per_sec", proc->major_faults_per_sec, 0);
+            out_char(w, '}');
+        }
+        out_char(w, ']');
+    }
+
+    // Cumulative self-profiling counters of this process, per probe
+    if (selfstat_enabled()) {
+        int first = 1;
+        json_key(w, "self", 0);
+        out_char(w, '{');
+        for (int p = 0; p < PROBE_COUNT; p++) {
+            selfstat_summary_t s;
+            selfstat_summary((selfstat_probe_t)p, &s);
+            if (s.count == 0) continue;
+
+            json_key(w, selfstat_probe_name((selfstat_probe_t)p), first);
+            first = 0;
+            out_char(w, '{');
+            json_u64(w, "count", s.count, 1);
+            json_u64(w, "wall_ns", s.wall_ns, 0);
+            json_u64(w, "cpu_ns", s.cpu_ns, 0);
+            json_u64(w, "syscalls", s.syscalls, 0);
+            json_u64(w, "bytes", s.bytes, 0);
+            json_u64(w, "max_ns", s.max_ns, 0);
+            json_u64(w, "p50_ns", s.p50_ns, 0);
+            json_u64(w, "p99_ns", s.p99_ns, 0);
+            out_char(w, '}');
+        }
+        out_char(w, '}');
+    }
+
+    out_str(w, "}\n");
+}
+
+// Columns of each process slot; rows pad a missing process with as many
+// empty cells
+static const char *proc_csv_columns[] = {
+    "pid", "name", "cpu_percent", "memory_kb", "pss_kb", "threads", "io_rate",
+    "read_bytes_per_sec", "write_bytes_per_sec", "voluntary_ctxsw_per_sec",
+    "involuntary_ctxsw_per_sec", "major_faults_per_sec",
+};
+#define PROC_CSV_COLUMNS (sizeof(proc_csv_columns) / sizeof(proc_csv_columns[0]))
+
+// The CSV column set is fixed by the first sample (core and process counts)
+static void write_csv_header(out_writer_t *w, const system_info_t *info) {
+    out_str(w, "timestamp");
+
+    if (info->valid_flags & SHOW_CPU) {
+        out_str(w, ",cpu_total_usage,cpu_iowait,cpu_steal,cpu_irq,cpu_temperature");
+        for (int i = 0; i < info->cpu.cores; i++) {
+            out_str(w, ",cpu");
+            out_u64(w, (unsigned long long)i);
+            out_str(w, "_usage");
+        }
+    }
+    if (info->valid_flags & SHOW_MEMORY) {
+        out_str(w, ",mem_total_kb,mem_available_kb,mem_used_kb,mem_free_kb,mem_buffers_kb,"
+                   "mem_cached_kb,swap_total_kb,swap_used_kb,swap_free_kb,mem_usage_percent,"
+                   "swap_percent,mem_shmem_kb,mem_slab_reclaimable_kb,mem_slab_unreclaimable_kb,"
+                   "mem_dirty_kb,mem_writeback_kb,mem_anon_kb,mem_file_kb,pgfault_per_sec,"
+                   "pgmajfault_per_sec,pswpin_per_sec,pswpout_per_sec,pgscan_per_sec,"
+                   "pgsteal_per_sec,compact_stall_per_sec,oom_kills");
+    }
+    if (info->valid_flags & SHOW_UPTIME) {
+        out_str(w, ",uptime_seconds");
+    }
+    if (info->valid_flags & SHOW_DISK) {
+        out_str(w, ",disk_total_bytes,disk_used_bytes,disk_available_bytes,disk_usage_percent");
+    }
+    if (info->valid_flags & SHOW_NET) {
+        out_str(w, ",net_rx_bytes_per_sec,net_tx_bytes_per_sec");
+    }
+    if (info->valid_flags & SHOW_PRESSURE) {
+        for (int r = 0; r < PSI_RESOURCES; r++) {
+            static const char *columns[] = {
+                "some_avg10", "some_avg60", "some_stall", "full_avg10", "full_avg60", "full_stall",
+            };
+            for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); c++) {
+                out_str(w, ",psi_");
+                out_str(w, psi_resource_name(r));
+                out_char(w, '_');
+                out_str(w, columns[c]);
+            }
+        }
+        out_str(w, ",psi_burst");
+    }
+    if (info->valid_flags & SHOW_PROC) {
+        for (int i = 0; i < info->process_count; i++) {
+            for (size_t c = 0; c < PROC_CSV_COLUMNS; c++) {
+                out_str(w, ",proc");
+                out_u64(w, (unsigned long long)i);
+                out_char(w, '_');
+                out_str(w, proc_csv_columns[c]);
+            }
+        }
+    }
+    out_char(w, '\n');
+}
+
+static void write_csv_row(out_writer_t *w, const system_info_t *info) {
+    out_fixed(w, info->timestamp, 2);
+
+    if (w->csv_flags & SHOW_CPU) {
+        const cpu_info_t *cpu = &info->cpu;
+        out_char(w, ',');
+        out_fixed(w, cpu->total_usage, 2);
+        out_char(w, ',');
+        out_fixed(w, cpu->iowait_percent, 2);
+        out_char(w, ',');
+        out_fixed(w, cpu->steal_percent, 2);
+        out_char(w, ',');
+        out_fixed(w, cpu->irq_percent, 2);
+        out_char(w, ',');
+        out_fixed(w, cpu->temperature, 2);
+        for (int i = 0; i < w->csv_cores; i++) {
+            out_char(w, ',');
+            // Offline or unplugged cores leave the cell empty
+            if (i < cpu->cores && cpu->usage[i] >= 0) out_fixed(w, cpu->usage[i], 2);
+        }
+    }
+    if (w->csv_flags & SHOW_MEMORY) {
+        const memory_info_t *mem = &info->memory;
+        const unsigned long fields[] = {
+            mem->total, mem->available, mem->used, mem->free, mem->buffers,
+            mem->cached, mem->swap_total, mem->swap_used, mem->swap_free
+        };
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+            out_char(w, ',');
+            out_u64(w, fields[i]);
+        }
+        out_char(w, ',');
+        out_fixed(w, mem->usage_percent, 2);
+        out_char(w, ',');
+        out_fixed(w, mem->swap_percent, 2);
+        const unsigned long breakdown[] = {
+            mem->shmem, mem->slab_reclaimable, mem->slab_unreclaimable, mem->dirty,
+            mem->writeback, mem->anon, mem->file
+        };
+        for (size_t i = 0; i < sizeof(breakdown) / sizeof(breakdown[0]); i++) {
+            out_char(w, ',');
+            out_u64(w, breakdown[i]);
+        }
+        // Rates that need two samples stay empty
+        const double rates[] = {
+            mem->pgfault_per_sec, mem->pgmajfault_per_sec, mem->pswpin_per_sec,
+            mem->pswpout_per_sec, mem->pgscan_per_sec, mem->pgsteal_per_sec,
+            mem->compact_stall_per_sec
+        };
+        for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+            out_char(w, ',');
+            if (rates[i] >= 0) out_fixed(w, rates[i], 2);
+        }
+        out_char(w, ',');
+        if (mem->oom_kills >= 0) out_u64(w, (unsigned long long)mem->oom_kills);
+    }
+    if (w->csv_flags & SHOW_UPTIME) {
+        out_char(w, ',');
+        out_u64(w, info->uptime.uptime_seconds);
+    }
+    if (w->csv_flags & SHOW_DISK) {
+        out_char(w, ',');
+        out_u64(w, info->disk.total_bytes);
+        out_char(w, ',');
+        out_u64(w, info->disk.used_bytes);
+        out_char(w, ',');
+        out_u64(w, info->disk.available_bytes);
+        out_char(w, ',');
+        out_fixed(w, info->disk.usage_percent, 2);
+    }
+    if (w->csv_flags & SHOW_NET) {
+        out_char(w, ',');
+        out_fixed(w, info->net.rx_bytes_per_sec, 2);
+        out_char(w, ',');
+        out_fixed(w, info->net.tx_bytes_per_sec, 2);
+    }
+    if (w->csv_flags & SHOW_PRESSURE) {
+        for (int r = 0; r < PSI_RESOURCES; r++) {
+            const psi_info_t *psi = &info->pressure.resources[r];
+            // Values the kernel does not report or that need two samples stay empty
+            const double values[] = {
+                psi->some.avg10, psi->some.avg60, psi->some.stall_percent,
+                psi->has_full ? psi->full.avg10 : -1.0, psi->has_full ? psi->full.avg60 : -1.0,
+                psi->has_full ? psi->full.stall_percent : -1.0,
+            };
+            for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+                out_char(w, ',');
+                if (values[v] >= 0) out_fixed(w, values[v], 2);
+            }
+        }
+        out_str(w, info->pressure.burst ? ",1" : ",0");
+    }
+    if (w->csv_flags & SHOW_PROC) {
+        for (int i = 0; i < w->csv_processes; i++) {
+            if (i >= info->process_count) {
+                for (size_t c = 0; c < PROC_CSV_COLUMNS; c++) out_char(w, ',');
+                continue;
+            }
+            const process_info_t *proc = &info->top_processes[i];
+            out_char(w, ',');
+            out_u64(w, (unsigned long long)proc->pid);
+            out_char(w, ',');
+            out_csv_string(w, proc->name);
+            out_char(w, ',');
+            out_fixed(w, proc->cpu_percent, 2);
+            out_char(w, ',');
+            out_u64(w, proc->memory_kb);
+            out_char(w, ',');
+            if (proc->pss_kb >= 0) out_u64(w, (unsigned long long)proc->pss_kb);
+            out_char(w, ',');
+            out_u64(w, (unsigned long long)proc->threads);
+            // Rates that were not sampled are left empty
+            const double rates[] = {
+                proc->io_rate, proc->read_bytes_per_sec, proc->write_bytes_per_sec,
+                proc->voluntary_ctxsw_per_sec, proc->involuntary_ctxsw_per_sec,
+                proc->major_faults_per_sec,
+            };
+            for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+                out_char(w, ',');
+                if (rates[r] >= 0) out_fixed(w, rates[r], 2);
+            }
+        }
+    }
+    out_char(w, '\n');
+}
+
+static void write_csv(out_writer_t *w, const system_info_t *info) {
+    if (!w->csv_header_done) {
+        write_csv_header(w, info);
+        w->csv_header_done = 1;
+        w->csv_flags = info->valid_flags;
+        w->csv_cores = info->cpu.cores;
+        w->csv_processes = info->process_count;
+    }
+    write_csv_row(w, info);
+}
+
+// Fills a binary record for the sample and returns its size in bytes.
+// out must be 8-byte aligned and hold cap >= record_max_size(0) bytes; cores
+// that do not fit in cap (hotplugged after the buffer was sized) are dropped.
+size_t record_encode(const system_info_t *info, void *out, size_t cap) {
+    sysmon_record_t *rec = out;
+    uint32_t cores = (info->valid_flags & SHOW_CPU) ? (uint32_t)info->cpu.cores : 0;
+    uint32_t procs = (info->valid_flags & SHOW_PROC) ? (uint32_t)info->process_count : 0;
+    uint32_t mounts = (info->valid_flags & SHOW_DISK) ? (uint32_t)info->disk.mount_count : 0;
+    uint32_t devices = (info->valid_flags & SHOW_DISK) ? (uint32_t)info->disk.device_count : 0;
+    uint32_t interfaces = (info->valid_flags & SHOW_NET) ? (uint32_t)info->net.interface_count : 0;
+    uint32_t cgroups = (info->valid_flags & SHOW_CGROUPS) ? (uint32_t)info->cgroups.count : 0;
+    uint32_t sensors = (info->valid_flags & SHOW_SENSORS) ? (uint32_t)info->sensors.count : 0;
+    if (mounts > RECORD_MAX_MOUNTS) mounts = RECORD_MAX_MOUNTS;
+    if (devices > RECORD_MAX_DEVICES) devices = RECORD_MAX_DEVICES;
+    if (interfaces > RECORD_MAX_INTERFACES) interfaces = RECORD_MAX_INTERFACES;
+    if (cgroups > RECORD_MAX_CGROUPS) cgroups = RECORD_MAX_CGROUPS;
+    if (sensors > RECORD_MAX_SENSORS) sensors = RECORD_MAX_SENSORS;
+    size_t fixed = sizeof(sysmon_record_t) + procs * sizeof(sysmon_record_process_t) +
+                   mounts * sizeof(mount_info_t) + devices * sizeof(disk_io_t) +
+                   interfaces * sizeof(net_if_t) + cgroups * sizeof(cgroup_info_t) +
+                   sensors * sizeof(sensor_t);
+
+    if (fixed + cores * CORE_RECORD_SIZE > cap) {
+        cores = cap > fixed ? (uint32_t)((cap - fixed) / CORE_RECORD_SIZE) : 0;
+    }
+
+    memset(rec, 0, sizeof(sysmon_record_t));
+    rec->magic = SYSMON_RECORD_MAGIC;
+    rec->version = SYSMON_RECORD_VERSION;
+    rec->header_size = sizeof(sysmon_record_t);
+    // Rolling windows live in this process's aggregator and are not recorded
+    rec->valid_flags = (uint32_t)(info->valid_flags & ~SHOW_WINDOWS);
+    rec->timestamp_ns = (int64_t)(info->timestamp * 1e9);
+    rec->core_count = cores;
+    rec->process_count = procs;
+    rec->cores_offset = sizeof(sysmon_record_t);
+    rec->processes_offset = rec->cores_offset + cores * CORE_RECORD_SIZE;
+    rec->mount_count = mounts;
+    rec->device_count = devices;
+    rec->mounts_offset = rec->processes_offset + procs * sizeof(sysmon_record_process_t);
+    rec->devices_offset = rec->mounts_offset + mounts * sizeof(mount_info_t);
+    rec->interface_count = interfaces;
+    rec->interfaces_offset = rec->devices_offset + devices * sizeof(disk_io_t);
+    rec->cgroup_count = cgroups;
+    rec->cgroups_offset = rec->interfaces_offset + interfaces * sizeof(net_if_t);
+    rec->sensor_count = sensors;
+    rec->sensors_offset = rec->cgroups_offset + cgroups * sizeof(cgroup_info_t);
+    rec->record_size = rec->sensors_offset + sensors * sizeof(sensor_t);
+
+    // CPU
+    memcpy(rec->cpu_model, info->cpu.model, sizeof(rec->cpu_model));
+    rec->cpu_cores = info->cpu.cores;
+    rec->cpu_online = info->cpu.online;
+    rec->cpu_total_usage = info->cpu.total_usage;
+    rec->cpu_iowait_percent = info->cpu.iowait_percent;
+    rec->cpu_steal_percent = info->cpu.steal_percent;
+    rec->cpu_irq_percent = info->cpu.irq_percent;
+    rec->cpu_temperature = info->cpu.temperature;
+
+    // Memory
+    rec->mem_total_kb = info->memory.total;
+    rec->mem_available_kb = info->memory.available;
+    rec->mem_used_kb = info->memory.used;
+    rec->mem_free_kb = info->memory.free;
+    rec->mem_buffers_kb = info->memory.buffers;
+    rec->mem_cached_kb = info->memory.cached;
+    rec->swap_total_kb = info->memory.swap_total;
+    rec->swap_used_kb = info->memory.swap_used;
+    rec->swap_free_kb = info->memory.swap_free;
+    rec->mem_usage_percent = info->memory.usage_percent;
+    rec->swap_percent = info->memory.swap_percent;
+    rec->mem_shmem_kb = info->memory.shmem;
+    rec->mem_slab_reclaimable_kb = info->memory.slab_reclaimable;
+    rec->mem_slab_unreclaimable_kb = info->memory.slab_unreclaimable;
+    rec->mem_dirty_kb = info->memory.dirty;
+    rec->mem_writeback_kb = info->memory.writeback;
+    rec->mem_anon_kb = info->memory.anon;
+    rec->mem_file_kb = info->memory.file;
+    rec->hugepages_total = info->memory.hugepages_total;
+    rec->hugepages_free = info->memory.hugepages_free;
+    rec->hugepage_size_kb = info->memory.hugepage_size;
+    rec->pgfault_per_sec = info->memory.pgfault_per_sec;
+    rec->pgmajfault_per_sec = info->memory.pgmajfault_per_sec;
+    rec->pswpin_per_sec = info->memory.pswpin_per_sec;
+    rec->pswpout_per_sec = info->memory.pswpout_per_sec;
+    rec->pgscan_per_sec = info->memory.pgscan_per_sec;
+    rec->pgsteal_per_sec = info->memory.pgsteal_per_sec;
+    rec->compact_stall_per_sec = info->memory.compact_stall_per_sec;
+    rec->numa_miss_per_sec = info->memory.numa_miss_per_sec;
+    rec->oom_kills = info->memory.oom_kills;
+    rec->numa_count = (uint32_t)info->memory.numa_count;
+    memcpy(rec->numa, info->memory.numa, sizeof(rec->numa));
+
+    // Uptime and disk
+    rec->uptime_seconds = info->uptime.uptime_seconds;
+    memcpy(rec->disk_filesystem, info->disk.filesystem, sizeof(rec->disk_filesystem));
+    rec->disk_total_bytes = info->disk.total_bytes;
+    rec->disk_used_bytes = info->disk.used_bytes;
+    rec->disk_available_bytes = info->disk.available_bytes;
+    rec->disk_usage_percent = info->disk.usage_percent;
+
+    // Network
+    rec->net_rx_bytes_per_sec = info->net.rx_bytes_per_sec;
+    rec->net_tx_bytes_per_sec = info->net.tx_bytes_per_sec;
+    rec->tcp_valid = (uint32_t)info->net.tcp_valid;
+    memcpy(rec->tcp_states, info->net.tcp_states, sizeof(rec->tcp_states));
+    rec->cgroups_tracked = (uint32_t)info->cgroups.tracked;
+    rec->stale_flags = (uint32_t)info->stale_flags;
+    rec->pressure = info->pressure;
+
+    // Variable-length arrays after the fixed header
+    if (cores > 0) {
+        const double *arrays[] = {info->cpu.usage, info->cpu.iowait, info->cpu.steal, info->cpu.irq};
+        double *dst = (double *)((char *)rec + rec->cores_offset);
+        for (int a = 0; a < 4; a++) {
+            memcpy(dst + (size_t)a * cores, arrays[a], cores * sizeof(double));
+        }
+    }
+
+    sysmon_record_process_t *proc = (sysmon_record_process_t *)((char *)rec + rec->processes_offset);
+    for (uint32_t i = 0; i < procs; i++) {
+        const process_info_t *src = &info->top_processes[i];
+        memset(&proc[i], 0, sizeof(sysmon_record_process_t));
+        proc[i].pid = src->pid;
+        proc[i].threads = src->threads;
+        proc[i].cpu_percent = src->cpu_percent;
+        proc[i].io_rate = src->io_rate;
+        proc[i].memory_kb = src->memory_kb;
+        proc[i].pss_kb = src->pss_kb;
+        proc[i].read_bytes_per_sec = src->read_bytes_per_sec;
+        proc[i].write_bytes_per_sec = src->write_bytes_per_sec;
+        proc[i].voluntary_ctxsw_per_sec = src->voluntary_ctxsw_per_sec;
+        proc[i].involuntary_ctxsw_per_sec = src->involuntary_ctxsw_per_sec;
+        proc[i].major_faults_per_sec = src->major_faults_per_sec;
+        memcpy(proc[i].name, src->name, sizeof(proc[i].name));
+    }
+
+    // The first mounts and devices are copied as they are
+    if (mounts > 0) {
+        memcpy((char *)rec + rec->mounts_offset, info->disk.mounts, mounts * sizeof(mount_info_t));
+    }
+    if (devices > 0) {
+        memcpy((char *)rec + rec->devices_offset, info->disk.devices, devices * sizeof(disk_io_t));
+    }
+    if (interfaces > 0) {
+        memcpy((char *)rec + rec->interfaces_offset, info->net.interfaces,
+               interfaces * sizeof(net_if_t));
+    }
+    if (cgroups > 0) {
+        memcpy((char *)rec + rec->cgroups_offset, info->cgroups.groups,
+               cgroups * sizeof(cgroup_info_t));
+    }
+    if (sensors > 0) {
+        memcpy((char *)rec + rec->sensors_offset, info->sensors.sensors, sensors * sizeof(sensor_t));
+    }
+
+    return rec->record_size;
+}
+
+// Largest record a sample with the given number of cores can produce
+size_t record_max_size(int cores) {
+    return sizeof(sysmon_record_t) + (size_t)cores * CORE_RECORD_SIZE +
+           MAX_TOP_PROCESSES * sizeof(sysmon_record_process_t) +
+           RECORD_MAX_MOUNTS * sizeof(mount_info_t) + RECORD_MAX_DEVICES * sizeof(disk_io_t) +
+           RECORD_MAX_INTERFACES * sizeof(net_if_t) + RECORD_MAX_CGROUPS * sizeof(cgroup_info_t) +
+           RECORD_MAX_SENSORS * sizeof(sensor_t);
+}
+
+// Decodes a binary record back into a sample. Returns -1 if the record is
+// not a valid record of this version or does not fit in len bytes.
+// The per-core, mount, device, interface, cgroup and sensor arrays are not
+// copied: info->cpu.usage, info->disk.mounts, info->disk.devices,
+// info->net.interfaces, info->cgroups.groups and info->sensors.sensors point
+// into data, which must outlive info.
+int record_decode(const void *data, size_t len, system_info_t *info) {
+    const sysmon_record_t *rec = data;
+
+    if (len < sizeof(sysmon_record_t) || rec->magic != SYSMON_RECORD_MAGIC ||
+        rec->version != SYSMON_RECORD_VERSION || rec->record_size > len ||
+        rec->process_count > MAX_TOP_PROCESSES || rec->cores_offset % sizeof(double) != 0 ||
+        rec->cores_offset + (uint64_t)rec->core_count * CORE_RECORD_SIZE > rec->record_size ||
+        rec->processes_offset + rec->process_count * sizeof(sysmon_record_process_t) > rec->record_size ||
+        rec->mounts_offset % sizeof(uint64_t) != 0 || rec->devices_offset % sizeof(uint64_t) != 0 ||
+        rec->mounts_offset + (uint64_t)rec->mount_count * sizeof(mount_info_t) > rec->record_size ||
+        rec->devices_offset + (uint64_t)rec->device_count * sizeof(disk_io_t) > rec->record_size ||
+        rec->interfaces_offset % sizeof(uint64_t) != 0 ||
+        rec->interfaces_offset + (uint64_t)rec->interface_count * sizeof(net_if_t) > rec->record_size ||
+        rec->cgroups_offset % sizeof(uint64_t) != 0 ||
+        rec->cgroups_offset + (uint64_t)rec->cgroup_count * sizeof(cgroup_info_t) > rec->record_size ||
+        rec->sensors_offset % sizeof(uint64_t) != 0 ||
+        rec->sensors_offset + (uint64_t)rec->sensor_count * sizeof(sensor_t) > rec->record_size) {
+        return -1;
+    }
+
+    memset(info, 0, sizeof(system_info_t));
+    info->valid_flags = (int)rec->valid_flags;
+    info->stale_flags = (int)rec->stale_flags;
+    info->timestamp = rec->timestamp_ns / 1e9;
+
+    // CPU
+    memcpy(info->cpu.model, rec->cpu_model, sizeof(info->cpu.model));
+    info->cpu.model[sizeof(info->cpu.model) - 1] = '\0';
+    info->cpu.cores = (int)rec->core_count;
+    info->cpu.online = rec->cpu_online;
+    info->cpu.total_usage = rec->cpu_total_usage;
+    info->cpu.iowait_percent = rec->cpu_iowait_percent;
+    info->cpu.steal_percent = rec->cpu_steal_percent;
+    info->cpu.irq_percent = rec->cpu_irq_percent;
+    info->cpu.temperature = rec->cpu_temperature;
+
+    const double *cores = (const double *)((const char *)rec + rec->cores_offset);
+    info->cpu.usage = cores;
+    info->cpu.iowait = cores + rec->core_count;
+    info->cpu.steal = cores + 2 * (size_t)rec->core_count;
+    info->cpu.irq = cores + 3 * (size_t)rec->core_count;
+
+    // Memory
+    info->memory.total = rec->mem_total_kb;
+    info->memory.available = rec->mem_available_kb;
+    info->memory.used = rec->mem_used_kb;
+    info->memory.free = rec->mem_free_kb;
+    info->memory.buffers = rec->mem_buffers_kb;
+    info->memory.cached = rec->mem_cached_kb;
+    info->memory.swap_total = rec->swap_total_kb;
+    info->memory.swap_used = rec->swap_used_kb;
+    info->memory.swap_free = rec->swap_free_kb;
+    info->memory.usage_percent = rec->mem_usage_percent;
+    info->memory.swap_percent = rec->swap_percent;
+    info->memory.shmem = rec->mem_shmem_kb;
+    info->memory.slab_reclaimable = rec->mem_slab_reclaimable_kb;
+    info->memory.slab_unreclaimable = rec->mem_slab_unreclaimable_kb;
+    info->memory.dirty = rec->mem_dirty_kb;
+    info->memory.writeback = rec->mem_writeback_kb;
+    info->memory.anon = rec->mem_anon_kb;
+    info->memory.file = rec->mem_file_kb;
+    info->memory.hugepages_total = rec->hugepages_total;
+    info->memory.hugepages_free = rec->hugepages_free;
+    info->memory.hugepage_size = rec->hugepage_size_kb;
+    info->memory.pgfault_per_sec = rec->pgfault_per_sec;
+    info->memory.pgmajfault_per_sec = rec->pgmajfault_per_sec;
+    info->memory.pswpin_per_sec = rec->pswpin_per_sec;
+    info->memory.pswpout_per_sec = rec->pswpout_per_sec;
+    info->memory.pgscan_per_sec = rec->pgscan_per_sec;
+    info->memory.pgsteal_per_sec = rec->pgsteal_per_sec;
+    info->memory.compact_stall_per_sec = rec->compact_stall_per_sec;
+    info->memory.numa_miss_per_sec = rec->numa_miss_per_sec;
+    info->memory.oom_kills = rec->oom_kills;
+    info->memory.numa_count = rec->numa_count < MAX_NUMA_NODES ? (int)rec->numa_count
+                                                               : MAX_NUMA_NODES;
+    memcpy(info->memory.numa, rec->numa, sizeof(info->memory.numa));
+
+    // Uptime and disk
+    info->uptime.uptime_seconds = rec->uptime_seconds;
+    format_uptime(info->uptime.uptime_seconds, info->uptime.uptime_formatted,
+                  sizeof(info->uptime.uptime_formatted));
+    memcpy(info->disk.filesystem, rec->disk_filesystem, sizeof(info->disk.filesystem));
+    info->disk.filesystem[sizeof(info->disk.filesystem) - 1] = '\0';
+    info->disk.total_bytes = rec->disk_total_bytes;
+    info->disk.used_bytes = rec->disk_used_bytes;
+    info->disk.available_bytes = rec->disk_available_bytes;
+    info->disk.usage_percent = rec->disk_usage_percent;
+    info->disk.mount_count = (int)rec->mount_count;
+    info->disk.mounts = (const mount_info_t *)((const char *)rec + rec->mounts_offset);
+    info->disk.device_count = (int)rec->device_count;
+    info->disk.devices = (const disk_io_t *)((const char *)rec + rec->devices_offset);
+
+    // Network
+    info->net.rx_bytes_per_sec = rec->net_rx_bytes_per_sec;
+    info->net.tx_bytes_per_sec = rec->net_tx_bytes_per_sec;
+    info->net.tcp_valid = (int)rec->tcp_valid;
+    memcpy(info->net.tcp_states, rec->tcp_states, sizeof(info->net.tcp_states));
+    info->net.interface_count = (int)rec->interface_count;
+    info->net.interfaces = (const net_if_t *)((const char *)rec + rec->interfaces_offset);
+
+    // Cgroups
+    info->cgroups.count = (int)rec->cgroup_count;
+    info->cgroups.groups = (const cgroup_info_t *)((const char *)rec + rec->cgroups_offset);
+    info->cgroups.tracked = (int)rec->cgroups_tracked;
+
+    // Sensors
+    info->sensors.count = (int)rec->sensor_count;
+    info->sensors.sensors = (const sensor_t *)((const char *)rec + rec->sensors_offset);
+
+    // Pressure
+    info->pressure = rec->pressure;
+
+    // Processes
+    const sysmon_record_process_t *proc =
+        (const sysmon_record_process_t *)((const char *)rec + rec->processes_offset);
+    info->process_count = (int)rec->process_count;
+    for (uint32_t i = 0; i < rec->process_count; i++) {
+        process_info_t *dst = &info->top_processes[i];
+        dst->pid = proc[i].pid;
+        dst->threads = proc[i].threads;
+        dst->cpu_percent = proc[i].cpu_percent;
+        dst->io_rate = proc[i].io_rate;
+        dst->memory_kb = proc[i].memory_kb;
+        dst->pss_kb = (long)proc[i].pss_kb;
+        dst->read_bytes_per_sec = proc[i].read_bytes_per_sec;
+        dst->write_bytes_per_sec = proc[i].write_bytes_per_sec;
+        dst->voluntary_ctxsw_per_sec = proc[i].voluntary_ctxsw_per_sec;
+        dst->involuntary_ctxsw_per_sec = proc[i].involuntary_ctxsw_per_sec;
+        dst->major_faults_per_sec = proc[i].major_faults_per_sec;
+        memcpy(dst->name, proc[i].name, sizeof(dst->name));
+        dst->name[sizeof(dst->name) - 1] = '\0';
+    }
+
+    return 0;
+}
+
+static void write_binary(out_writer_t *w, const system_info_t *info) {
+    // Encode straight into the output buffer when it has room
+    size_t max = record_max_size(info->cpu.cores);
+    if (w->cap - w->len < max && output_flush(w) != 0) return;
+
+    w->len += record_encode(info, w->buf + w->len, w->cap - w->len);
+}
+
+// Prometheus text exposition (version 0.0.4). Every family is written with
+// its HELP and TYPE lines and all of its samples together.
+
+static void prom_family(out_writer_t *w, const char *name, const char *type, const char *help) {
+    out_str(w, "# HELP ");
+    out_str(w, name);
+    out_char(w, ' ');
+    out_str(w, help);
+    out_str(w, "\n# TYPE ");
+    out_str(w, name);
+    out_char(w, ' ');
+    out_str(w, type);
+    out_char(w, '\n');
+}
+
+// Opens a sample line: the name, then the labels added by prom_label
+static void prom_begin(out_writer_t *w, const char *name) {
+    out_str(w, name);
+}
+
+// Adds a label, escaping backslashes, quotes and newlines in the value
+static void prom_label(out_writer_t *w, const char *key, const char *value, int first) {
+    out_char(w, first ? '{' : ',');
+    out_str(w, key);
+    out_str(w, "=\"");
+    for (; *value; value++) {
+        if (*value == '\\' || *value == '"') {
+            out_char(w, '\\');
+            out_char(w, *value);
+        } else if (*value == '\n') {
+            out_str(w, "\\n");
+        } else {
+            out_char(w, *value);
+        }
+    }
+    out_char(w, '"');
+}
+
+static void prom_label_u64(out_writer_t *w, const char *key, unsigned long long value, int first) {
+    char digits[24];
+    snprintf(digits, sizeof(digits), "%llu", value);
+    prom_label(w, key, digits, first);
+}
+
+// Ends a sample line with its value; labels says whether any were added
+static void prom_value(out_writer_t *w, int labels, double v) {
+    out_str(w, labels ? "} " : " ");
+    out_fixed(w, v, 2);
+    out_char(w, '\n');
+}
+
+static void prom_value_u64(out_writer_t *w, int labels, unsigned long long v) {
+    out_str(w, labels ? "} " : " ");
+    out_u64(w, v);
+    out_char(w, '\n');
+}
+
+static void prom_gauge(out_writer_t *w, const char *name, const char *help, double v) {
+    prom_family(w, name, "gauge", help);
+    prom_begin(w, name);
+    prom_value(w, 0, v);
+}
+
+// A family with one sample per array element: the double at offset in each
+// element of size bytes, labelled with the string at label_offset. Negative
+// values were not sampled and are left out.
+typedef struct {
+    const char *name;
+    const char *help;
+    size_t offset;
+} prom_field_t;
+
+static void prom_table(out_writer_t *w, const prom_field_t *fields, size_t field_count,
+                       const void *items, int count, size_t size,
+                       const char *label, size_t label_offset) {
+    for (size_t f = 0; f < field_count; f++) {
+        prom_family(w, fields[f].name, "gauge", fields[f].help);
+        for (int i = 0; i < count; i++) {
+            const char *item = (const char *)items + (size_t)i * size;
+            double v = *(const double *)(item + fields[f].offset);
+            if (v < 0) continue;
+            prom_begin(w, fields[f].name);
+            prom_label(w, label, item + label_offset, 1);
+            prom_value(w, 1, v);
+        }
+    }
+}
+
+static const prom_field_t prom_disk_fields[] = {
+    {"sysmon_disk_reads_per_second", "Completed reads per second.",
+     offsetof(disk_io_t, read_iops)},
+    {"sysmon_disk_writes_per_second", "Completed writes per second.",
+     offsetof(disk_io_t, write_iops)},
+    {"sysmon_disk_read_bytes_per_second", "Bytes read per second.",
+     offsetof(disk_io_t, read_bytes_per_sec)},
+    {"sysmon_disk_written_bytes_per_second", "Bytes written per second.",
+     offsetof(disk_io_t, write_bytes_per_sec)},
+    {"sysmon_disk_queue_depth", "Average requests in flight.",
+     offsetof(disk_io_t, queue_depth)},
+    {"sysmon_disk_await_milliseconds", "Average time per request, queueing included.",
+     offsetof(disk_io_t, await_ms)},
+    {"sysmon_disk_utilization_percent", "Time the device was busy.",
+     offsetof(disk_io_t, util_percent)},
+};
+
+static const prom_field_t prom_net_fields[] = {
+    {"sysmon_network_receive_bytes_per_second", "Bytes received per second.",
+     offsetof(net_if_t, rx_bytes_per_sec)},
+    {"sysmon_network_transmit_bytes_per_second", "Bytes sent per second.",
+     offsetof(net_if_t, tx_bytes_per_sec)},
+    {"sysmon_network_receive_packets_per_second", "Packets received per second.",
+     offsetof(net_if_t, rx_packets_per_sec)},
+    {"sysmon_network_transmit_packets_per_second", "Packets sent per second.",
+     offsetof(net_if_t, tx_packets_per_sec)},
+    {"sysmon_network_receive_drops_per_second", "Received packets dropped per second.",
+     offsetof(net_if_t, rx_drops_per_sec)},
+    {"sysmon_network_transmit_drops_per_second", "Outgoing packets dropped per second.",
+     offsetof(net_if_t, tx_drops_per_sec)},
+    {"sysmon_network_receive_errors_per_second", "Receive errors per second.",
+     offsetof(net_if_t, rx_errors_per_sec)},
+    {"sysmon_network_transmit_errors_per_second", "Transmit errors per second.",
+     offsetof(net_if_t, tx_errors_per_sec)},
+};
+
+static const prom_field_t prom_cgroup_fields[] = {
+    {"sysmon_cgroup_cpu_percent", "CPU used over the interval, percent of one CPU.",
+     offsetof(cgroup_info_t, cpu_percent)},
+    {"sysmon_cgroup_throttled_percent", "Time throttled by cpu.max.",
+     offsetof(cgroup_info_t, throttled_percent)},
+    {"sysmon_cgroup_read_bytes_per_second", "Bytes read per second.",
+     offsetof(cgroup_info_t, read_bytes_per_sec)},
+    {"sysmon_cgroup_written_bytes_per_second", "Bytes written per second.",
+     offsetof(cgroup_info_t, write_bytes_per_sec)},
+};
+
+static const prom_field_t prom_process_fields[] = {
+    {"sysmon_process_cpu_percent", "CPU used over the interval, percent of one CPU.",
+     offsetof(process_info_t, cpu_percent)},
+    {"sysmon_process_read_bytes_per_second", "Storage bytes read per second.",
+     offsetof(process_info_t, read_bytes_per_sec)},
+    {"sysmon_process_written_bytes_per_second", "Storage bytes written per second.",
+     offsetof(process_info_t, write_bytes_per_sec)},
+    {"sysmon_process_major_faults_per_second", "Page faults that needed I/O per second.",
+     offsetof(process_info_t, major_faults_per_sec)},
+};
+
+static void write_prometheus(out_writer_t *w, const system_info_t *info) {
+    prom_gauge(w, "sysmon_sample_timestamp_seconds", "Wall-clock time of the sample.",
+               info->timestamp);
+
+    if (info->valid_flags & SHOW_CPU) {
+        const cpu_info_t *cpu = &info->cpu;
+        prom_gauge(w, "sysmon_cpu_usage_percent", "CPU busy time over the interval.",
+                   cpu->total_usage);
+        prom_gauge(w, "sysmon_cpu_iowait_percent", "CPU time waiting for I/O.",
+                   cpu->iowait_percent);
+        prom_gauge(w, "sysmon_cpu_steal_percent", "CPU time stolen by the hypervisor.",
+                   cpu->steal_percent);
+        prom_gauge(w, "sysmon_cpu_irq_percent", "CPU time in hard and soft interrupts.",
+                   cpu->irq_percent);
+        prom_gauge(w, "sysmon_cpu_online", "Cores online.", cpu->online);
+        if (cpu->temperature > 0) {
+            prom_gauge(w, "sysmon_cpu_temperature_celsius", "CPU temperature.", cpu->temperature);
+        }
+        prom_family(w, "sysmon_cpu_core_usage_percent", "gauge",
+                    "Busy time of each online core over the interval.");
+        for (int i = 0; i < cpu->cores; i++) {
+            if (cpu->usage[i] < 0) continue;
+            prom_begin(w, "sysmon_cpu_core_usage_percent");
+            prom_label_u64(w, "core", (unsigned long long)i, 1);
+            prom_value(w, 1, cpu->usage[i]);
+        }
+    }
+
+    if (info->valid_flags & SHOW_MEMORY) {
+        const memory_info_t *mem = &info->memory;
+        static const char *names[] = {
+            "sysmon_memory_total_bytes", "sysmon_memory_available_bytes",
+            "sysmon_memory_used_bytes", "sysmon_memory_free_bytes",
+            "sysmon_memory_buffers_bytes", "sysmon_memory_cached_bytes",
+            "sysmon_swap_total_bytes", "sysmon_swap_used_bytes",
+            "sysmon_memory_shmem_bytes", "sysmon_memory_slab_reclaimable_bytes",
+            "sysmon_memory_slab_unreclaimable_bytes", "sysmon_memory_dirty_bytes",
+            "sysmon_memory_writeback_bytes", "sysmon_memory_anon_bytes",
+            "sysmon_memory_file_bytes",
+        };
+        const unsigned long values[] = {
+            mem->total, mem->available, mem->used, mem->free, mem->buffers, mem->cached,
+            mem->swap_total, mem->swap_used, mem->shmem, mem->slab_reclaimable,
+            mem->slab_unreclaimable, mem->dirty, mem->writeback, mem->anon, mem->file,
+        };
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+            prom_family(w, names[i], "gauge", "From /proc/meminfo.");
+            prom_begin(w, names[i]);
+            prom_value_u64(w, 0, (unsigned long long)values[i] * 1024);
+        }
+        if (mem->hugepages_total > 0) {
+            prom_gauge(w, "sysmon_memory_hugepages_total", "Pages in the huge page pool.",
+                       (double)mem->hugepages_total);
+            prom_gauge(w, "sysmon_memory_hugepages_free", "Free pages in the huge page pool.",
+                       (double)mem->hugepages_free);
+        }
+
+        static const char *rate_names[] = {
+            "sysmon_vmstat_pgfault_per_second", "sysmon_vmstat_pgmajfault_per_second",
+            "sysmon_vmstat_pswpin_per_second", "sysmon_vmstat_pswpout_per_second",
+            "sysmon_vmstat_pgscan_per_second", "sysmon_vmstat_pgsteal_per_second",
+            "sysmon_vmstat_compact_stall_per_second", "sysmon_vmstat_numa_miss_per_second",
+        };
+        const double rates[] = {
+            mem->pgfault_per_sec, mem->pgmajfault_per_sec, mem->pswpin_per_sec,
+            mem->pswpout_per_sec, mem->pgscan_per_sec, mem->pgsteal_per_sec,
+            mem->compact_stall_per_sec, mem->numa_miss_per_sec,
+        };
+        for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+            if (rates[i] < 0) continue;
+            prom_gauge(w, rate_names[i], "From /proc/vmstat, over the interval.", rates[i]);
+        }
+        if (mem->oom_kills >= 0) {
+            prom_gauge(w, "sysmon_vmstat_oom_kills", "OOM kills over the interval.",
+                       (double)mem->oom_kills);
+        }
+
+        static const char *node_names[] = {
+            "sysmon_numa_node_total_bytes", "sysmon_numa_node_used_bytes",
+            "sysmon_numa_node_free_bytes", "sysmon_numa_node_file_bytes",
+            "sysmon_numa_node_anon_bytes",
+        };
+        for (int f = 0; f < 5 && mem->numa_count > 0; f++) {
+            prom_family(w, node_names[f], "gauge", "From /sys/devices/system/node/node*/meminfo.");
+            for (int i = 0; i < mem->numa_count; i++) {
+                const numa_node_t *node = &mem->numa[i];
+                const uint64_t node_values[] = {node->total_kb, node->used_kb, node->free_kb,
+                                                node->file_kb, node->anon_kb};
+                prom_begin(w, node_names[f]);
+                prom_label_u64(w, "node", (unsigned long long)node->id, 1);
+                prom_value_u64(w, 1, (unsigned long long)node_values[f] * 1024);
+            }
+        }
+    }
+
+    if (info->valid_flags & SHOW_UPTIME) {
+        prom_gauge(w, "sysmon_uptime_seconds", "Time since boot.",
+                   (double)info->uptime.uptime_seconds);
+    }
+
+    if (info->valid_flags & SHOW_DISK) {
+        static const char *names[] = {
+            "sysmon_filesystem_size_bytes", "sysmon_filesystem_used_bytes",
+            "sysmon_filesystem_avail_bytes",
+        };
+        static const char *helps[] = {
+            "Filesystem size.", "Space in use.", "Space available to unprivileged users.",
+        };
+        for (int f = 0; f < 3; f++) {
+            prom_family(w, names[f], "gauge", helps[f]);
+            for (int i = 0; i < info->disk.mount_count; i++) {
+                const mount_info_t *mount = &info->disk.mounts[i];
+                const uint64_t values[] = {mount->total_bytes, mount->used_bytes,
+                                           mount->available_bytes};
+                prom_begin(w, names[f]);
+                prom_label(w, "mountpoint", mount->mount_point, 1);
+                prom_label(w, "device", mount->device, 0);
+                prom_label(w, "fstype", mount->fstype, 0);
+                prom_value_u64(w, 1, values[f]);
+            }
+        }
+        prom_table(w, prom_disk_fields, sizeof(prom_disk_fields) / sizeof(prom_disk_fields[0]),
+                   info->disk.devices, info->disk.device_count, sizeof(disk_io_t),
+                   "device", offsetof(disk_io_t, name));
+    }
+
+    if (info->valid_flags & SHOW_NET) {
+        prom_table(w, prom_net_fields, sizeof(prom_net_fields) / sizeof(prom_net_fields[0]),
+                   info->net.interfaces, info->net.interface_count, sizeof(net_if_t),
+                   "interface", offsetof(net_if_t, name));
+        if (info->net.tcp_valid) {
+            prom_family(w, "sysmon_tcp_sockets", "gauge", "IPv4 and IPv6 TCP sockets per state.");
+            for (int state = 1; state < NET_TCP_STATES; state++) {
+                prom_begin(w, "sysmon_tcp_sockets");
+                prom_label(w, "state", net_tcp_state_name(state), 1);
+                prom_value_u64(w, 1, info->net.tcp_states[state]);
+            }
+        }
+    }
+
+    if (info->valid_flags & SHOW_PRESSURE) {
+        static const char *names[] = {
+            "sysmon_pressure_avg10_percent", "sysmon_pressure_avg60_percent",
+            "sysmon_pressure_avg300_percent", "sysmon_pressure_stall_seconds_total",
+        };
+        for (int f = 0; f < 4; f++) {
+            prom_family(w, names[f], f == 3 ? "counter" : "gauge",
+                        f == 3 ? "Stall time since boot." : "Kernel running average of stalled time.");
+            for (int r = 0; r < PSI_RESOURCES; r++) {
+                const psi_info_t *psi = &info->pressure.resources[r];
+                for (int full = 0; full <= psi->has_full; full++) {
+                    const psi_line_t *line = full ? &psi->full : &psi->some;
+                    const double values[] = {line->avg10, line->avg60, line->avg300,
+                                             line->total_usec / 1e6};
+                    prom_begin(w, names[f]);
+                    prom_label(w, "resource", psi_resource_name(r), 1);
+                    prom_label(w, "kind", full ? "full" : "some", 0);
+                    prom_value(w, 1, values[f]);
+                }
+            }
+        }
+    }
+
+    if (info->valid_flags & SHOW_SENSORS) {
+        static const struct {
+            sensor_kind_t first, last;
+            const char *name, *help;
+        } families[] = {
+            {SENSOR_PACKAGE, SENSOR_TEMP, "sysmon_temperature_celsius",
+             "Temperature sensor reading."},
+            {SENSOR_FAN, SENSOR_FAN, "sysmon_fan_rpm", "Fan speed."},
+            {SENSOR_POWER, SENSOR_POWER, "sysmon_power_watts",
+             "Average RAPL domain power over the interval."},
+        };
+        for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++) {
+            prom_family(w, families[f].name, "gauge", families[f].help);
+            for (int i = 0; i < info->sensors.count; i++) {
+                const sensor_t *sensor = &info->sensors.sensors[i];
+                if (!sensor->valid || sensor->kind < (int32_t)families[f].first ||
+                    sensor->kind > (int32_t)families[f].last) {
+                    continue;
+                }
+                prom_begin(w, families[f].name);
+                prom_label(w, "chip", sensor->chip, 1);
+                prom_label(w, "sensor", sensor->label, 0);
+                prom_label(w, "kind", sensor_kind_name((sensor_kind_t)sensor->kind), 0);
+                if (sensor->package >= 0) {
+                    prom_label_u64(w, "package", (unsigned long long)sensor->package, 0);
+                }
+                if (sensor->core >= 0) {
+                    prom_label_u64(w, "core", (unsigned long long)sensor->core, 0);
+                }
+                prom_value(w, 1, sensor->value);
+            }
+        }
+    }
+
+    if (info->valid_flags & SHOW_CGROUPS) {
+        prom_table(w, prom_cgroup_fields, sizeof(prom_cgroup_fields) / sizeof(prom_cgroup_fields[0]),
+                   info->cgroups.groups, info->cgroups.count, sizeof(cgroup_info_t),
+                   "cgroup", offsetof(cgroup_info_t, path));
+        prom_family(w, "sysmon_cgroup_memory_bytes", "gauge", "memory.current of the group.");
+        for (int i = 0; i < info->cgroups.count; i++) {
+            const cgroup_info_t *group = &info->cgroups.groups[i];
+            if (group->memory_bytes < 0) continue;
+            prom_begin(w, "sysmon_cgroup_memory_bytes");
+            prom_label(w, "cgroup", group->path, 1);
+            prom_value_u64(w, 1, (unsigned long long)group->memory_bytes);
+        }
+    }
+
+    if (info->valid_flags & SHOW_WINDOWS) {
+        // One sample per series and window; quantiles as a summary-style label
+        static const char *names[] = {
+            "sysmon_window_min", "sysmon_window_max", "sysmon_window_mean",
+            "sysmon_window_quantile",
+        };
+        static const char *helps[] = {
+            "Smallest fast sample over the window.", "Largest fast sample over the window.",
+            "Mean of the fast samples over the window.",
+            "Estimated quantile of the fast samples over the window.",
+        };
+        static const char *quantiles[] = {"0.5", "0.95", "0.99"};
+        const window_info_t *windows = &info->windows;
+
+        for (int f = 0; f < 4; f++) {
+            prom_family(w, names[f], "gauge", helps[f]);
+            for (int i = 0; i < windows->count; i++) {
+                const series_stats_t *series = &windows->series[i];
+                for (int win = 0; win < WINDOW_COUNT; win++) {
+                    const window_stats_t *window = &series->windows[win];
+                    const double values[] = {window->min, window->max, window->mean,
+                                             window->p50, window->p95, window->p99};
+                    if (window->count == 0) continue;
+                    for (int q = 0; q < (f == 3 ? 3 : 1); q++) {
+                        prom_begin(w, names[f]);
+                        prom_label(w, "series", series->name, 1);
+                        prom_label(w, "window", window_name(win), 0);
+                        if (f == 3) prom_label(w, "quantile", quantiles[q], 0);
+                        prom_value(w, 1, values[f + q]);
+                    }
+                }
+            }
+        }
+    }
+
+    if (info->valid_flags & SHOW_PROC) {
+        // Top processes only: pid and name label the ranked entries
+        prom_family(w, "sysmon_process_resident_bytes", "gauge", "Resident set size.");
+        for (int i = 0; i < info->process_count; i++) {
+            const process_info_t *proc = &info->top_processes[i];
+            prom_begin(w, "sysmon_process_resident_bytes");
+            prom_label_u64(w, "pid", (unsigned long long)proc->pid, 1);
+            prom_label(w, "name", proc->name, 0);
+            prom_value_u64(w, 1, (unsigned long long)proc->memory_kb * 1024);
+        }
+        for (size_t f = 0; f < sizeof(prom_process_fields) / sizeof(prom_process_fields[0]); f++) {
+            prom_family(w, prom_process_fields[f].name, "gauge", prom_process_fields[f].help);
+            for (int i = 0; i < info->process_count; i++) {
+                const process_info_t *proc = &info->top_processes[i];
+                double v = *(const double *)((const char *)proc + prom_process_fields[f].offset);
+                if (v < 0) continue;
+                prom_begin(w, prom_process_fields[f].name);
+                prom_label_u64(w, "pid", (unsigned long long)proc->pid, 1);
+                prom_label(w, "name", proc->name, 0);
+                prom_value(w, 1, v);
+            }
+        }
+    }
+}
+
+// Serializes one sample in the given format and flushes it
+int output_write_sample(out_writer_t *w, output_format_t format, const system_info_t *info) {
+    switch (format) {
+        case FORMAT_JSONL:  write_jsonl(w, info); break;
+        case FORMAT_CSV:    write_csv(w, info); break;
+        case FORMAT_BINARY: write_binary(w, info); break;
+        case FORMAT_PROMETHEUS: write_prometheus(w, info); break;
+        case FORMAT_TEXT:
+        default:            return -1;
+    }
+    return output_flush(w);
+}
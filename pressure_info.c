@@ -0,0 +1,179 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <fcntl.h>
+
+// Pressure stall information from /proc/pressure/{cpu,memory,io}.
+//
+// Each file has a "some" line (at least one task stalled on the resource)
+// and a "full" line (every non-idle task stalled at once), e.g.
+//   some avg10=0.76 avg60=2.05 avg300=3.18 total=81516576
+//   full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+// The averages are the kernel's running means; the stall share of the last
+// interval comes from the delta of the total counter (microseconds).
+//
+// Triggers: writing "some <stall us> <window us>" to a pressure file makes
+// the kernel flag that descriptor with POLLPRI whenever tasks stalled for
+// that long within one window. Watch mode waits on these descriptors next to
+// its timer, so a stall wakes it up at once instead of at the next period.
+// Unprivileged callers get EPERM before Linux 6.5; from 6.5 on they may set
+// triggers whose window is a multiple of 2 s.
+
+static const char *psi_names[PSI_RESOURCES] = {"cpu", "memory", "io"};
+
+static proc_file_t pressure_files[PSI_RESOURCES] = {
+    PROC_FILE_INIT("/proc/pressure/cpu"),
+    PROC_FILE_INIT("/proc/pressure/memory"),
+    PROC_FILE_INIT("/proc/pressure/io"),
+};
+
+static uint64_t prev_some[PSI_RESOURCES];   // Totals of the last sample
+static uint64_t prev_full[PSI_RESOURCES];
+static int has_prev = 0;
+static double pressure_time = 0.0;          // CLOCK_MONOTONIC time of the last sample
+
+static int trigger_fds[PSI_RESOURCES] = {-1, -1, -1};
+static uint32_t trigger_stalls[PSI_RESOURCES]; // Wakeups since the last sample
+
+const char *psi_resource_name(int resource) {
+    return resource >= 0 && resource < PSI_RESOURCES ? psi_names[resource] : "";
+}
+
+// Parses one "some ..." or "full ..." line; returns 0 if every field was found
+static int parse_psi_line(const char *line, psi_line_t *out) {
+    static const char *keys[] = {"avg10=", "avg60=", "avg300="};
+    double *values[] = {&out->avg10, &out->avg60, &out->avg300};
+    const char *p = line;
+    char *end;
+
+    for (int i = 0; i < 3; i++) {
+        p = strstr(p, keys[i]);
+        if (!p) return -1;
+        *values[i] = strtod(p + strlen(keys[i]), &end);
+        if (end == p + strlen(keys[i])) return -1;
+        p = end;
+    }
+
+    unsigned long total;
+    p = strstr(p, "total=");
+    if (!p || !scan_ulong(p + 6, &total)) return -1;
+    out->total_usec = total;
+    return 0;
+}
+
+// Stall share of the interval from two totals, or -1 on the first sample
+static double stall_percent(uint64_t total, uint64_t previous, double elapsed) {
+    if (!has_prev || elapsed <= 0 || total < previous) return -1.0;
+
+    double percent = (double)(total - previous) / (elapsed * 1e4);
+    return percent > 100.0 ? 100.0 : percent;
+}
+
+int read_pressure_info(pressure_info_t *pressure) {
+    struct timespec now;
+    int read = 0;
+
+    memset(pressure, 0, sizeof(pressure_info_t));
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec + now.tv_nsec / 1e9;
+    double elapsed = time - pressure_time;
+
+    for (int r = 0; r < PSI_RESOURCES; r++) {
+        psi_info_t *psi = &pressure->resources[r];
+
+        psi->armed = trigger_fds[r] >= 0;
+        psi->stalls = trigger_stalls[r];
+        trigger_stalls[r] = 0;
+        psi->some.stall_percent = psi->full.stall_percent = -1.0;
+
+        if (proc_file_read(&pressure_files[r]) < 0) {
+            // Kernels without CONFIG_PSI (or booted with psi=0) have no
+            // /proc/pressure at all: not worth a message every sample
+            if (errno != ENOENT && errno != EOPNOTSUPP) perror("Error reading /proc/pressure");
+            continue;
+        }
+
+        for (const char *line = pressure_files[r].buf; *line; line = scan_next_line(line)) {
+            if (strncmp(line, "some ", 5) == 0 && parse_psi_line(line, &psi->some) == 0) {
+                psi->some.stall_percent = stall_percent(psi->some.total_usec, prev_some[r], elapsed);
+                prev_some[r] = psi->some.total_usec;
+                read++;
+            } else if (strncmp(line, "full ", 5) == 0 && parse_psi_line(line, &psi->full) == 0) {
+                // Before 5.13 the cpu file has no full line
+                psi->has_full = 1;
+                psi->full.stall_percent = stall_percent(psi->full.total_usec, prev_full[r], elapsed);
+                prev_full[r] = psi->full.total_usec;
+            }
+        }
+    }
+
+    if (read == 0) return -1;
+
+    pressure_time = time;
+    has_prev = 1;
+    return 0;
+}
+
+// Writes a trigger to a new descriptor of a pressure file; returns the
+// descriptor or -1
+static int open_trigger(const char *path, long stall_ms, long window_ms) {
+    char spec[64];
+
+    int fd = sysmon_open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    // The trigger lives as long as the descriptor it was written to
+    int len = snprintf(spec, sizeof(spec), "some %ld %ld", stall_ms * 1000, window_ms * 1000);
+    ssize_t written = write(fd, spec, (size_t)len + 1);
+    selfstat_io(2, written > 0 ? (unsigned long)written : 0);
+    if (written < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+// Sets a "some" trigger on every resource: a wakeup whenever tasks stalled
+// for stall_ms within window_ms. Returns the number of triggers set; on 0,
+// errno tells why the last one failed.
+int pressure_triggers_open(long stall_ms, long window_ms) {
+    int armed = 0;
+
+    for (int r = 0; r < PSI_RESOURCES; r++) {
+        if (trigger_fds[r] < 0) {
+            int fd = open_trigger(pressure_files[r].path, stall_ms, window_ms);
+
+            // Without CAP_SYS_RESOURCE, 6.5 and later only take windows
+            // that are a multiple of 2 s: retry with the next one up
+            long rounded = (window_ms + 1999) / 2000 * 2000;
+            if (fd < 0 && errno == EINVAL && rounded != window_ms && rounded <= 10000) {
+                fd = open_trigger(pressure_files[r].path, stall_ms, rounded);
+            }
+            trigger_fds[r] = fd;
+        }
+        if (trigger_fds[r] >= 0) armed++;
+    }
+    return armed;
+}
+
+void pressure_triggers_close(void) {
+    for (int r = 0; r < PSI_RESOURCES; r++) {
+        if (trigger_fds[r] >= 0) close(trigger_fds[r]);
+        trigger_fds[r] = -1;
+        trigger_stalls[r] = 0;
+    }
+}
+
+// Descriptor of the trigger on a resource, or -1; wait on it for POLLPRI
+int pressure_trigger_fd(int resource) {
+    return resource >= 0 && resource < PSI_RESOURCES ? trigger_fds[resource] : -1;
+}
+
+// Counts a POLLPRI wakeup of a trigger descriptor towards the next sample
+void pressure_trigger_fired(int fd) {
+    for (int r = 0; r < PSI_RESOURCES; r++) {
+        if (fd >= 0 && trigger_fds[r] == fd) trigger_stalls[r]++;
+    }
+}
@@ -0,0 +1,271 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+// Live process set kept from kernel process events.
+//
+// Listing /proc costs a getdents64 walk over every PID on each refresh. With
+// a NETLINK_CONNECTOR subscription the kernel multicasts an event for every
+// fork, exec and exit instead, and the set is kept as a bitmap indexed by
+// PID: forks add bits, and the process scan removes a PID once its /proc
+// entry is gone. Many kernels only let CAP_NET_ADMIN join the group; where
+// the subscription is refused the caller keeps listing /proc.
+//
+// Exit events do not remove PIDs. The kernel sends one per exiting thread
+// before the process is reaped, and a group leader may exit while its other
+// threads keep running; a /proc listing still shows both, so membership
+// ends when the stat file disappears.
+
+// Messages fetched per recvmmsg() call and the room for each one
+#define EVENT_BATCH 64
+#define EVENT_MSG_SIZE 256
+// Socket receive buffer: events queue here between two refreshes
+#define EVENT_RCVBUF (8 * 1024 * 1024)
+// How long the subscription waits for the kernel's acknowledgement
+#define EVENT_ACK_TIMEOUT_MS 250
+
+static int events_fd = -1;
+static int events_need_seed = 0;        // Set lost or never filled: list /proc once
+static uint32_t events_cookie = 0;      // Tags our listen request
+static uint64_t *live = NULL;           // Bit p set when PID p is alive
+static size_t live_words = 0;
+
+// Sets the bit of a PID, growing the bitmap as needed
+static void live_add(int pid) {
+    size_t word = (size_t)pid / 64;
+
+    if (pid <= 0) return;
+    if (word >= live_words) {
+        size_t words = live_words ? live_words : 1024;
+        while (words <= word) words *= 2;
+        uint64_t *bigger = realloc(live, words * sizeof(uint64_t));
+        if (!bigger) {
+            // A PID missing from the set would never be shown: list /proc again
+            events_need_seed = 1;
+            return;
+        }
+        memset(bigger + live_words, 0, (words - live_words) * sizeof(uint64_t));
+        live = bigger;
+        live_words = words;
+    }
+    live[word] |= 1ull << (pid % 64);
+}
+
+// Sends a listen or ignore request for the process event group
+static int send_mcast_op(enum proc_cn_mcast_op op) {
+    char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(op))] __attribute__((aligned(8)));
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+
+    memset(buf, 0, sizeof(buf));
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+    nlh->nlmsg_type = NLMSG_DONE;
+
+    struct cn_msg *cn = NLMSG_DATA(nlh);
+    cn->id.idx = CN_IDX_PROC;
+    cn->id.val = CN_VAL_PROC;
+    cn->ack = events_cookie;
+    cn->len = sizeof(op);
+    memcpy(cn->data, &op, sizeof(op));
+
+    ssize_t sent = send(events_fd, buf, nlh->nlmsg_len, 0);
+    selfstat_io(1, sent > 0 ? (unsigned long)sent : 0);
+    return sent == (ssize_t)nlh->nlmsg_len ? 0 : -1;
+}
+
+// Applies the events of one datagram; returns the error of a subscription
+// acknowledgement it carries (0 for success), or -1 if there is none
+static int handle_message(char *buf, int len) {
+    int ack = -1;
+
+    for (struct nlmsghdr *h = (struct nlmsghdr *)buf; NLMSG_OK(h, len); h = NLMSG_NEXT(h, len)) {
+        if (h->nlmsg_type != NLMSG_DONE) continue;
+
+        const struct cn_msg *cn = NLMSG_DATA(h);
+        if (cn->id.idx != CN_IDX_PROC || cn->id.val != CN_VAL_PROC) continue;
+
+        const struct proc_event *ev = (const struct proc_event *)cn->data;
+        switch (ev->what) {
+            case PROC_EVENT_NONE:
+                // Acknowledgements go to every listener; ours carries our
+                // cookie plus one in the ack field
+                if (cn->ack == events_cookie + 1) ack = (int)ev->event_data.ack.err;
+                break;
+            case PROC_EVENT_FORK:
+                // New threads are forks too; only new thread groups are processes
+                if (ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid) {
+                    live_add(ev->event_data.fork.child_tgid);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return ack;
+}
+
+// Reads every queued event; returns the last acknowledgement error seen,
+// -1 if none, or -2 when the socket failed
+static int drain_events(void) {
+    static char bufs[EVENT_BATCH][EVENT_MSG_SIZE] __attribute__((aligned(8)));
+    struct mmsghdr msgs[EVENT_BATCH];
+    struct iovec iov[EVENT_BATCH];
+    struct sockaddr_nl from[EVENT_BATCH];
+    int ack = -1;
+
+    for (;;) {
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < EVENT_BATCH; i++) {
+            iov[i].iov_base = bufs[i];
+            iov[i].iov_len = EVENT_MSG_SIZE;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        }
+
+        int n = recvmmsg(events_fd, msgs, EVENT_BATCH, MSG_DONTWAIT, NULL);
+        selfstat_io(1, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return ack;
+            if (errno == ENOBUFS) {
+                // The queue overflowed and events were dropped
+                events_need_seed = 1;
+                continue;
+            }
+            return -2;
+        }
+
+        for (int i = 0; i < n; i++) {
+            selfstat_io(0, msgs[i].msg_len);
+            if (from[i].nl_pid != 0) continue;  // Only the kernel sends events
+            int result = handle_message(bufs[i], (int)msgs[i].msg_len);
+            if (result >= 0) ack = result;
+        }
+        if (n < EVENT_BATCH) return ack;
+    }
+}
+
+// Waits for the kernel to acknowledge the listen request
+static int wait_for_ack(void) {
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        int ack = drain_events();
+        if (ack == -2) return -1;
+        if (ack >= 0) {
+            errno = ack;
+            return ack == 0 ? 0 : -1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long waited = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (waited >= EVENT_ACK_TIMEOUT_MS) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+
+        struct pollfd pfd = {events_fd, POLLIN, 0};
+        poll(&pfd, 1, (int)(EVENT_ACK_TIMEOUT_MS - waited));
+    }
+}
+
+// Subscribes to process events; on failure errno tells why
+int proc_events_open(void) {
+    if (events_fd >= 0) return 0;
+
+    events_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+    if (events_fd < 0) return -1;
+
+    // Joining the group is where unprivileged callers may get EPERM
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_groups = CN_IDX_PROC};
+    if (bind(events_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) goto fail;
+
+    // Bursts of forks between two refreshes have to fit in the queue
+    int size = EVENT_RCVBUF;
+    if (setsockopt(events_fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) != 0) {
+        setsockopt(events_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+
+    events_cookie = (uint32_t)getpid();
+    if (send_mcast_op(PROC_CN_MCAST_LISTEN) != 0 || wait_for_ack() != 0) goto fail;
+
+    events_need_seed = 1;
+    return 0;
+
+fail:;
+    int saved = errno;
+    close(events_fd);
+    events_fd = -1;
+    errno = saved;
+    return -1;
+}
+
+void proc_events_close(void) {
+    if (events_fd < 0) return;
+
+    // The kernel counts listeners and keeps building events while any remain
+    send_mcast_op(PROC_CN_MCAST_IGNORE);
+    close(events_fd);
+    events_fd = -1;
+    free(live);
+    live = NULL;
+    live_words = 0;
+}
+
+int proc_events_active(void) {
+    return events_fd >= 0;
+}
+
+// Applies the queued events. Returns 1 when the set has to be seeded from a
+// /proc listing first (new subscription or lost events), 0 when it is
+// current, or -1 if the subscription broke and /proc has to be listed from
+// now on.
+int proc_events_update(void) {
+    if (events_fd < 0) return -1;
+
+    if (drain_events() == -2) {
+        perror("Error reading process events");
+        proc_events_close();
+        return -1;
+    }
+    return events_need_seed;
+}
+
+// Replaces the set with a full /proc listing
+void proc_events_seed(const int *pids, size_t count) {
+    if (live) memset(live, 0, live_words * sizeof(uint64_t));
+    events_need_seed = 0;
+    for (size_t i = 0; i < count; i++) live_add(pids[i]);
+}
+
+// Drops a PID whose /proc entry is gone
+void proc_events_forget(int pid) {
+    size_t word = (size_t)pid / 64;
+    if (pid > 0 && word < live_words) live[word] &= ~(1ull << (pid % 64));
+}
+
+// Copies the live PIDs in ascending order into *pids, growing it as needed;
+// returns their number or -1
+ssize_t proc_events_list(int **pids, size_t *cap) {
+    size_t count = 0;
+
+    for (size_t w = 0; w < live_words; w++) {
+        for (uint64_t bits = live[w]; bits; bits &= bits - 1) {
+            if (count == *cap) {
+                size_t new_cap = *cap ? *cap * 2 : 1024;
+                int *bigger = realloc(*pids, new_cap * sizeof(int));
+                if (!bigger) return -1;
+                *pids = bigger;
+                *cap = new_cap;
+            }
+            (*pids)[count++] = (int)(w * 64 + (size_t)__builtin_ctzll(bits));
+        }
+    }
+    return (ssize_t)count;
+}
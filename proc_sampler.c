@@ -0,0 +1,178 @@
+#include "sysmon.h"
+#include <fcntl.h>
+#include <errno.h>
+
+// Initial buffer size for a sampled file; grows on demand and is then reused
+#define PROC_FILE_INITIAL_CAP 4096
+
+// Directories the collectors read "/proc" and "/sys" from. Fixture trees
+// replace them; every change bumps the generation so persistent
+// descriptors opened under the old roots get reopened.
+static char proc_root[PATH_MAX] = "/proc";
+static char sys_root[PATH_MAX] = "/sys";
+static unsigned int root_generation = 1;
+
+// Sets the procfs and sysfs roots (NULL keeps the current one).
+// Call before sampling or between samples, never during one.
+int sysmon_set_roots(const char *new_proc_root, const char *new_sys_root) {
+    if ((new_proc_root && strlen(new_proc_root) >= sizeof(proc_root)) ||
+        (new_sys_root && strlen(new_sys_root) >= sizeof(sys_root))) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (new_proc_root) strcpy(proc_root, new_proc_root);
+    if (new_sys_root) strcpy(sys_root, new_sys_root);
+    root_generation++;
+    return 0;
+}
+
+unsigned int sysmon_root_generation(void) {
+    return root_generation;
+}
+
+// Maps an absolute "/proc..." or "/sys..." path onto the configured roots.
+// Returns path itself when it is not under either or no remapping is needed.
+const char *sysmon_path(const char *path, char *buf, size_t size) {
+    const char *root = NULL;
+    size_t prefix = 0;
+
+    if (strncmp(path, "/proc", 5) == 0 && (path[5] == '/' || path[5] == '\0')) {
+        root = proc_root;
+        prefix = 5;
+    } else if (strncmp(path, "/sys", 4) == 0 && (path[4] == '/' || path[4] == '\0')) {
+        root = sys_root;
+        prefix = 4;
+    }
+    if (!root || (strncmp(root, path, prefix) == 0 && root[prefix] == '\0')) return path;
+
+    snprintf(buf, size, "%s%s", root, path + prefix);
+    return buf;
+}
+
+// open() of a /proc or /sys path under the configured roots
+int sysmon_open(const char *path, int flags) {
+    char buf[PATH_MAX];
+    return open(sysmon_path(path, buf, sizeof(buf)), flags);
+}
+
+// Opens the file on first use and keeps the descriptor for later samples
+static int proc_file_open(proc_file_t *pf) {
+    if (pf->fd >= 0 && pf->generation == root_generation) return 0;
+
+    if (pf->fd >= 0) close(pf->fd);
+    pf->generation = root_generation;
+    pf->fd = sysmon_open(pf->path, O_RDONLY | O_CLOEXEC);
+    selfstat_io(1, 0);
+    if (pf->fd < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Doubles the buffer capacity, keeping the bytes already read
+static int proc_file_grow(proc_file_t *pf) {
+    size_t new_cap = pf->cap ? pf->cap * 2 : PROC_FILE_INITIAL_CAP;
+    char *new_buf = realloc(pf->buf, new_cap);
+    if (!new_buf) return -1;
+
+    pf->buf = new_buf;
+    pf->cap = new_cap;
+    return 0;
+}
+
+// Re-reads the whole file from offset 0 into the persistent buffer.
+// procfs fills the user buffer as far as it can on every read, so a short
+// read marks the end of the file and saves the extra read that returns 0.
+ssize_t proc_file_read(proc_file_t *pf) {
+    if (proc_file_open(pf) != 0) return -1;
+
+    if (!pf->buf && proc_file_grow(pf) != 0) return -1;
+
+    pf->len = 0;
+    for (;;) {
+        size_t room = pf->cap - pf->len - 1;   // Keep one byte for the terminator
+        ssize_t n = pread(pf->fd, pf->buf + pf->len, room, (off_t)pf->len);
+        selfstat_io(1, n > 0 ? (unsigned long)n : 0);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        pf->len += (size_t)n;
+        if ((size_t)n < room) break;
+
+        // Buffer filled up completely, grow it and keep reading
+        if (proc_file_grow(pf) != 0) return -1;
+    }
+
+    pf->buf[pf->len] = '\0';
+    return (ssize_t)pf->len;
+}
+
+void proc_file_close(proc_file_t *pf) {
+    if (pf->fd >= 0) {
+        close(pf->fd);
+        pf->fd = -1;
+    }
+    free(pf->buf);
+    pf->buf = NULL;
+    pf->cap = 0;
+    pf->len = 0;
+}
+
+// Doubles an array until it holds count entries. Returns the array, moved or
+// not, or NULL when out of memory, in which case the old one is left intact.
+void *grow_array(void *ptr, int *cap, int count, size_t size) {
+    if (ptr && count <= *cap) return ptr;
+
+    int new_cap = *cap ? *cap : 16;
+    while (new_cap < count) new_cap *= 2;
+    void *bigger = realloc(ptr, (size_t)new_cap * size);
+    if (!bigger) return NULL;
+
+    *cap = new_cap;
+    return bigger;
+}
+
+// qsort comparator for ascending ints
+int compare_ints(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Skips spaces and tabs (but not newlines)
+const char *scan_skip_spaces(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+// Parses an unsigned decimal number after optional blanks.
+// Returns the position after the number, or NULL if there were no digits.
+const char *scan_ulong(const char *p, unsigned long *value) {
+    unsigned long v = 0;
+
+    p = scan_skip_spaces(p);
+    if (*p < '0' || *p > '9') return NULL;
+
+    while (*p >= '0' && *p <= '9') {
+        v = v * 10 + (unsigned long)(*p - '0');
+        p++;
+    }
+    *value = v;
+    return p;
+}
+
+// Returns the start of the next line, or the terminating NUL
+const char *scan_next_line(const char *p) {
+    while (*p && *p != '\n') p++;
+    return *p ? p + 1 : p;
+}
+
+// Finds "<key>" at the start of a line and parses the number after it
+int scan_key(const char *buf, const char *key, size_t key_len, unsigned long *value) {
+    for (const char *line = buf; *line; line = scan_next_line(line)) {
+        if (strncmp(line, key, key_len) == 0) return scan_ulong(line + key_len, value) ? 0 : -1;
+    }
+    return -1;
+}
@@ -0,0 +1,190 @@
+#include "sysmon.h"
+
+// Smallest table size; the table never shrinks below this
+#define PROC_TABLE_MIN_CAP 256
+
+// Knuth multiplicative hash of a PID into a power-of-two table. The slot is
+// the top bits of the 32-bit product, the ones every PID bit feeds into; the
+// low bits only mix the low bits of the PID.
+static size_t pid_slot(int pid, size_t mask) {
+    uint32_t product = (uint32_t)pid * 2654435761u;
+    return (size_t)(product >> (32 - __builtin_popcountll((unsigned long long)mask)));
+}
+
+static double clock_seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Reinserts every live entry into a table of the given capacity
+static int proc_table_resize(proc_table_t *table, size_t new_cap) {
+    proc_entry_t *slots = calloc(new_cap, sizeof(proc_entry_t));
+    if (!slots) return -1;
+
+    size_t mask = new_cap - 1;
+    for (size_t i = 0; i < table->capacity; i++) {
+        const proc_entry_t *entry = &table->slots[i];
+        if (entry->pid == 0) continue;
+
+        size_t slot = pid_slot(entry->pid, mask);
+        while (slots[slot].pid != 0) slot = (slot + 1) & mask;
+        slots[slot] = *entry;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = new_cap;
+    return 0;
+}
+
+// Empties slot i and shifts the rest of its probe cluster back so that
+// lookups never need tombstones
+static void proc_table_remove_at(proc_table_t *table, size_t i) {
+    size_t mask = table->capacity - 1;
+    size_t hole = i;
+    size_t j = i;
+
+    for (;;) {
+        j = (j + 1) & mask;
+        if (table->slots[j].pid == 0) break;
+
+        // Move the entry into the hole unless its home slot lies
+        // cyclically within (hole, j]
+        size_t home = pid_slot(table->slots[j].pid, mask);
+        int home_in_range = (hole <= j) ? (hole < home && home <= j)
+                                        : (hole < home || home <= j);
+        if (!home_in_range) {
+            table->slots[hole] = table->slots[j];
+            hole = j;
+        }
+    }
+
+    memset(&table->slots[hole], 0, sizeof(proc_entry_t));
+    table->count--;
+}
+
+int proc_table_init(proc_table_t *table) {
+    memset(table, 0, sizeof(proc_table_t));
+
+    table->slots = calloc(PROC_TABLE_MIN_CAP, sizeof(proc_entry_t));
+    if (!table->slots) return -1;
+
+    table->capacity = PROC_TABLE_MIN_CAP;
+    table->clk_tck = sysconf(_SC_CLK_TCK);
+    if (table->clk_tck <= 0) table->clk_tck = 100;
+    return 0;
+}
+
+void proc_table_free(proc_table_t *table) {
+    free(table->slots);
+    memset(table, 0, sizeof(proc_table_t));
+}
+
+// Starts a new sampling pass and measures the interval since the last one
+void proc_table_begin(proc_table_t *table) {
+    double now = clock_seconds(CLOCK_MONOTONIC);
+
+    table->generation++;
+    table->elapsed = table->last_sample > 0 ? now - table->last_sample : 0.0;
+    table->last_sample = now;
+    table->boot_seconds = clock_seconds(CLOCK_BOOTTIME);
+}
+
+// Finds or creates the entry for a process and marks it seen in this pass.
+// A recycled PID (same PID, different start time) resets the entry.
+proc_entry_t *proc_table_sample(proc_table_t *table, int pid, unsigned long long starttime) {
+    if ((table->count + 1) * 4 > table->capacity * 3 &&
+        proc_table_resize(table, table->capacity * 2) != 0) {
+        return NULL;
+    }
+
+    size_t mask = table->capacity - 1;
+    size_t slot = pid_slot(pid, mask);
+    while (table->slots[slot].pid != 0 && table->slots[slot].pid != pid) {
+        slot = (slot + 1) & mask;
+    }
+
+    proc_entry_t *entry = &table->slots[slot];
+    if (entry->pid == 0 || entry->starttime != starttime) {
+        if (entry->pid == 0) table->count++;
+        memset(entry, 0, sizeof(proc_entry_t));
+        entry->pid = pid;
+        entry->starttime = starttime;
+        entry->fresh = 1;
+    } else {
+        entry->fresh = 0;
+    }
+    entry->seen = table->generation;
+    return entry;
+}
+
+// Finds the entry of a process without creating one
+proc_entry_t *proc_table_find(proc_table_t *table, int pid) {
+    size_t mask = table->capacity - 1;
+    size_t slot = pid_slot(pid, mask);
+
+    while (table->slots[slot].pid != 0) {
+        if (table->slots[slot].pid == pid) return &table->slots[slot];
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+// Rate of a counter whose previous value is known to be from the last pass,
+// otherwise its average since the process started
+static double counter_rate(const proc_table_t *table, const proc_entry_t *entry, int known,
+                           unsigned long long *previous, unsigned long long current) {
+    double rate = 0.0;
+
+    if (known && table->elapsed > 0) {
+        if (current >= *previous) rate = (current - *previous) / table->elapsed;
+    } else {
+        double age = table->boot_seconds - (double)entry->starttime / table->clk_tck;
+        if (age > 0) rate = current / age;
+    }
+
+    *previous = current;
+    return rate;
+}
+
+// Returns the per-second rate of a cumulative counter and stores the new value.
+// Known processes get the rate over the last interval; fresh entries get the
+// average since the process started.
+double proc_table_rate(const proc_table_t *table, const proc_entry_t *entry,
+                       unsigned long long *previous, unsigned long long current) {
+    return counter_rate(table, entry, !entry->fresh, previous, current);
+}
+
+// Same for counters that are only read for some passes (entry->detail_seen):
+// the stored value is only a previous sample if it was read in the last pass
+double proc_table_detail_rate(const proc_table_t *table, const proc_entry_t *entry,
+                              unsigned long long *previous, unsigned long long current) {
+    int known = !entry->fresh && entry->detail_seen + 1 == table->generation;
+    return counter_rate(table, entry, known, previous, current);
+}
+
+// Drops processes not seen in this pass and shrinks the table after mass exits
+void proc_table_end(proc_table_t *table) {
+    size_t mask = table->capacity - 1;
+    size_t start = 0;
+
+    // Begin the sweep right after an empty slot so that entries moved back by
+    // proc_table_remove_at() are always revisited
+    while (table->slots[start].pid != 0) start++;
+
+    for (size_t n = 1; n <= table->capacity; n++) {
+        size_t i = (start + n) & mask;
+        while (table->slots[i].pid != 0 && table->slots[i].seen != table->generation) {
+            proc_table_remove_at(table, i);
+        }
+    }
+
+    size_t new_cap = table->capacity;
+    while (new_cap > PROC_TABLE_MIN_CAP && table->count * 8 < new_cap) {
+        new_cap /= 2;
+    }
+    if (new_cap != table->capacity) {
+        proc_table_resize(table, new_cap);
+    }
+}
@@ -0,0 +1,520 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+// The process table is split into shards, each behind its own lock, so
+// scan workers rarely contend on it
+#define PROC_TABLE_SHARDS 16
+// Number of PIDs a scan worker claims at a time
+#define SCAN_CHUNK 64
+// Size of the getdents64 buffer used to list /proc
+#define DIRENT_BUF_SIZE 32768
+
+// Previous per-process samples used to turn counters into rates
+static proc_table_t proc_tables[PROC_TABLE_SHARDS];
+static pthread_mutex_t proc_table_locks[PROC_TABLE_SHARDS];
+static int proc_table_ready = 0;
+
+// Persistent /proc directory handle and the PID list of the current pass
+static int proc_dirfd = -1;
+static unsigned int proc_dir_generation = 0;
+static int *scan_pids = NULL;
+static size_t scan_pid_cap = 0;
+
+// Kilobytes per page, for the RSS field of /proc/[pid]/stat
+static unsigned long page_kb = 4;
+
+// Record layout returned by the getdents64 syscall
+struct linux_dirent64 {
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Per-worker state: a thread-local top-K heap, padded to its own cache lines
+typedef struct {
+    process_info_t heap[MAX_TOP_PROCESSES];
+    int count;
+} __attribute__((aligned(64))) scan_worker_t;
+
+// Work shared by all workers during one pass
+typedef struct {
+    int *pids;                          // PIDs to sample; gone ones are negated
+    size_t pid_count;                   // Number of PIDs
+    size_t next;                        // Next unclaimed index (atomic)
+    int max_count;                      // K
+    proc_sort_t sort_key;               // Ranking key
+    scan_worker_t *workers;             // One entry per pool worker
+} scan_job_t;
+
+static scan_worker_t *scan_workers = NULL;
+static int scan_worker_count = 0;
+
+// Returns the value processes are ranked by for the given sort key
+static double process_sort_value(const process_info_t *proc, proc_sort_t sort_key) {
+    switch (sort_key) {
+        case SORT_RSS:     return (double)proc->memory_kb;
+        case SORT_IO:      return proc->io_rate;
+        case SORT_THREADS: return (double)proc->threads;
+        case SORT_CPU:
+        default:           return proc->cpu_percent;
+    }
+}
+
+// True when a ranks below b. Ties go to the lower PID so the same processes
+// make the cut on every scan instead of whichever the heap met first.
+static int ranks_below(const process_info_t *a, const process_info_t *b, proc_sort_t sort_key) {
+    double va = process_sort_value(a, sort_key), vb = process_sort_value(b, sort_key);
+    return va < vb || (va == vb && a->pid > b->pid);
+}
+
+// Restores the min-heap property below index i
+static void heap_sift_down(process_info_t *heap, int count, int i, proc_sort_t sort_key) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < count && ranks_below(&heap[left], &heap[smallest], sort_key)) smallest = left;
+        if (right < count && ranks_below(&heap[right], &heap[smallest], sort_key)) smallest = right;
+        if (smallest == i) return;
+
+        process_info_t tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+// Restores the min-heap property above index i
+static void heap_sift_up(process_info_t *heap, int i, proc_sort_t sort_key) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!ranks_below(&heap[i], &heap[parent], sort_key)) return;
+
+        process_info_t tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+// Returns the heap slot a candidate should be written to, or -1 if it does
+// not rank among the top max_count. The lowest ranked kept process sits at
+// heap[0].
+static int heap_slot_for(process_info_t *heap, int *count, int max_count,
+                         const process_info_t *candidate, proc_sort_t sort_key) {
+    if (*count < max_count) return (*count)++;
+    if (!ranks_below(&heap[0], candidate, sort_key)) return -1;
+    return 0;
+}
+
+// Places the candidate written at slot back into heap order
+static void heap_fix(process_info_t *heap, int count, int slot, proc_sort_t sort_key) {
+    if (slot == 0) {
+        heap_sift_down(heap, count, 0, sort_key);
+    } else {
+        heap_sift_up(heap, slot, sort_key);
+    }
+}
+
+// Reads "<pid>/<file>" relative to the /proc descriptor with a single
+// openat + read. Returns the number of bytes read (NUL-terminated) or -1.
+static ssize_t read_pid_file(int pid, const char *file, char *buf, size_t size) {
+    char path[32];
+    char digits[16];
+    int n = 0, len = 0;
+
+    // Format the path by hand, this runs once per process per refresh
+    do {
+        digits[n++] = (char)('0' + pid % 10);
+        pid /= 10;
+    } while (pid > 0);
+    while (n > 0) path[len++] = digits[--n];
+    path[len++] = '/';
+    while (*file && len < (int)sizeof(path) - 1) path[len++] = *file++;
+    path[len] = '\0';
+
+    int fd = openat(proc_dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        selfstat_io(1, 0);
+        return -1;
+    }
+
+    ssize_t bytes = read(fd, buf, size - 1);
+    close(fd);
+    selfstat_io(3, bytes > 0 ? (unsigned long)bytes : 0);
+    if (bytes < 0) return -1;
+
+    buf[bytes] = '\0';
+    return bytes;
+}
+
+// Reads read_bytes and write_bytes from /proc/[pid]/io (storage I/O only)
+static int read_process_io(int pid, unsigned long *read_bytes, unsigned long *write_bytes) {
+    char buf[MAX_LINE_LEN];
+
+    if (read_pid_file(pid, "io", buf, sizeof(buf)) < 0) return -1;
+
+    // read_bytes comes first, write_bytes right after it
+    const char *p = strstr(buf, "\nread_bytes:");
+    if (!p || scan_key(p + 1, "read_bytes:", 11, read_bytes) != 0) return -1;
+    return scan_key(scan_next_line(p + 1), "write_bytes:", 12, write_bytes);
+}
+
+// Reads the context switch counters, the last two lines of /proc/[pid]/status
+static int read_process_ctxsw(int pid, unsigned long *voluntary, unsigned long *involuntary) {
+    char buf[4096];
+
+    if (read_pid_file(pid, "status", buf, sizeof(buf)) < 0) return -1;
+
+    const char *p = strstr(buf, "\nvoluntary_ctxt_switches:");
+    if (!p || scan_key(p + 1, "voluntary_ctxt_switches:", 24, voluntary) != 0) return -1;
+    return scan_key(scan_next_line(p + 1), "nonvoluntary_ctxt_switches:", 27, involuntary);
+}
+
+// Reads the proportional set size in KB from /proc/[pid]/smaps_rollup, which
+// the kernel computes by walking the page tables: worth it for a few
+// processes only. Returns -1 if not readable (other users' processes).
+static long read_process_pss(int pid) {
+    char buf[2048];
+    unsigned long pss;
+
+    if (read_pid_file(pid, "smaps_rollup", buf, sizeof(buf)) < 0) return -1;
+
+    const char *p = strstr(buf, "\nPss:");
+    if (!p || scan_key(p + 1, "Pss:", 4, &pss) != 0) return -1;
+    return (long)pss;
+}
+
+// Fields of /proc/[pid]/stat used by the process collector
+typedef struct {
+    const char *comm;                   // Command name, points into the read buffer
+    size_t comm_len;                    // Length of comm
+    unsigned long majflt;               // Field 12: major page faults
+    unsigned long utime;                // Field 14: user mode ticks
+    unsigned long stime;                // Field 15: kernel mode ticks
+    unsigned long threads;              // Field 20: num_threads
+    unsigned long starttime;            // Field 22: start time in ticks after boot
+    unsigned long vsize;                // Field 23: virtual memory size in bytes
+    unsigned long rss;                  // Field 24: resident set size in pages
+} proc_stat_t;
+
+// Parses a /proc/[pid]/stat line in one pass without copying.
+// comm may contain spaces and ')' so it ends at the last ')' in the line.
+static int parse_proc_stat(const char *buf, size_t len, proc_stat_t *st) {
+    const char *open_paren = memchr(buf, '(', len);
+    const char *close_paren = memrchr(buf, ')', len);
+    if (!open_paren || !close_paren || close_paren < open_paren) return -1;
+
+    st->comm = open_paren + 1;
+    st->comm_len = (size_t)(close_paren - st->comm);
+
+    // Field 3 (state) follows the closing parenthesis
+    const char *p = close_paren + 1;
+    for (int field = 3; field <= 24; field++) {
+        unsigned long *target = NULL;
+
+        p = scan_skip_spaces(p);
+        if (*p == '\0' || *p == '\n') return -1;
+
+        switch (field) {
+            case 12: target = &st->majflt; break;
+            case 14: target = &st->utime; break;
+            case 15: target = &st->stime; break;
+            case 20: target = &st->threads; break;
+            case 22: target = &st->starttime; break;
+            case 23: target = &st->vsize; break;
+            case 24: target = &st->rss; break;
+        }
+
+        if (target) {
+            p = scan_ulong(p, target);
+            if (!p) return -1;
+        } else {
+            // Skip fields that are not needed (some may be negative)
+            while (*p && *p != ' ' && *p != '\n') p++;
+        }
+    }
+    return 0;
+}
+
+// Heap-sorts the min-heap in place, leaving it ordered highest value first
+static void heap_sort_descending(process_info_t *heap, int count, proc_sort_t sort_key) {
+    for (int n = count - 1; n > 0; n--) {
+        process_info_t tmp = heap[0];
+        heap[0] = heap[n];
+        heap[n] = tmp;
+        heap_sift_down(heap, n, 0, sort_key);
+    }
+}
+
+// Allocates the table shards on first use and (re)opens the /proc
+// directory whenever the procfs root changed
+static int process_scan_init(void) {
+    if (!proc_table_ready) {
+        for (int i = 0; i < PROC_TABLE_SHARDS; i++) {
+            if (proc_table_init(&proc_tables[i]) != 0) return -1;
+            pthread_mutex_init(&proc_table_locks[i], NULL);
+        }
+        proc_table_ready = 1;
+
+        long page_size = sysconf(_SC_PAGESIZE);
+        if (page_size >= 1024) page_kb = (unsigned long)page_size / 1024;
+    }
+
+    if (proc_dirfd >= 0 && proc_dir_generation == sysmon_root_generation()) return 0;
+
+    if (proc_dirfd >= 0) close(proc_dirfd);
+    proc_dir_generation = sysmon_root_generation();
+    proc_dirfd = sysmon_open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_dirfd < 0) return -1;
+    return 0;
+}
+
+// Sets the number of scan threads (1 scans on the calling thread only)
+int process_scan_set_threads(int threads) {
+    if (threads < 1) threads = 1;
+
+    if (thread_pool_start(threads) != 0) return -1;
+    threads = thread_pool_size();
+
+    scan_worker_t *workers = NULL;
+    if (posix_memalign((void **)&workers, 64, threads * sizeof(scan_worker_t)) != 0) {
+        return -1;
+    }
+    free(scan_workers);
+    scan_workers = workers;
+    scan_worker_count = threads;
+    return 0;
+}
+
+// Lists the numeric entries of /proc with getdents64 into scan_pids
+static ssize_t list_pids(void) {
+    static char buf[DIRENT_BUF_SIZE] __attribute__((aligned(8)));
+    size_t count = 0;
+
+    selfstat_io(1, 0);
+    if (lseek(proc_dirfd, 0, SEEK_SET) < 0) return -1;
+
+    for (;;) {
+        long n = syscall(SYS_getdents64, proc_dirfd, buf, sizeof(buf));
+        selfstat_io(1, n > 0 ? (unsigned long)n : 0);
+        if (n < 0) return -1;
+        if (n == 0) break;
+
+        for (long off = 0; off < n;) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+
+            // Skip non-numeric entries (only process IDs are numeric)
+            if (d->d_name[0] < '0' || d->d_name[0] > '9') continue;
+
+            unsigned long pid;
+            if (!scan_ulong(d->d_name, &pid) || pid == 0) continue;
+
+            if (count == scan_pid_cap) {
+                size_t new_cap = scan_pid_cap ? scan_pid_cap * 2 : 1024;
+                int *pids = realloc(scan_pids, new_cap * sizeof(int));
+                if (!pids) return -1;
+                scan_pids = pids;
+                scan_pid_cap = new_cap;
+            }
+            scan_pids[count++] = (int)pid;
+        }
+    }
+    return (ssize_t)count;
+}
+
+// Samples one process and offers it to the worker's heap. Returns -1 if the
+// process is gone, 0 otherwise.
+static int scan_process(int pid, const scan_job_t *job, scan_worker_t *worker) {
+    char buf[1024];
+    proc_stat_t st;
+
+    // Name and statistics both come from a single read of /proc/[pid]/stat
+    ssize_t len = read_pid_file(pid, "stat", buf, sizeof(buf));
+    if (len < 0 && (errno == ENOENT || errno == ESRCH)) return -1;
+    if (len <= 0 || parse_proc_stat(buf, (size_t)len, &st) != 0) return 0;
+
+    process_info_t candidate;
+    memset(&candidate, 0, sizeof(candidate));
+    candidate.pid = pid;
+    candidate.threads = (int)st.threads;
+    candidate.memory_kb = st.rss * page_kb;
+    candidate.io_rate = -1.0;
+    candidate.read_bytes_per_sec = -1.0;
+    candidate.write_bytes_per_sec = -1.0;
+
+    // I/O counters cost an extra open, so every process only gets them when
+    // ranking by I/O; otherwise sample_details() reads them for the top K
+    unsigned long read_bytes, write_bytes;
+    int have_io = job->sort_key == SORT_IO && read_process_io(pid, &read_bytes, &write_bytes) == 0;
+
+    // Calculate CPU usage over the last interval
+    int shard = pid % PROC_TABLE_SHARDS;
+    proc_table_t *table = &proc_tables[shard];
+    pthread_mutex_lock(&proc_table_locks[shard]);
+    proc_entry_t *prev = proc_table_sample(table, pid, st.starttime);
+    if (prev) {
+        candidate.cpu_percent = 100.0 / table->clk_tck *
+                                proc_table_rate(table, prev, &prev->ticks, st.utime + st.stime);
+        candidate.major_faults_per_sec = proc_table_rate(table, prev, &prev->major_faults, st.majflt);
+        if (have_io) {
+            candidate.read_bytes_per_sec = proc_table_rate(table, prev, &prev->read_bytes, read_bytes);
+            candidate.write_bytes_per_sec = proc_table_rate(table, prev, &prev->write_bytes, write_bytes);
+            candidate.io_rate = candidate.read_bytes_per_sec + candidate.write_bytes_per_sec;
+        }
+    }
+    pthread_mutex_unlock(&proc_table_locks[shard]);
+    if (!prev) return 0;
+
+    int slot = heap_slot_for(worker->heap, &worker->count, job->max_count, &candidate,
+                             job->sort_key);
+    if (slot < 0) return 0;
+
+    // Only processes that make the cut get their name copied out of the buffer
+    size_t name_len = st.comm_len;
+    if (name_len >= MAX_PROC_NAME) name_len = MAX_PROC_NAME - 1;
+    memcpy(candidate.name, st.comm, name_len);
+    candidate.name[name_len] = '\0';
+
+    worker->heap[slot] = candidate;
+    heap_fix(worker->heap, worker->count, slot, job->sort_key);
+    return 0;
+}
+
+// Reads the counters that cost a file each for a process that made the cut
+static void sample_details(process_info_t *proc, proc_sort_t sort_key) {
+    unsigned long read_bytes, write_bytes, voluntary, involuntary;
+
+    int have_io = sort_key != SORT_IO && read_process_io(proc->pid, &read_bytes, &write_bytes) == 0;
+    int have_ctxsw = read_process_ctxsw(proc->pid, &voluntary, &involuntary) == 0;
+    proc->pss_kb = read_process_pss(proc->pid);
+    proc->voluntary_ctxsw_per_sec = -1.0;
+    proc->involuntary_ctxsw_per_sec = -1.0;
+
+    int shard = proc->pid % PROC_TABLE_SHARDS;
+    proc_table_t *table = &proc_tables[shard];
+    pthread_mutex_lock(&proc_table_locks[shard]);
+    proc_entry_t *entry = proc_table_find(table, proc->pid);
+    if (entry) {
+        // Rates over the interval when the process was also in the last
+        // top K, else averages since it started
+        if (have_io) {
+            proc->read_bytes_per_sec = proc_table_detail_rate(table, entry, &entry->read_bytes, read_bytes);
+            proc->write_bytes_per_sec = proc_table_detail_rate(table, entry, &entry->write_bytes, write_bytes);
+            proc->io_rate = proc->read_bytes_per_sec + proc->write_bytes_per_sec;
+        }
+        if (have_ctxsw) {
+            proc->voluntary_ctxsw_per_sec = proc_table_detail_rate(table, entry, &entry->voluntary_ctxsw,
+                                                                   voluntary);
+            proc->involuntary_ctxsw_per_sec = proc_table_detail_rate(table, entry, &entry->involuntary_ctxsw,
+                                                                     involuntary);
+        }
+        entry->detail_seen = table->generation;
+    }
+    pthread_mutex_unlock(&proc_table_locks[shard]);
+}
+
+// Pool task: claims chunks of the PID list until none are left
+static void scan_worker_main(void *arg, int index) {
+    scan_job_t *job = arg;
+    scan_worker_t *worker = &job->workers[index];
+
+    // The caller's share is measured by the processes probe around the scan
+    selfstat_span_t span;
+    if (index > 0) selfstat_begin(&span, PROBE_SCAN_WORKER);
+
+    worker->count = 0;
+    for (;;) {
+        size_t begin = __atomic_fetch_add(&job->next, SCAN_CHUNK, __ATOMIC_RELAXED);
+        if (begin >= job->pid_count) break;
+
+        size_t end = begin + SCAN_CHUNK;
+        if (end > job->pid_count) end = job->pid_count;
+
+        for (size_t i = begin; i < end; i++) {
+            if (scan_process(job->pids[i], job, worker) < 0) job->pids[i] = -job->pids[i];
+        }
+    }
+
+    if (index > 0) selfstat_end(&span);
+}
+
+int read_top_processes(process_info_t *processes, int max_count, proc_sort_t sort_key) {
+    int count = 0;
+
+    memset(processes, 0, max_count * sizeof(process_info_t));
+
+    if (process_scan_init() != 0) {
+        perror("Error initializing process scan");
+        return 0;
+    }
+    if (!scan_workers && process_scan_set_threads(1) != 0) {
+        perror("Error allocating scan workers");
+        return 0;
+    }
+
+    // The live set from process events replaces the /proc listing, which
+    // is only needed to seed it
+    int events = proc_events_update();
+    ssize_t pid_count = events == 0 ? proc_events_list(&scan_pids, &scan_pid_cap) : list_pids();
+    if (pid_count < 0) {
+        perror("Error reading /proc");
+        return 0;
+    }
+    if (events == 1) proc_events_seed(scan_pids, (size_t)pid_count);
+
+    for (int i = 0; i < PROC_TABLE_SHARDS; i++) {
+        proc_table_begin(&proc_tables[i]);
+    }
+
+    // Scan every process, each worker keeping its own top max_count
+    scan_job_t job = {
+        .pids = scan_pids,
+        .pid_count = (size_t)pid_count,
+        .next = 0,
+        .max_count = max_count,
+        .sort_key = sort_key,
+        .workers = scan_workers,
+    };
+    thread_pool_run(scan_worker_main, &job);
+
+    // Merge the per-worker heaps into the final top max_count
+    for (int w = 0; w < scan_worker_count; w++) {
+        for (int i = 0; i < scan_workers[w].count; i++) {
+            const process_info_t *proc = &scan_workers[w].heap[i];
+            int slot = heap_slot_for(processes, &count, max_count, proc, sort_key);
+            if (slot < 0) continue;
+
+            processes[slot] = *proc;
+            heap_fix(processes, count, slot, sort_key);
+        }
+    }
+
+    // Extra counters only for the processes that made the cut, so they do
+    // not multiply the per-process cost of the scan
+    for (int i = 0; i < count; i++) {
+        sample_details(&processes[i], sort_key);
+    }
+
+    // Forget processes that exited since the previous pass
+    if (events >= 0) {
+        for (ssize_t i = 0; i < pid_count; i++) {
+            if (scan_pids[i] < 0) proc_events_forget(-scan_pids[i]);
+        }
+    }
+    for (int i = 0; i < PROC_TABLE_SHARDS; i++) {
+        proc_table_end(&proc_tables[i]);
+    }
+
+    // Sort the kept processes by the selected key (highest first)
+    heap_sort_descending(processes, count, sort_key);
+
+    return count;
+}
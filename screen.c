@@ -0,0 +1,336 @@
+#include "sysmon.h"
+#include <errno.h>
+#include <sys/ioctl.h>
+
+// Diffing terminal renderer for watch mode.
+//
+// A frame is composed by the regular display functions into a memory stream,
+// parsed into a grid of cells (one UTF-8 glyph plus its color each) and
+// compared with the grid of the previous frame. Only the cells that changed
+// are emitted, with cursor moves and color changes in between, and the whole
+// update goes out in a single write().
+
+// Grid size when the output is not a terminal
+#define SCREEN_DEFAULT_COLS 256
+#define SCREEN_DEFAULT_ROWS 256
+
+// Unchanged cells up to this length are rewritten instead of moving the cursor
+#define SCREEN_MAX_SKIP 4
+
+// Cell style: foreground color 1-8 (0 = default) and a bold bit
+#define STYLE_BOLD 0x10
+
+typedef struct {
+    char bytes[4];                      // UTF-8 encoded glyph
+    uint8_t len;                        // Bytes used in bytes[]
+    uint8_t style;                      // Foreground color and STYLE_BOLD
+} screen_cell_t;
+
+static struct {
+    int fd;                             // Terminal descriptor
+    int rows, cols;                     // Grid size
+    int height, width;                  // Area used by the frame on the terminal
+    int cur_height, cur_width;          // Area still dirty in the cur grid
+    int drawn;                          // The terminal shows the previous frame
+    screen_cell_t *cur;                 // Frame being composed
+    screen_cell_t *prev;                // Frame on the terminal
+    FILE *frame;                        // Memory stream the frame is printed to
+    char *frame_buf;                    // Its buffer, owned by the stream
+    size_t frame_size;
+    char *out;                          // Escape sequences for one update
+    size_t out_len, out_cap;
+} screen = {.fd = STDOUT_FILENO};
+
+// Set when the terminal may have changed size (SIGWINCH)
+static int screen_resized = 0;
+
+static const screen_cell_t blank_cell = {{' '}, 1, 0};
+
+// Blanks the top-left rows x cols area of a grid
+static void screen_fill_blank(screen_cell_t *grid, int rows, int cols) {
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) grid[r * screen.cols + c] = blank_cell;
+    }
+}
+
+// Sizes the grids to the terminal; a new size forces a full redraw
+static int screen_resize(void) {
+    struct winsize ws;
+    int rows = SCREEN_DEFAULT_ROWS, cols = SCREEN_DEFAULT_COLS;
+
+    if (ioctl(screen.fd, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        rows = ws.ws_row;
+        cols = ws.ws_col;
+    }
+    screen_resized = 0;
+    if (screen.cur && rows == screen.rows && cols == screen.cols) return 0;
+
+    free(screen.cur);
+    free(screen.prev);
+    screen.cur = malloc((size_t)rows * cols * sizeof(screen_cell_t));
+    screen.prev = malloc((size_t)rows * cols * sizeof(screen_cell_t));
+    if (!screen.cur || !screen.prev) return -1;
+
+    screen.rows = rows;
+    screen.cols = cols;
+    screen.drawn = 0;
+    screen_fill_blank(screen.cur, rows, cols);
+    screen_fill_blank(screen.prev, rows, cols);
+    screen.height = screen.width = 0;
+    screen.cur_height = screen.cur_width = 0;
+    return 0;
+}
+
+static void emit(const char *data, size_t n) {
+    if (screen.out_len + n > screen.out_cap) {
+        size_t cap = screen.out_cap ? screen.out_cap : 16384;
+        while (cap < screen.out_len + n) cap *= 2;
+        char *bigger = realloc(screen.out, cap);
+        if (!bigger) return;
+        screen.out = bigger;
+        screen.out_cap = cap;
+    }
+    memcpy(screen.out + screen.out_len, data, n);
+    screen.out_len += n;
+}
+
+static void emit_str(const char *s) {
+    emit(s, strlen(s));
+}
+
+// Appends a decimal number without going through printf
+static void emit_int(int v) {
+    char digits[12];
+    int n = 0;
+
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    emit(digits + sizeof(digits) - n, (size_t)n);
+}
+
+static void emit_move(int row, int col) {
+    emit_str("\033[");
+    emit_int(row + 1);
+    emit(";", 1);
+    emit_int(col + 1);
+    emit("H", 1);
+}
+
+static void emit_style(uint8_t style) {
+    emit_str("\033[0");
+    if (style & STYLE_BOLD) emit_str(";1");
+    if (style & 0x0f) {
+        emit(";3", 2);
+        emit_int((style & 0x0f) - 1);
+    }
+    emit("m", 1);
+}
+
+// Applies the parameters of an SGR sequence ("\033[...m") to a style
+static uint8_t apply_sgr(uint8_t style, const char *params, const char *end) {
+    if (params == end) return 0;
+
+    while (params < end) {
+        int value = 0;
+        while (params < end && *params >= '0' && *params <= '9') {
+            value = value * 10 + (*params++ - '0');
+        }
+        if (params < end) params++;     // ';'
+
+        if (value == 0) {
+            style = 0;
+        } else if (value == 1) {
+            style |= STYLE_BOLD;
+        } else if (value == 22) {
+            style &= (uint8_t)~STYLE_BOLD;
+        } else if (value >= 30 && value <= 37) {
+            style = (uint8_t)((style & STYLE_BOLD) | (value - 30 + 1));
+        } else if (value == 39) {
+            style &= STYLE_BOLD;
+        }
+    }
+    return style;
+}
+
+// Parses the printed frame into screen.cur and records the area it uses
+static void screen_parse(const char *p, size_t n) {
+    const char *end = p + n;
+    int row = 0, col = 0, height = 0, width = 0;
+    uint8_t style = 0;
+
+    // Only the area the older frame in this grid used can be dirty
+    screen_fill_blank(screen.cur, screen.cur_height, screen.cur_width);
+
+    while (p < end) {
+        unsigned char c = (unsigned char)*p;
+
+        if (c == '\n') {
+            row++;
+            col = 0;
+            p++;
+        } else if (c == '\r') {
+            col = 0;
+            p++;
+        } else if (c == '\033' && p + 1 < end && p[1] == '[') {
+            // CSI sequence: parameters up to the final byte
+            const char *params = p + 2;
+            const char *q = params;
+            while (q < end && (*q < 0x40 || *q > 0x7e)) q++;
+            if (q < end && *q == 'm') style = apply_sgr(style, params, q);
+            p = q < end ? q + 1 : end;
+        } else if (c < 0x20) {
+            p++;
+        } else {
+            int len = c < 0x80 ? 1 : c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+            if (p + len > end) len = (int)(end - p);
+
+            if (row < screen.rows && col < screen.cols) {
+                screen_cell_t *cell = &screen.cur[row * screen.cols + col];
+                memcpy(cell->bytes, p, (size_t)len);
+                cell->len = (uint8_t)len;
+                cell->style = style;
+                if (row + 1 > height) height = row + 1;
+                if (col + 1 > width) width = col + 1;
+            }
+            col++;
+            p += len;
+        }
+    }
+    screen.cur_height = height;
+    screen.cur_width = width;
+}
+
+static int cell_equal(const screen_cell_t *a, const screen_cell_t *b) {
+    return a->len == b->len && a->style == b->style && memcmp(a->bytes, b->bytes, a->len) == 0;
+}
+
+// Emits the cells of screen.cur that differ from screen.prev
+static void screen_diff(void) {
+    int height = screen.cur_height;
+    int rows = height > screen.height ? height : screen.height;
+    int cols = screen.cur_width > screen.width ? screen.cur_width : screen.width;
+    int cursor_row = -1, cursor_col = -1;
+    int style = -1;
+
+    for (int r = 0; r < rows; r++) {
+        const screen_cell_t *cur = &screen.cur[r * screen.cols];
+        const screen_cell_t *prev = &screen.prev[r * screen.cols];
+
+        for (int c = 0; c < cols; c++) {
+            if (cell_equal(&cur[c], &prev[c])) continue;
+
+            // Short runs of unchanged cells are cheaper to rewrite than to jump
+            int from = c;
+            if (cursor_row == r && cursor_col < c && c - cursor_col <= SCREEN_MAX_SKIP) {
+                from = cursor_col;
+            } else if (cursor_row != r || cursor_col != c) {
+                emit_move(r, c);
+            }
+
+            for (int i = from; i <= c; i++) {
+                if (style != cur[i].style) {
+                    style = cur[i].style;
+                    emit_style(cur[i].style);
+                }
+                emit(cur[i].bytes, cur[i].len);
+            }
+            cursor_row = r;
+            cursor_col = c + 1;
+        }
+    }
+
+    if (style > 0) emit_str("\033[0m");
+
+    // Leave the cursor below the frame
+    if (height < screen.rows && (cursor_row >= 0 || !screen.drawn)) emit_move(height, 0);
+}
+
+// Writes the whole update, retrying on partial writes
+static int screen_flush(void) {
+    size_t done = 0;
+
+    while (done < screen.out_len) {
+        ssize_t n = write(screen.fd, screen.out + done, screen.out_len - done);
+        selfstat_io(1, n > 0 ? (unsigned long)n : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    screen.out_len = 0;
+    return 0;
+}
+
+// Selects the terminal descriptor the frames are written to
+int screen_init(int fd) {
+    screen_close();
+    screen.fd = fd;
+
+    screen.frame = open_memstream(&screen.frame_buf, &screen.frame_size);
+    if (!screen.frame || screen_resize() != 0) return -1;
+    return 0;
+}
+
+// Makes the next frame re-read the terminal size
+void screen_invalidate(void) {
+    screen_resized = 1;
+}
+
+// Returns the stream the next frame should be printed to
+FILE *screen_begin(void) {
+    if (!screen.frame && screen_init(screen.fd) != 0) return NULL;
+
+    rewind(screen.frame);
+    return screen.frame;
+}
+
+// Diffs the printed frame against the terminal and writes the changes
+int screen_end(void) {
+    if (fflush(screen.frame) != 0) return -1;
+    size_t length = (size_t)ftell(screen.frame);
+
+    if (screen_resized && screen_resize() != 0) return -1;
+
+    if (!screen.drawn) {
+        // Nothing known about the terminal yet: clear it and draw everything
+        emit_str("\033[?25l\033[H\033[2J");
+        screen_fill_blank(screen.prev, screen.height, screen.width);
+        screen.height = screen.width = 0;
+    }
+
+    screen_parse(screen.frame_buf, length);
+    screen_diff();
+
+    // The new frame becomes the reference for the next one
+    screen_cell_t *grid = screen.prev;
+    int height = screen.height, width = screen.width;
+    screen.prev = screen.cur;
+    screen.height = screen.cur_height;
+    screen.width = screen.cur_width;
+    screen.cur = grid;
+    screen.cur_height = height;
+    screen.cur_width = width;
+    screen.drawn = 1;
+
+    return screen_flush();
+}
+
+// Shows the cursor again and releases the frame buffers
+void screen_close(void) {
+    if (screen.drawn) {
+        emit_str("\033[?25h");
+        screen_flush();
+    }
+    if (screen.frame) fclose(screen.frame);
+    free(screen.frame_buf);
+    free(screen.cur);
+    free(screen.prev);
+    free(screen.out);
+
+    int fd = screen.fd;
+    memset(&screen, 0, sizeof(screen));
+    screen.fd = fd;
+}
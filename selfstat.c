@@ -0,0 +1,158 @@
+#include "sysmon.h"
+
+// Self-profiling of the collectors and the renderer.
+//
+// Every thread that runs a probe owns one selfstat_thread_t with counters and
+// a wall-time histogram per probe. Only the owner writes them (relaxed atomic
+// stores) and readers sum all threads with relaxed loads, so recording never
+// takes a lock. The I/O helpers report their syscalls and bytes through
+// selfstat_io(), which only bumps two thread-local counters.
+
+typedef struct {
+    uint64_t count;                     // Completed spans
+    uint64_t wall_ns;                   // Summed wall time
+    uint64_t cpu_ns;                    // Summed thread CPU time
+    uint64_t syscalls;                  // Summed I/O syscalls
+    uint64_t bytes;                     // Summed bytes read or written
+    uint64_t max_ns;                    // Longest span
+    uint64_t hist[SELFSTAT_BUCKETS];    // Wall time, bucket b holds [2^b, 2^(b+1)) ns
+} selfstat_counters_t;
+
+typedef struct selfstat_thread {
+    struct selfstat_thread *next;       // Registered threads, newest first
+    selfstat_counters_t probes[PROBE_COUNT];
+} selfstat_thread_t;
+
+static const char *probe_names[PROBE_COUNT] = {
+    "cpu", "memory", "uptime", "disk", "net", "cgroups", "pressure", "sensors", "processes",
+    "scan_worker", "render",
+};
+
+static int enabled = 0;
+static selfstat_thread_t *threads = NULL;
+
+static __thread selfstat_thread_t *self = NULL;
+static __thread uint64_t io_syscalls = 0;
+static __thread uint64_t io_bytes = 0;
+
+void selfstat_enable(int on) {
+    enabled = on;
+}
+
+int selfstat_enabled(void) {
+    return enabled;
+}
+
+const char *selfstat_probe_name(selfstat_probe_t probe) {
+    return probe_names[probe];
+}
+
+// Accounts I/O done by the calling thread to its open spans
+void selfstat_io(unsigned long syscalls, unsigned long bytes) {
+    io_syscalls += syscalls;
+    io_bytes += bytes;
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Registers the calling thread on first use (lock-free push)
+static selfstat_thread_t *selfstat_thread(void) {
+    if (self) return self;
+
+    selfstat_thread_t *t = calloc(1, sizeof(selfstat_thread_t));
+    if (!t) return NULL;
+
+    t->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&threads, &t->next, t, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    self = t;
+    return t;
+}
+
+void selfstat_begin(selfstat_span_t *span, selfstat_probe_t probe) {
+    span->active = enabled;
+    if (!span->active) return;
+
+    span->probe = probe;
+    span->syscalls = io_syscalls;
+    span->bytes = io_bytes;
+    span->cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    span->wall_ns = clock_ns(CLOCK_MONOTONIC);
+}
+
+// Single-writer update: only the owning thread stores to its counters
+static void bump(uint64_t *field, uint64_t value) {
+    __atomic_store_n(field, *field + value, __ATOMIC_RELAXED);
+}
+
+void selfstat_end(selfstat_span_t *span) {
+    if (!span->active) return;
+
+    uint64_t wall = clock_ns(CLOCK_MONOTONIC) - span->wall_ns;
+    uint64_t cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID) - span->cpu_ns;
+
+    selfstat_thread_t *t = selfstat_thread();
+    if (!t) return;
+
+    selfstat_counters_t *c = &t->probes[span->probe];
+    int bucket = wall > 1 ? 63 - __builtin_clzll(wall) : 0;
+    if (bucket >= SELFSTAT_BUCKETS) bucket = SELFSTAT_BUCKETS - 1;
+
+    bump(&c->count, 1);
+    bump(&c->wall_ns, wall);
+    bump(&c->cpu_ns, cpu);
+    bump(&c->syscalls, io_syscalls - span->syscalls);
+    bump(&c->bytes, io_bytes - span->bytes);
+    bump(&c->hist[bucket], 1);
+    if (wall > c->max_ns) __atomic_store_n(&c->max_ns, wall, __ATOMIC_RELAXED);
+}
+
+// Upper bound of the bucket holding quantile q
+static uint64_t hist_quantile(const uint64_t *hist, double q) {
+    uint64_t count = 0, seen = 0;
+
+    for (int b = 0; b < SELFSTAT_BUCKETS; b++) count += hist[b];
+    if (count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(q * (double)(count - 1)) + 1;
+
+    for (int b = 0; b < SELFSTAT_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank) return 2ull << b;
+    }
+    return 2ull << (SELFSTAT_BUCKETS - 1);
+}
+
+// Sums one probe over every thread that ever recorded it
+void selfstat_summary(selfstat_probe_t probe, selfstat_summary_t *out) {
+    uint64_t hist[SELFSTAT_BUCKETS] = {0};
+
+    memset(out, 0, sizeof(selfstat_summary_t));
+
+    for (selfstat_thread_t *t = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+        const selfstat_counters_t *c = &t->probes[probe];
+        out->count += __atomic_load_n(&c->count, __ATOMIC_RELAXED);
+        out->wall_ns += __atomic_load_n(&c->wall_ns, __ATOMIC_RELAXED);
+        out->cpu_ns += __atomic_load_n(&c->cpu_ns, __ATOMIC_RELAXED);
+        out->syscalls += __atomic_load_n(&c->syscalls, __ATOMIC_RELAXED);
+        out->bytes += __atomic_load_n(&c->bytes, __ATOMIC_RELAXED);
+
+        uint64_t max = __atomic_load_n(&c->max_ns, __ATOMIC_RELAXED);
+        if (max > out->max_ns) out->max_ns = max;
+        for (int b = 0; b < SELFSTAT_BUCKETS; b++) {
+            hist[b] += __atomic_load_n(&c->hist[b], __ATOMIC_RELAXED);
+        }
+    }
+
+    if (out->count > 0) {
+        out->p50_ns = hist_quantile(hist, 0.50);
+        out->p99_ns = hist_quantile(hist, 0.99);
+        if (out->p50_ns > out->max_ns) out->p50_ns = out->max_ns;
+        if (out->p99_ns > out->max_ns) out->p99_ns = out->max_ns;
+    }
+}
@@ -0,0 +1,400 @@
+#include "sysmon.h"
+#include <fcntl.h>
+
+// Hardware sensors: hwmon temperatures and fans, thermal zones and RAPL
+// energy counters.
+//
+// Sensors are discovered once per sysfs root and their files kept open, so a
+// sample is one pread() per sensor. Discovery walks, in this order:
+//   - /sys/class/hwmon/hwmonN: tempK_input (label, max and crit read once)
+//     and fanK_input. CPU chips are mapped to packages by label: coretemp
+//     has "Package id P" and "Core C", k10temp and zenpower have Tctl/Tdie
+//     (one chip per package) and TccdN,
+//   - /sys/class/thermal/thermal_zoneN, leaving out the zones that already
+//     registered a hwmon chip of the same name; x86_pkg_temp only stands in
+//     for packages when no hwmon chip reported one,
+//   - /sys/class/powercap/intel-rapl:P[:S]/energy_uj, turned into watts from
+//     the delta between two samples (the counter wraps to 0 after
+//     max_energy_range_uj). The counters are often root-only; unreadable
+//     ones are left out.
+// The CPU temperature is the hottest package, or without package sensors
+// the first temperature found.
+
+// One discovered sensor file
+typedef struct {
+    proc_file_t file;                   // Open input file
+    char path[96];                      // Storage for file.path
+    uint64_t range;                     // RAPL: highest counter value before it wraps to 0 (uJ)
+    uint64_t prev_energy;               // RAPL: counter at the last sample
+    double prev_time;                   // RAPL: CLOCK_MONOTONIC time of prev_energy
+    int has_prev;
+} sensor_source_t;
+
+static sensor_t sensors[MAX_SENSORS];   // Handed out in sensor_info_t
+static sensor_source_t sources[MAX_SENSORS];
+static int sensor_count = 0;
+static int sensors_listed = 0;
+static unsigned int sensors_generation = 0;
+
+// Reads a small sysfs attribute (a name, a label) without keeping it open;
+// trailing newlines are dropped
+static int read_attr(const char *path, char *buf, size_t size) {
+    int fd = sysmon_open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        selfstat_io(1, 0);
+        return -1;
+    }
+    ssize_t bytes = read(fd, buf, size - 1);
+    close(fd);
+    selfstat_io(3, bytes > 0 ? (unsigned long)bytes : 0);
+    if (bytes < 0) return -1;
+
+    while (bytes > 0 && (buf[bytes - 1] == '\n' || buf[bytes - 1] == ' ')) bytes--;
+    buf[bytes] = '\0';
+    return 0;
+}
+
+// Integer value of a file, which may be negative (temperatures)
+static int parse_long(const char *buf, long long *value) {
+    char *end;
+    *value = strtoll(buf, &end, 10);
+    return end == buf ? -1 : 0;
+}
+
+static int read_attr_long(const char *path, long long *value) {
+    char buf[32];
+    return read_attr(path, buf, sizeof(buf)) == 0 ? parse_long(buf, value) : -1;
+}
+
+// Reads the current value of an open sensor
+static int source_read(sensor_source_t *source, long long *value) {
+    if (proc_file_read(&source->file) < 0) return -1;
+    return parse_long(source->file.buf, value);
+}
+
+// Adds a sensor reading path, if the file can be read at all
+static sensor_t *add_sensor(const char *path, sensor_kind_t kind, const char *chip,
+                            const char *label) {
+    if (sensor_count >= MAX_SENSORS) return NULL;
+
+    sensor_source_t *source = &sources[sensor_count];
+    long long value;
+    memset(source, 0, sizeof(sensor_source_t));
+    snprintf(source->path, sizeof(source->path), "%s", path);
+    source->file = (proc_file_t)PROC_FILE_INIT(source->path);
+    if (source_read(source, &value) != 0) {
+        proc_file_close(&source->file);
+        return NULL;
+    }
+
+    sensor_t *sensor = &sensors[sensor_count++];
+    memset(sensor, 0, sizeof(sensor_t));
+    snprintf(sensor->chip, sizeof(sensor->chip), "%s", chip);
+    snprintf(sensor->label, sizeof(sensor->label), "%s", label);
+    sensor->kind = kind;
+    sensor->package = -1;
+    sensor->core = -1;
+    sensor->max = -1.0;
+    sensor->crit = -1.0;
+    return sensor;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+// Numbers N of the entries "<prefix>N<suffix>" of a directory, sorted
+static int list_numbered(const char *dir_path, const char *prefix, const char *suffix,
+                         int *numbers, int max) {
+    char path[PATH_MAX];
+    struct dirent *entry;
+    size_t prefix_len = strlen(prefix);
+    int count = 0;
+
+    DIR *dir = opendir(sysmon_path(dir_path, path, sizeof(path)));
+    if (!dir) return 0;
+
+    while ((entry = readdir(dir)) != NULL && count < max) {
+        unsigned long n;
+        const char *end;
+        if (strncmp(entry->d_name, prefix, prefix_len) != 0 ||
+            !(end = scan_ulong(entry->d_name + prefix_len, &n)) || strcmp(end, suffix) != 0) {
+            continue;
+        }
+        numbers[count++] = (int)n;
+    }
+    closedir(dir);
+
+    qsort(numbers, (size_t)count, sizeof(int), compare_ints);
+    return count;
+}
+
+static int is_cpu_chip(const char *name) {
+    return strcmp(name, "coretemp") == 0 || strcmp(name, "k10temp") == 0 ||
+           strcmp(name, "zenpower") == 0;
+}
+
+// Temperatures and fans of one hwmon chip. CPU chips are numbered in
+// discovery order for the packages their labels do not name.
+static void list_hwmon_chip(int hwmon, const char *name, int *cpu_chips, int *packages) {
+    char dir[64], path[128], label[32];
+    int numbers[64];
+
+    snprintf(dir, sizeof(dir), "/sys/class/hwmon/hwmon%d", hwmon);
+    int cpu = is_cpu_chip(name);
+    int chip_package = cpu ? (*cpu_chips)++ : -1;
+
+    // A chip with Tdie reports Tctl with an offset; Tdie is the package
+    int has_tdie = 0;
+    int count = list_numbered(dir, "temp", "_input", numbers, 64);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < count; i++) {
+            snprintf(path, sizeof(path), "%s/temp%d_label", dir, numbers[i]);
+            if (read_attr(path, label, sizeof(label)) != 0) {
+                snprintf(label, sizeof(label), "temp%d", numbers[i]);
+            }
+
+            // The first pass only finds the chip's package
+            unsigned long id;
+            if (pass == 0) {
+                if ((strncmp(label, "Package id ", 11) == 0 && scan_ulong(label + 11, &id)) ||
+                    (strncmp(label, "Physical id ", 12) == 0 && scan_ulong(label + 12, &id))) {
+                    chip_package = (int)id;
+                }
+                if (strcmp(label, "Tdie") == 0) has_tdie = 1;
+                continue;
+            }
+
+            snprintf(path, sizeof(path), "%s/temp%d_input", dir, numbers[i]);
+            sensor_kind_t kind = SENSOR_TEMP;
+            int core = -1;
+            if (cpu && (strncmp(label, "Package id ", 11) == 0 ||
+                        strncmp(label, "Physical id ", 12) == 0 || strcmp(label, "Tdie") == 0 ||
+                        (strcmp(label, "Tctl") == 0 && !has_tdie))) {
+                kind = SENSOR_PACKAGE;
+            } else if (cpu && strncmp(label, "Core ", 5) == 0 && scan_ulong(label + 5, &id)) {
+                kind = SENSOR_CORE;
+                core = (int)id;
+            }
+
+            sensor_t *sensor = add_sensor(path, kind, name, label);
+            if (!sensor) continue;
+            sensor->package = cpu ? chip_package : -1;
+            sensor->core = core;
+            if (kind == SENSOR_PACKAGE) (*packages)++;
+
+            long long threshold;
+            snprintf(path, sizeof(path), "%s/temp%d_max", dir, numbers[i]);
+            if (read_attr_long(path, &threshold) == 0 && threshold > 0) {
+                sensor->max = threshold / 1000.0;
+            }
+            snprintf(path, sizeof(path), "%s/temp%d_crit", dir, numbers[i]);
+            if (read_attr_long(path, &threshold) == 0 && threshold > 0) {
+                sensor->crit = threshold / 1000.0;
+            }
+        }
+    }
+
+    count = list_numbered(dir, "fan", "_input", numbers, 64);
+    for (int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/fan%d_label", dir, numbers[i]);
+        if (read_attr(path, label, sizeof(label)) != 0) {
+            snprintf(label, sizeof(label), "fan%d", numbers[i]);
+        }
+        snprintf(path, sizeof(path), "%s/fan%d_input", dir, numbers[i]);
+        add_sensor(path, SENSOR_FAN, name, label);
+    }
+}
+
+// Thermal zones not already seen as a hwmon chip
+static void list_thermal_zones(char chips[][SENSOR_NAME_SIZE], int chip_count, int packages) {
+    char dir[64], path[128], type[SENSOR_NAME_SIZE];
+    int numbers[64];
+    int pkg_zones = 0;
+
+    int count = list_numbered("/sys/class/thermal", "thermal_zone", "", numbers, 64);
+    for (int i = 0; i < count; i++) {
+        snprintf(dir, sizeof(dir), "/sys/class/thermal/thermal_zone%d", numbers[i]);
+        snprintf(path, sizeof(path), "%s/type", dir);
+        if (read_attr(path, type, sizeof(type)) != 0) continue;
+
+        int duplicate = 0;
+        for (int c = 0; c < chip_count && !duplicate; c++) duplicate = strcmp(chips[c], type) == 0;
+        if (duplicate) continue;
+
+        sensor_kind_t kind = SENSOR_TEMP;
+        if (strcmp(type, "x86_pkg_temp") == 0) {
+            if (packages > 0) continue;
+            kind = SENSOR_PACKAGE;
+        }
+
+        char label[32];
+        snprintf(label, sizeof(label), "thermal_zone%d", numbers[i]);
+        snprintf(path, sizeof(path), "%s/temp", dir);
+        sensor_t *sensor = add_sensor(path, kind, type, label);
+        if (sensor && kind == SENSOR_PACKAGE) sensor->package = pkg_zones++;
+    }
+}
+
+// RAPL zones and their subzones: intel-rapl:P and intel-rapl:P:S
+static void list_rapl(void) {
+    char path[PATH_MAX], dir[64], name[32], label[64];
+    struct dirent *entry;
+    char zones[MAX_SENSORS][24];
+    int count = 0;
+
+    DIR *d = opendir(sysmon_path("/sys/class/powercap", path, sizeof(path)));
+    if (!d) return;
+    while ((entry = readdir(d)) != NULL && count < MAX_SENSORS) {
+        if (strncmp(entry->d_name, "intel-rapl:", 11) != 0 ||
+            strlen(entry->d_name) >= sizeof(zones[0])) {
+            continue;
+        }
+        snprintf(zones[count++], sizeof(zones[0]), "%s", entry->d_name);
+    }
+    closedir(d);
+    qsort(zones, (size_t)count, sizeof(zones[0]), compare_names);
+
+    for (int i = 0; i < count; i++) {
+        unsigned long package;
+        const char *sub = scan_ulong(zones[i] + 11, &package);
+        if (!sub) continue;
+
+        snprintf(dir, sizeof(dir), "/sys/class/powercap/%.23s", zones[i]);
+        snprintf(path, sizeof(path), "%s/name", dir);
+        if (read_attr(path, name, sizeof(name)) != 0) continue;
+
+        // Subzones (core, uncore, dram) are named after their package
+        if (*sub == ':') {
+            snprintf(label, sizeof(label), "package-%lu %s", package, name);
+        } else {
+            snprintf(label, sizeof(label), "%s", name);
+        }
+
+        snprintf(path, sizeof(path), "%s/energy_uj", dir);
+        sensor_t *sensor = add_sensor(path, SENSOR_POWER, "rapl", label);
+        if (!sensor) continue;
+        if (strncmp(name, "package-", 8) == 0 || *sub == ':') sensor->package = (int)package;
+
+        long long range;
+        snprintf(path, sizeof(path), "%s/max_energy_range_uj", dir);
+        if (read_attr_long(path, &range) == 0 && range > 0) {
+            sources[sensor_count - 1].range = (uint64_t)range;
+        }
+    }
+}
+
+// Discovers the sensors unless the current roots were already walked
+static void list_sensors(void) {
+    char chips[64][SENSOR_NAME_SIZE];
+    int numbers[64];
+    int chip_count = 0, cpu_chips = 0, packages = 0;
+
+    if (sensors_listed && sensors_generation == sysmon_root_generation()) return;
+
+    for (int i = 0; i < sensor_count; i++) proc_file_close(&sources[i].file);
+    sensor_count = 0;
+    sensors_listed = 1;
+    sensors_generation = sysmon_root_generation();
+
+    int count = list_numbered("/sys/class/hwmon", "hwmon", "", numbers, 64);
+    for (int i = 0; i < count; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/class/hwmon/hwmon%d/name", numbers[i]);
+        if (read_attr(path, chips[chip_count], sizeof(chips[0])) != 0) continue;
+        list_hwmon_chip(numbers[i], chips[chip_count], &cpu_chips, &packages);
+        chip_count++;
+    }
+    list_thermal_zones(chips, chip_count, packages);
+    list_rapl();
+}
+
+// Reads one sensor into its public entry
+static void sample_sensor(int index, double now) {
+    sensor_source_t *source = &sources[index];
+    sensor_t *sensor = &sensors[index];
+    long long raw;
+
+    sensor->valid = 0;
+    if (source_read(source, &raw) != 0) {
+        source->has_prev = 0;
+        return;
+    }
+
+    // Temperatures may be negative, counters may not
+    switch (sensor->kind) {
+        case SENSOR_FAN:
+            sensor->value = (double)raw;
+            sensor->valid = raw >= 0;
+            break;
+        case SENSOR_POWER: {
+            uint64_t energy = (uint64_t)raw;
+            if (raw < 0) {
+                source->has_prev = 0;
+                break;
+            }
+            // energy_uj runs through 0..range inclusive, so a wrap skips
+            // range + 1; a counter that went back without a known range
+            // was reset
+            if (source->has_prev && now > source->prev_time &&
+                (energy >= source->prev_energy ||
+                 (source->range > 0 && source->range >= source->prev_energy))) {
+                uint64_t delta = energy >= source->prev_energy ? energy - source->prev_energy :
+                                 energy + source->range + 1 - source->prev_energy;
+                sensor->value = delta / 1e6 / (now - source->prev_time);
+                sensor->valid = 1;
+            }
+            source->prev_energy = energy;
+            source->prev_time = now;
+            source->has_prev = 1;
+            break;
+        }
+        default:
+            sensor->value = raw / 1000.0;
+            sensor->valid = 1;
+            break;
+    }
+}
+
+int read_sensor_info(sensor_info_t *info) {
+    struct timespec now;
+
+    list_sensors();
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec + now.tv_nsec / 1e9;
+
+    for (int i = 0; i < sensor_count; i++) sample_sensor(i, time);
+
+    info->count = sensor_count;
+    info->sensors = sensors;
+    return 0;
+}
+
+// Hottest package in degrees Celsius, 0 when there is no temperature at all.
+// Only the package sensors are read.
+double read_cpu_temperature(void) {
+    double hottest = 0.0;
+    int first_temp = -1;
+    long long raw;
+
+    list_sensors();
+    for (int i = 0; i < sensor_count; i++) {
+        if (sensors[i].kind == SENSOR_PACKAGE) {
+            if (source_read(&sources[i], &raw) == 0 && raw / 1000.0 > hottest) {
+                hottest = raw / 1000.0;
+            }
+            first_temp = -2;
+        } else if (first_temp == -1 && sensors[i].kind != SENSOR_FAN &&
+                   sensors[i].kind != SENSOR_POWER) {
+            first_temp = i;
+        }
+    }
+
+    if (first_temp >= 0 && source_read(&sources[first_temp], &raw) == 0) hottest = raw / 1000.0;
+    return hottest;
+}
+
+const char *sensor_kind_name(sensor_kind_t kind) {
+    static const char *names[] = {"package", "core", "temp", "fan", "power"};
+    return kind >= 0 && kind <= SENSOR_POWER ? names[kind] : "";
+}
@@ -0,0 +1,263 @@
+#include "sysmon.h"
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+// Latest sample published in POSIX shared memory by sysmond.
+//
+// One collector (sysmon --daemon, or the binary started as sysmond) encodes
+// every sample as a binary record into a shared-memory object; any number of
+// sysmon --attach clients map it read-only and render from it, so /proc is
+// read once per interval however many viewers there are.
+//
+// The object is a one-page header followed by a single record slot. The
+// header's sequence word is a seqlock: the publisher makes it odd while it
+// rewrites the slot and even again once the record is complete. Readers copy
+// the slot and keep the copy only if the sequence was even and unchanged
+// around it. A publisher that exits marks the segment closed and unlinks it;
+// clients then reattach to the next publisher under the same name.
+
+#define SHM_MAGIC   0x44424d4f4d53ull   // "SMOMBD"
+#define SHM_VERSION 1
+#define SHM_HEADER_SIZE 4096
+
+// Copy attempts before a read gives up on a publisher that keeps writing
+#define SHM_READ_RETRIES 16
+
+typedef struct {
+    uint64_t magic;                     // SHM_MAGIC, stored last
+    uint32_t version;                   // SHM_VERSION
+    uint32_t record_size;               // Bytes reserved for the record
+    uint64_t seq;                       // Seqlock: odd while the record is rewritten
+    int64_t interval_ms;                // Publisher's sampling period
+    int32_t pid;                        // Publisher process
+    uint32_t closed;                    // Publisher exited; reattach by name
+} shm_header_t;
+
+static shm_header_t *shm_hdr(const shm_segment_t *s) {
+    return (shm_header_t *)s->map;
+}
+
+static void shm_unmap(shm_segment_t *s) {
+    if (s->map) munmap(s->map, s->size);
+    if (s->fd >= 0) close(s->fd);
+    free(s->scratch);
+    memset(s, 0, sizeof(shm_segment_t));
+    s->fd = -1;
+}
+
+// Creates (or takes over) the segment and sizes it for the cores present at
+// startup. Only one publisher may own a name at a time.
+int shm_publisher_open(shm_segment_t *s, const char *name, long interval_ms) {
+    int created = 0;
+
+    memset(s, 0, sizeof(shm_segment_t));
+    s->fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (s->fd < 0) return -1;
+    if (flock(s->fd, LOCK_EX | LOCK_NB) != 0) goto fail;
+
+    // Clients may still map an earlier publisher's object: give this one a
+    // fresh inode so they notice the switch instead of faulting on a resize
+    if (shm_unlink(name) != 0) goto fail;
+    close(s->fd);
+    s->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (s->fd < 0) goto fail;
+    created = 1;
+    if (flock(s->fd, LOCK_EX | LOCK_NB) != 0) goto fail;
+
+    uint32_t record_size = (uint32_t)((record_max_size(cpu_core_count()) + 7) & ~(size_t)7);
+    s->size = SHM_HEADER_SIZE + record_size;
+    s->record_size = record_size;
+    if (ftruncate(s->fd, (off_t)s->size) != 0) goto fail;
+
+    s->map = mmap(NULL, s->size, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (s->map == MAP_FAILED) {
+        s->map = NULL;
+        goto fail;
+    }
+
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    shm_header_t *hdr = shm_hdr(s);
+    hdr->version = SHM_VERSION;
+    hdr->record_size = record_size;
+    hdr->interval_ms = interval_ms;
+    hdr->pid = (int32_t)getpid();
+    __atomic_store_n(&hdr->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+
+fail:
+    if (created) {
+        int saved = errno;
+        shm_unlink(name);
+        errno = saved;
+    }
+    shm_unmap(s);
+    return -1;
+}
+
+// Publishes a sample, encoding it straight into the slot (no allocation)
+void shm_publish(shm_segment_t *s, const system_info_t *info) {
+    shm_header_t *hdr = shm_hdr(s);
+    uint64_t seq = hdr->seq;
+
+    __atomic_store_n(&hdr->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    record_encode(info, s->map + SHM_HEADER_SIZE, s->record_size);
+
+    __atomic_store_n(&hdr->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Marks the segment closed for attached clients and removes the name
+void shm_publisher_close(shm_segment_t *s) {
+    if (s->map) {
+        __atomic_store_n(&shm_hdr(s)->closed, 1, __ATOMIC_RELEASE);
+        shm_unlink(s->name);
+    }
+    shm_unmap(s);
+}
+
+// Maps a publisher's segment read-only. Fails with ENOENT when nothing is
+// published under name.
+int shm_reader_open(shm_segment_t *s, const char *name) {
+    struct stat st;
+    shm_header_t hdr;
+
+    memset(s, 0, sizeof(shm_segment_t));
+    s->fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (s->fd < 0) return -1;
+
+    // The publisher sizes the object before it stores the magic
+    if (fstat(s->fd, &st) != 0) goto fail;
+    if ((size_t)st.st_size < SHM_HEADER_SIZE ||
+        pread(s->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+        hdr.magic != SHM_MAGIC || hdr.version != SHM_VERSION ||
+        (uint64_t)st.st_size < (uint64_t)SHM_HEADER_SIZE + hdr.record_size) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    s->size = SHM_HEADER_SIZE + hdr.record_size;
+    s->record_size = hdr.record_size;
+    s->ino = st.st_ino;
+    s->interval_ms = (long)hdr.interval_ms;
+    s->scratch = malloc(s->record_size);
+    if (!s->scratch) goto fail;
+
+    s->map = mmap(NULL, s->size, PROT_READ, MAP_SHARED, s->fd, 0);
+    if (s->map == MAP_FAILED) {
+        s->map = NULL;
+        goto fail;
+    }
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    return 0;
+
+fail:
+    shm_unmap(s);
+    return -1;
+}
+
+void shm_reader_close(shm_segment_t *s) {
+    shm_unmap(s);
+}
+
+// Copies the latest sample out of the segment and decodes it. Returns 1 for
+// a sample newer than the last one read, 0 when nothing changed and -1 when
+// no complete sample could be copied (EAGAIN) or the publisher exited
+// (EPIPE).
+int shm_reader_read(shm_segment_t *s, system_info_t *info) {
+    const shm_header_t *hdr = shm_hdr(s);
+
+    if (__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE)) {
+        errno = EPIPE;
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < SHM_READ_RETRIES; attempt++) {
+        uint64_t seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+        if (seq == 0) break;
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        if (seq == s->seq) return 0;
+
+        memcpy(s->scratch, s->map + SHM_HEADER_SIZE, s->record_size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) != seq) continue;
+
+        if (record_decode(s->scratch, s->record_size, info) != 0) break;
+        s->seq = seq;
+        return 1;
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+// True when the mapped segment no longer belongs to a live publisher: it
+// was closed, its name now points to another object, or the publisher was
+// killed before it could close it
+static int shm_reader_orphaned(const shm_segment_t *s) {
+    const shm_header_t *hdr = shm_hdr(s);
+    struct stat st;
+
+    if (__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE)) return 1;
+    if (kill((pid_t)hdr->pid, 0) != 0 && errno == ESRCH) return 1;
+
+    int fd = shm_open(s->name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return 1;
+    int moved = fstat(fd, &st) != 0 || st.st_ino != s->ino;
+    close(fd);
+    return moved;
+}
+
+// Renders the published samples: the latest one, and with follow set every
+// new one on the ticks of loop until it quits. A client outlives its
+// publisher and picks up the next one that opens the same name.
+int shm_follow(shm_segment_t *s, int follow, history_render_fn render, void *ctx,
+               event_loop_t *loop) {
+    system_info_t info;
+    char name[sizeof(s->name)];
+    int rendered = 0;
+    int idle_ticks = 0;         // Ticks without a new sample
+    uint64_t last_ino = 0;      // Object and sequence of the last sample rendered
+    uint64_t last_seq = 0;
+
+    memcpy(name, s->name, sizeof(name));
+    for (;;) {
+        // A reopened publisher that was only presumed dead keeps its place
+        if (!s->map && shm_reader_open(s, name) == 0 && s->ino == last_ino) s->seq = last_seq;
+
+        if (s->map) {
+            int result = shm_reader_read(s, &info);
+            if (result > 0) {
+                render(&info, ctx);
+                rendered++;
+                idle_ticks = 0;
+                last_ino = s->ino;
+                last_seq = s->seq;
+            } else if (result < 0 && errno == EPIPE) {
+                shm_reader_close(s);
+            } else if (++idle_ticks * (loop ? loop->interval_ms : 0) > 2 * s->interval_ms &&
+                       shm_reader_orphaned(s)) {
+                // Checked only once the samples stop, so a healthy publisher
+                // costs no syscalls beyond the tick
+                shm_reader_close(s);
+                idle_ticks = 0;
+            }
+        }
+
+        if (!follow || !loop) break;
+
+        event_t event;
+        do {
+            if (event_loop_next(loop, &event) != 0) event.type = EVENT_QUIT;
+        } while (event.type == EVENT_KEY);
+        if (event.type == EVENT_QUIT) break;
+    }
+    return rendered;
+}
@@ -1,5 +1,13 @@
 #include "sysmon.h"
 
+// Stream the display functions write to; the screen renderer swaps in its
+// frame buffer while a watch frame is composed
+static FILE *display_out = NULL;
+
+void display_set_output(FILE *fp) {
+    display_out = fp;
+}
+
 // Returns appropriate color based on usage percentage
 const char* get_color_by_percentage(double percent) {
     if (percent >= 80.0) return COLOR_RED;      // High usage - red
@@ -28,34 +36,55 @@ void format_bytes(unsigned long bytes, char *output) {
 
 // Clears the terminal screen and moves cursor to top-left
 void clear_screen(void) {
-    printf("\033[2J\033[H");
+    if (!display_out) display_out = stdout;
+    fprintf(display_out, "\033[2J\033[H");
+}
+
+// Displays every collected section of a sample
+void display_system_info(const system_info_t *info, int show_flags) {
+    int shown = info->valid_flags & show_flags;
+
+    if (!display_out) display_out = stdout;
+
+    display_header((time_t)info->timestamp);
+
+    if (shown & SHOW_CPU) display_cpu_info(&info->cpu);
+    if (shown & SHOW_MEMORY) display_memory_info(&info->memory);
+    if (shown & SHOW_UPTIME) display_uptime_info(&info->uptime);
+    if (shown & SHOW_DISK) display_disk_info(&info->disk);
+    if (shown & SHOW_NET) display_net_info(&info->net);
+    if (shown & SHOW_PRESSURE) display_pressure(&info->pressure);
+    if ((shown & SHOW_SENSORS) && info->sensors.count > 0) display_sensors(&info->sensors);
+    if (shown & SHOW_CGROUPS) display_cgroups(&info->cgroups);
+    if (shown & SHOW_WINDOWS) display_windows(&info->windows);
+    if ((shown & SHOW_PROC) && info->process_count > 0) {
+        display_processes(info->top_processes, info->process_count);
+    }
 }
 
-// Displays the main header with title and timestamp
-void display_header(void) {
-    time_t now;
+// Displays the main header with title and the sample's timestamp
+void display_header(time_t when) {
     struct tm *timeinfo;
     char timestamp[64];
 
-    // Get current time and format it
-    time(&now);
-    timeinfo = localtime(&now);
+    // Format the sample time
+    timeinfo = localtime(&when);
     strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", timeinfo);
 
     // Display header with fancy Unicode box characters
-    printf("%s╔══════════════════════════════════════════════════════════════════════════════╗%s\n",
+    fprintf(display_out, "%s╔══════════════════════════════════════════════════════════════════════════════╗%s\n",
            COLOR_CYAN, COLOR_RESET);
-    printf("%s║%s                           %sArchSetup System Monitor%s                           %s║%s\n",
+    fprintf(display_out, "%s║%s                           %sArchSetup System Monitor%s                           %s║%s\n",
            COLOR_CYAN, COLOR_RESET, COLOR_BOLD COLOR_WHITE, COLOR_RESET, COLOR_CYAN, COLOR_RESET);
-    printf("%s║%s                              %s%s%s                              %s║%s\n",
+    fprintf(display_out, "%s║%s                              %s%s%s                              %s║%s\n",
            COLOR_CYAN, COLOR_RESET, COLOR_BLUE, timestamp, COLOR_RESET, COLOR_CYAN, COLOR_RESET);
-    printf("%s╚══════════════════════════════════════════════════════════════════════════════╝%s\n\n",
+    fprintf(display_out, "%s╚══════════════════════════════════════════════════════════════════════════════╝%s\n\n",
            COLOR_CYAN, COLOR_RESET);
 }
 
 // Displays CPU information with usage bars and temperature
 void display_cpu_info(const cpu_info_t *cpu) {
-    printf("%s┌─ CPU Information ─────────────────────────────────────────────────────────────┐%s\n",
+    fprintf(display_out, "%s┌─ CPU Information ─────────────────────────────────────────────────────────────┐%s\n",
            COLOR_BLUE, COLOR_RESET);
 
     // Truncate CPU model if too long
@@ -70,41 +99,98 @@ void display_cpu_info(const cpu_info_t *cpu) {
         strcpy(truncated_model, cpu->model);
     }
 
-    printf("%s│%s Model: %s%-60s%s %s│%s\n",
+    fprintf(display_out, "%s│%s Model: %s%-60s%s %s│%s\n",
            COLOR_BLUE, COLOR_RESET, COLOR_WHITE, truncated_model, COLOR_RESET, COLOR_BLUE, COLOR_RESET);
-    printf("%s│%s Cores: %s%-60d%s %s│%s\n",
-           COLOR_BLUE, COLOR_RESET, COLOR_WHITE, cpu->cores, COLOR_RESET, COLOR_BLUE, COLOR_RESET);
+    char cores[64];
+    if (cpu->online > 0 && cpu->online != cpu->cores) {
+        snprintf(cores, sizeof(cores), "%d (%d online)", cpu->cores, cpu->online);
+    } else {
+        snprintf(cores, sizeof(cores), "%d", cpu->cores);
+    }
+    fprintf(display_out, "%s│%s Cores: %s%-60s%s %s│%s\n",
+           COLOR_BLUE, COLOR_RESET, COLOR_WHITE, cores, COLOR_RESET, COLOR_BLUE, COLOR_RESET);
 
     // Display total CPU usage with progress bar
-    printf("%s│%s Total usage: %s%6.1f%%%s ",
+    fprintf(display_out, "%s│%s Total usage: %s%6.1f%%%s ",
            COLOR_BLUE, COLOR_RESET, get_color_by_percentage(cpu->total_usage),
            cpu->total_usage, COLOR_RESET);
 
     // Draw usage progress bar
     int bar_length = 35;
     int filled = (int)(cpu->total_usage * bar_length / 100.0);
-    printf("[");
+    fprintf(display_out, "[");
     for (int i = 0; i < bar_length; i++) {
         if (i < filled) {
-            printf("█");  // Filled portion
+            fprintf(display_out, "█");  // Filled portion
         } else {
-            printf("░");  // Empty portion
+            fprintf(display_out, "░");  // Empty portion
         }
     }
-    printf("] %s│%s\n", COLOR_BLUE, COLOR_RESET);
+    fprintf(display_out, "] %s│%s\n", COLOR_BLUE, COLOR_RESET);
+
+    // Where the non-idle time went besides user and system
+    char breakdown[64];
+    snprintf(breakdown, sizeof(breakdown), "iowait %.1f%%  steal %.1f%%  irq %.1f%%",
+             cpu->iowait_percent, cpu->steal_percent, cpu->irq_percent);
+    fprintf(display_out, "%s│%s Breakdown: %s%-56s%s %s│%s\n",
+           COLOR_BLUE, COLOR_RESET, COLOR_WHITE, breakdown, COLOR_RESET, COLOR_BLUE, COLOR_RESET);
 
     // Display temperature if available
     if (cpu->temperature > 0) {
-        printf("%s│%s Temperature: %s%6.1f°C%s %53s %s│%s\n",
+        fprintf(display_out, "%s│%s Temperature: %s%6.1f°C%s %53s %s│%s\n",
                COLOR_BLUE, COLOR_RESET,
                get_color_by_percentage(cpu->temperature > 70 ? 80 : cpu->temperature),
                cpu->temperature, COLOR_RESET, "", COLOR_BLUE, COLOR_RESET);
     }
 
-    printf("%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
            COLOR_BLUE, COLOR_RESET);
 }
 
+// Formats a byte count in at most 5 columns ("512", "48.0K", "1023M"), or
+// "-" when negative (not sampled)
+static void format_bytes_short(double bytes, char *output, size_t size) {
+    const char units[] = "BKMGTP";
+    int unit = 0;
+
+    if (bytes < 0) {
+        snprintf(output, size, "-");
+        return;
+    }
+    while (bytes >= 1023.5 && unit < 5) {
+        bytes /= 1024.0;
+        unit++;
+    }
+
+    if (unit == 0) {
+        snprintf(output, size, "%.0f", bytes);
+    } else if (bytes < 99.95) {
+        snprintf(output, size, "%.1f%c", bytes, units[unit]);
+    } else {
+        snprintf(output, size, "%.0f%c", bytes, units[unit]);
+    }
+}
+
+// Formats a rate or percentage that is negative when not sampled
+static void format_optional(double value, const char *format, char *output, size_t size) {
+    if (value >= 0) {
+        snprintf(output, size, format, value);
+    } else {
+        snprintf(output, size, "-");
+    }
+}
+
+// Draws a usage bar of the given length
+static void display_bar(double percent, int length) {
+    int filled = (int)(percent * length / 100.0);
+
+    fprintf(display_out, "[");
+    for (int i = 0; i < length; i++) {
+        fprintf(display_out, "%s", i < filled ? "█" : "░");
+    }
+    fprintf(display_out, "]");
+}
+
 void display_memory_info(const memory_info_t *memory) {
     char total_str[32], used_str[32], free_str[32], available_str[32];
     char swap_total_str[32], swap_used_str[32];
@@ -116,118 +202,670 @@ void display_memory_info(const memory_info_t *memory) {
     format_bytes(memory->swap_total * 1024, swap_total_str);
     format_bytes(memory->swap_used * 1024, swap_used_str);
 
-    printf("%s┌─ Memory Information ──────────────────────────────────────────────────────────┐%s\n",
+    fprintf(display_out, "%s┌─ Memory Information ──────────────────────────────────────────────────────────┐%s\n",
            COLOR_MAGENTA, COLOR_RESET);
 
-    printf("%s│%s RAM Total: %s%-10s%s Used: %s%-10s%s Available: %s%-10s%s %17s %s│%s\n",
+    fprintf(display_out, "%s│%s RAM Total: %s%-10s%s Used: %s%-10s%s Available: %s%-10s%s %17s %s│%s\n",
            COLOR_MAGENTA, COLOR_RESET, COLOR_WHITE, total_str, COLOR_RESET,
            get_color_by_percentage(memory->usage_percent), used_str, COLOR_RESET,
            COLOR_WHITE, available_str, COLOR_RESET, "", COLOR_MAGENTA, COLOR_RESET);
 
-    printf("%s│%s RAM usage: %s%6.1f%%%s ",
+    fprintf(display_out, "%s│%s RAM usage: %s%6.1f%%%s ",
            COLOR_MAGENTA, COLOR_RESET, get_color_by_percentage(memory->usage_percent),
            memory->usage_percent, COLOR_RESET);
 
     int bar_length = 35;
     int filled = (int)(memory->usage_percent * bar_length / 100.0);
-    printf("[");
+    fprintf(display_out, "[");
     for (int i = 0; i < bar_length; i++) {
         if (i < filled) {
-            printf("█");
+            fprintf(display_out, "█");
         } else {
-            printf("░");
+            fprintf(display_out, "░");
         }
     }
-    printf("] %s│%s\n", COLOR_MAGENTA, COLOR_RESET);
+    fprintf(display_out, "] %s│%s\n", COLOR_MAGENTA, COLOR_RESET);
 
     if (memory->swap_total > 0) {
-        printf("%s│%s SWAP Total: %s%-10s%s Used: %s%-10s%s Usage: %s%6.1f%%%s %16s %s│%s\n",
+        fprintf(display_out, "%s│%s SWAP Total: %s%-10s%s Used: %s%-10s%s Usage: %s%6.1f%%%s %16s %s│%s\n",
                COLOR_MAGENTA, COLOR_RESET, COLOR_WHITE, swap_total_str, COLOR_RESET,
                get_color_by_percentage(memory->swap_percent), swap_used_str, COLOR_RESET,
                get_color_by_percentage(memory->swap_percent), memory->swap_percent, COLOR_RESET,
                "", COLOR_MAGENTA, COLOR_RESET);
     }
 
-    printf("%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+    // Breakdown of the page cache and kernel memory, then the vmstat rates
+    char shmem[16], slab[16], reclaimable[16], dirty[16], writeback[16], anon[16], file[16];
+    char row[128];
+    format_bytes_short(memory->shmem * 1024.0, shmem, sizeof(shmem));
+    format_bytes_short((memory->slab_reclaimable + memory->slab_unreclaimable) * 1024.0,
+                       slab, sizeof(slab));
+    format_bytes_short(memory->slab_reclaimable * 1024.0, reclaimable, sizeof(reclaimable));
+    format_bytes_short(memory->dirty * 1024.0, dirty, sizeof(dirty));
+    format_bytes_short(memory->writeback * 1024.0, writeback, sizeof(writeback));
+    format_bytes_short(memory->anon * 1024.0, anon, sizeof(anon));
+    format_bytes_short(memory->file * 1024.0, file, sizeof(file));
+    snprintf(row, sizeof(row), "Anon: %-6s File: %-6s Shmem: %-6s Slab: %s (%s reclaimable)",
+             anon, file, shmem, slab, reclaimable);
+    fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_MAGENTA, COLOR_RESET, row,
+           COLOR_MAGENTA, COLOR_RESET);
+
+    if (memory->hugepages_total > 0) {
+        char huge[16];
+        format_bytes_short(memory->hugepage_size * 1024.0, huge, sizeof(huge));
+        snprintf(row, sizeof(row), "Dirty: %-6s Writeback: %-6s Huge pages: %lu of %lu free (%s each)",
+                 dirty, writeback, memory->hugepages_free, memory->hugepages_total, huge);
+    } else {
+        snprintf(row, sizeof(row), "Dirty: %-6s Writeback: %-6s", dirty, writeback);
+    }
+    fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_MAGENTA, COLOR_RESET, row,
+           COLOR_MAGENTA, COLOR_RESET);
+
+    char faults[16], major[16], swapin[16], swapout[16], scan[16], steal[16], compact[16];
+    format_optional(memory->pgfault_per_sec, "%.0f", faults, sizeof(faults));
+    format_optional(memory->pgmajfault_per_sec, "%.0f", major, sizeof(major));
+    format_optional(memory->pswpin_per_sec, "%.0f", swapin, sizeof(swapin));
+    format_optional(memory->pswpout_per_sec, "%.0f", swapout, sizeof(swapout));
+    format_optional(memory->pgscan_per_sec, "%.0f", scan, sizeof(scan));
+    format_optional(memory->pgsteal_per_sec, "%.0f", steal, sizeof(steal));
+    format_optional(memory->compact_stall_per_sec, "%.0f", compact, sizeof(compact));
+    snprintf(row, sizeof(row), "Pages/s: faults %s  major %s  swap in %s  out %s",
+             faults, major, swapin, swapout);
+    fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_MAGENTA, COLOR_RESET, row,
+           COLOR_MAGENTA, COLOR_RESET);
+
+    // OOM kills are the one number here that should always be zero
+    char oom[24];
+    if (memory->oom_kills >= 0) {
+        snprintf(oom, sizeof(oom), "%lld", memory->oom_kills);
+    } else {
+        snprintf(oom, sizeof(oom), "-");
+    }
+    snprintf(row, sizeof(row), "Reclaim/s: scanned %s  reclaimed %s  compaction stalls %s  OOM kills: ",
+             scan, steal, compact);
+    fprintf(display_out, "%s│%s %s%s%-*s%s %s│%s\n", COLOR_MAGENTA, COLOR_RESET, row,
+           memory->oom_kills > 0 ? COLOR_RED : "", 77 - (int)strlen(row), oom, COLOR_RESET,
+           COLOR_MAGENTA, COLOR_RESET);
+
+    // One bar per node when there are several, to show the imbalance
+    if (memory->numa_count > 1) {
+        for (int i = 0; i < memory->numa_count; i++) {
+            const numa_node_t *node = &memory->numa[i];
+            char used[16], total[16];
+            format_bytes_short(node->used_kb * 1024.0, used, sizeof(used));
+            format_bytes_short(node->total_kb * 1024.0, total, sizeof(total));
+            fprintf(display_out, "%s│%s Node %-3d %s%5.1f%%%s ", COLOR_MAGENTA, COLOR_RESET,
+                   node->id, get_color_by_percentage(node->usage_percent), node->usage_percent,
+                   COLOR_RESET);
+            display_bar(node->usage_percent, 30);
+            snprintf(row, sizeof(row), "%s of %s", used, total);
+            fprintf(display_out, " %-28s %s│%s\n", row, COLOR_MAGENTA, COLOR_RESET);
+        }
+        char misses[16];
+        format_optional(memory->numa_miss_per_sec, "%.0f", misses, sizeof(misses));
+        snprintf(row, sizeof(row), "NUMA misses/s: %s", misses);
+        fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_MAGENTA, COLOR_RESET, row,
+               COLOR_MAGENTA, COLOR_RESET);
+    }
+
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
            COLOR_MAGENTA, COLOR_RESET);
 }
 
 void display_uptime_info(const uptime_info_t *uptime) {
-    printf("%s┌─ System Uptime ───────────────────────────────────────────────────────────────┐%s\n",
+    fprintf(display_out, "%s┌─ System Uptime ───────────────────────────────────────────────────────────────┐%s\n",
            COLOR_GREEN, COLOR_RESET);
-    printf("%s│%s System uptime: %s%-60s%s %s│%s\n",
+    fprintf(display_out, "%s│%s System uptime: %s%-60s%s %s│%s\n",
            COLOR_GREEN, COLOR_RESET, COLOR_WHITE, uptime->uptime_formatted, COLOR_RESET,
            COLOR_GREEN, COLOR_RESET);
-    printf("%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
            COLOR_GREEN, COLOR_RESET);
 }
 
-void display_disk_info(const disk_info_t *disk) {
+// Rows of the mount and device tables; the rest is summarized in one line
+#define DISK_DISPLAY_ROWS 8
+
+// Root filesystem only, for samples recorded without the mount table
+static void display_disk_summary(const disk_info_t *disk) {
     char total_str[32], used_str[32], available_str[32];
 
     format_bytes(disk->total_bytes, total_str);
     format_bytes(disk->used_bytes, used_str);
     format_bytes(disk->available_bytes, available_str);
 
-    printf("%s┌─ Disk Information ────────────────────────────────────────────────────────────┐%s\n",
-           COLOR_YELLOW, COLOR_RESET);
-    printf("%s│%s Filesystem: %s%-8s%s Total: %s%-10s%s Used: %s%-10s%s %19s %s│%s\n",
+    fprintf(display_out, "%s│%s Filesystem: %s%-8s%s Total: %s%-10s%s Used: %s%-10s%s %19s %s│%s\n",
            COLOR_YELLOW, COLOR_RESET, COLOR_WHITE, disk->filesystem, COLOR_RESET,
            COLOR_WHITE, total_str, COLOR_RESET,
            get_color_by_percentage(disk->usage_percent), used_str, COLOR_RESET,
            "", COLOR_YELLOW, COLOR_RESET);
 
-    printf("%s│%s Disk usage: %s%6.1f%%%s ",
+    fprintf(display_out, "%s│%s Disk usage: %s%6.1f%%%s ",
            COLOR_YELLOW, COLOR_RESET, get_color_by_percentage(disk->usage_percent),
            disk->usage_percent, COLOR_RESET);
+    display_bar(disk->usage_percent, 35);
+    fprintf(display_out, " %s│%s\n", COLOR_YELLOW, COLOR_RESET);
+}
 
-    int bar_length = 35;
-    int filled = (int)(disk->usage_percent * bar_length / 100.0);
-    printf("[");
-    for (int i = 0; i < bar_length; i++) {
-        if (i < filled) {
-            printf("█");
+static void display_mounts(const disk_info_t *disk) {
+    fprintf(display_out, "%s│%s %-18s %-6s %8s %8s %8s %6s %-12s%5s %s│%s\n",
+           COLOR_YELLOW, COLOR_RESET, "Mount", "Type", "Size", "Used", "Avail", "Use%", "",
+           "", COLOR_YELLOW, COLOR_RESET);
+
+    for (int i = 0; i < disk->mount_count && i < DISK_DISPLAY_ROWS; i++) {
+        const mount_info_t *m = &disk->mounts[i];
+        char total_str[32], used_str[32], available_str[32];
+
+        format_bytes(m->total_bytes, total_str);
+        format_bytes(m->used_bytes, used_str);
+        format_bytes(m->available_bytes, available_str);
+
+        fprintf(display_out, "%s│%s %s%-18.18s%s %-6.6s %8s %8s %8s %s%5.1f%%%s ",
+               COLOR_YELLOW, COLOR_RESET, COLOR_WHITE, m->mount_point, COLOR_RESET, m->fstype,
+               total_str, used_str, available_str,
+               get_color_by_percentage(m->usage_percent), m->usage_percent, COLOR_RESET);
+        display_bar(m->usage_percent, 10);
+        fprintf(display_out, "%5s %s│%s\n", "", COLOR_YELLOW, COLOR_RESET);
+    }
+    if (disk->mount_count > DISK_DISPLAY_ROWS) {
+        fprintf(display_out, "%s│%s ... and %-4d more mounts%53s %s│%s\n",
+               COLOR_YELLOW, COLOR_RESET, disk->mount_count - DISK_DISPLAY_ROWS, "",
+               COLOR_YELLOW, COLOR_RESET);
+    }
+}
+
+static void display_devices(const disk_info_t *disk) {
+    fprintf(display_out, "%s│%s %-10s %8s %8s %9s %9s %6s %8s %6s%6s %s│%s\n",
+           COLOR_YELLOW, COLOR_RESET, "Device", "Reads/s", "Writes/s", "Read", "Written",
+           "Queue", "Await ms", "Util", "", COLOR_YELLOW, COLOR_RESET);
+
+    for (int i = 0; i < disk->device_count && i < DISK_DISPLAY_ROWS; i++) {
+        const disk_io_t *d = &disk->devices[i];
+        char read_str[32], write_str[32];
+
+        format_bytes((unsigned long)d->read_bytes_per_sec, read_str);
+        format_bytes((unsigned long)d->write_bytes_per_sec, write_str);
+        strcat(read_str, "/s");
+        strcat(write_str, "/s");
+
+        fprintf(display_out, "%s│%s %s%-10.10s%s %8.1f %8.1f %9s %9s %6.2f %8.2f %s%5.1f%%%s%6s %s│%s\n",
+               COLOR_YELLOW, COLOR_RESET, COLOR_WHITE, d->name, COLOR_RESET,
+               d->read_iops, d->write_iops, read_str, write_str, d->queue_depth, d->await_ms,
+               get_color_by_percentage(d->util_percent), d->util_percent, COLOR_RESET,
+               "", COLOR_YELLOW, COLOR_RESET);
+    }
+    if (disk->device_count > DISK_DISPLAY_ROWS) {
+        fprintf(display_out, "%s│%s ... and %-4d more devices%52s %s│%s\n",
+               COLOR_YELLOW, COLOR_RESET, disk->device_count - DISK_DISPLAY_ROWS, "",
+               COLOR_YELLOW, COLOR_RESET);
+    }
+}
+
+void display_disk_info(const disk_info_t *disk) {
+    fprintf(display_out, "%s┌─ Disk Information ────────────────────────────────────────────────────────────┐%s\n",
+           COLOR_YELLOW, COLOR_RESET);
+
+    if (disk->mount_count > 0) {
+        display_mounts(disk);
+    } else {
+        display_disk_summary(disk);
+    }
+
+    // Rates need two samples, so a single run has none
+    if (disk->device_count > 0) {
+        fprintf(display_out, "%s│%79s│%s\n", COLOR_YELLOW, "", COLOR_RESET);
+        display_devices(disk);
+    }
+
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+           COLOR_YELLOW, COLOR_RESET);
+}
+
+// Rows of the interface table; the rest is summarized in one line
+#define NET_DISPLAY_ROWS 8
+
+void display_net_info(const net_info_t *net) {
+    fprintf(display_out, "%s┌─ Network Information ─────────────────────────────────────────────────────────┐%s\n",
+           COLOR_BLUE, COLOR_RESET);
+
+    // Rates need two samples, so a single run only shows the socket counts
+    if (net->interface_count > 0) {
+        fprintf(display_out, "%s│%s %-12s %10s %10s %9s %9s %9s %9s%2s %s│%s\n",
+               COLOR_BLUE, COLOR_RESET, "Interface", "RX", "TX", "RX pkt/s", "TX pkt/s",
+               "Drops/s", "Errors/s", "", COLOR_BLUE, COLOR_RESET);
+    }
+    for (int i = 0; i < net->interface_count && i < NET_DISPLAY_ROWS; i++) {
+        const net_if_t *nif = &net->interfaces[i];
+        char rx_str[32], tx_str[32];
+
+        format_bytes((unsigned long)nif->rx_bytes_per_sec, rx_str);
+        format_bytes((unsigned long)nif->tx_bytes_per_sec, tx_str);
+        strcat(rx_str, "/s");
+        strcat(tx_str, "/s");
+
+        double drops = nif->rx_drops_per_sec + nif->tx_drops_per_sec;
+        double errors = nif->rx_errors_per_sec + nif->tx_errors_per_sec;
+        fprintf(display_out, "%s│%s %s%-12.12s%s %10s %10s %9.1f %9.1f %s%9.1f %9.1f%s%2s %s│%s\n",
+               COLOR_BLUE, COLOR_RESET, COLOR_WHITE, nif->name, COLOR_RESET,
+               rx_str, tx_str, nif->rx_packets_per_sec, nif->tx_packets_per_sec,
+               drops + errors > 0 ? COLOR_RED : COLOR_GREEN, drops, errors, COLOR_RESET,
+               "", COLOR_BLUE, COLOR_RESET);
+    }
+    if (net->interface_count > NET_DISPLAY_ROWS) {
+        fprintf(display_out, "%s│%s ... and %-4d more interfaces%49s %s│%s\n",
+               COLOR_BLUE, COLOR_RESET, net->interface_count - NET_DISPLAY_ROWS, "",
+               COLOR_BLUE, COLOR_RESET);
+    }
+
+    // TCP sockets per state, non-empty states only, wrapped to the box
+    if (net->tcp_valid) {
+        char line[128];
+        int len = snprintf(line, sizeof(line), "TCP:");
+
+        for (int state = 1; state < NET_TCP_STATES; state++) {
+            if (net->tcp_states[state] == 0) continue;
+
+            char item[40];
+            int n = snprintf(item, sizeof(item), " %s %u", net_tcp_state_name(state),
+                             net->tcp_states[state]);
+            if (len + n > 77) {
+                fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_BLUE, COLOR_RESET, line,
+                       COLOR_BLUE, COLOR_RESET);
+                len = snprintf(line, sizeof(line), "    ");
+            }
+            len += snprintf(line + len, sizeof(line) - (size_t)len, "%s", item);
+        }
+        fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_BLUE, COLOR_RESET, line,
+               COLOR_BLUE, COLOR_RESET);
+    }
+
+    if (net->interface_count == 0 && !net->tcp_valid) {
+        fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_BLUE, COLOR_RESET,
+               "Interface rates appear from the second sample on", COLOR_BLUE, COLOR_RESET);
+    }
+
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+           COLOR_BLUE, COLOR_RESET);
+}
+
+void display_cgroups(const cgroup_tree_t *tree) {
+    char title[96];
+    int title_len = snprintf(title, sizeof(title), "─ Cgroups (%d tracked) ", tree->tracked) - 2;
+
+    // The title is padded with rules up to the 79 columns of the box
+    fprintf(display_out, "%s┌%s", COLOR_GREEN, title);
+    for (int i = title_len; i < 79; i++) fputs("─", display_out);
+    fprintf(display_out, "┐%s\n", COLOR_RESET);
+
+    fprintf(display_out, "%s│%s %-25s %6s %6s %6s %6s %5s %5s %5s %5s %s│%s\n",
+           COLOR_GREEN, COLOR_RESET, "CGROUP", "CPU%", "MEM", "READ/s", "WRIT/s", "THR%",
+           "P.CPU", "P.MEM", "P.IO", COLOR_GREEN, COLOR_RESET);
+
+    for (int i = 0; i < tree->count; i++) {
+        const cgroup_info_t *group = &tree->groups[i];
+        char name[256], mem_str[16], read_str[16], write_str[16];
+        char throttled_str[16], cpu_psi[16], mem_psi[16], io_psi[16];
+
+        // Indented last path component, truncated with an ellipsis
+        const char *base = strrchr(group->path, '/');
+        base = base ? base + 1 : group->path;
+        int indent = 2 * (group->depth - 1);
+        if (indent > 12) indent = 12;
+        snprintf(name, sizeof(name), "%*s%s", indent, "", base);
+        if (strlen(name) > 25) strcpy(name + 22, "...");
+
+        format_bytes_short(group->memory_bytes >= 0 ? (double)group->memory_bytes : -1.0,
+                           mem_str, sizeof(mem_str));
+        format_bytes_short(group->read_bytes_per_sec, read_str, sizeof(read_str));
+        format_bytes_short(group->write_bytes_per_sec, write_str, sizeof(write_str));
+        format_optional(group->throttled_percent, "%.1f", throttled_str, sizeof(throttled_str));
+        format_optional(group->cpu_pressure, "%.2f", cpu_psi, sizeof(cpu_psi));
+        format_optional(group->memory_pressure, "%.2f", mem_psi, sizeof(mem_psi));
+        format_optional(group->io_pressure, "%.2f", io_psi, sizeof(io_psi));
+
+        fprintf(display_out, "%s│%s %-25s %s%*.*f%%%s %6s %6s %6s %5s %5s %5s %5s %s│%s\n",
+               COLOR_GREEN, COLOR_RESET, name,
+               get_color_by_percentage(group->cpu_percent), 5, group->cpu_percent < 999.95 ? 1 : 0,
+               group->cpu_percent, COLOR_RESET, mem_str, read_str, write_str, throttled_str,
+               cpu_psi, mem_psi, io_psi, COLOR_GREEN, COLOR_RESET);
+    }
+
+    if (tree->count == 0) {
+        fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_GREEN, COLOR_RESET,
+               "No cgroup v2 groups below the root", COLOR_GREEN, COLOR_RESET);
+    }
+
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+           COLOR_GREEN, COLOR_RESET);
+}
+
+// Stalls hurt long before a resource is fully used: a few percent of time
+// stalled is already worth a look
+static const char *get_color_by_pressure(double percent) {
+    if (percent < 5.0) return COLOR_GREEN;
+    if (percent < 20.0) return COLOR_YELLOW;
+    return COLOR_RED;
+}
+
+void display_pressure(const pressure_info_t *pressure) {
+    const char *title = pressure->burst ? "─ Pressure Stall Information (stall burst) "
+                                        : "─ Pressure Stall Information ";
+    int title_len = (int)strlen(title) - 2;
+
+    fprintf(display_out, "%s┌%s", COLOR_CYAN, title);
+    for (int i = title_len; i < 79; i++) fputs("─", display_out);
+    fprintf(display_out, "┐%s\n", COLOR_RESET);
+
+    fprintf(display_out, "%s│%s %-10s %-27s   %-27s %8s %s│%s\n",
+           COLOR_CYAN, COLOR_RESET, "", "SOME (% of time stalled)", "FULL (% of time stalled)", "",
+           COLOR_CYAN, COLOR_RESET);
+    fprintf(display_out, "%s│%s %-10s %6s %6s %6s %6s   %6s %6s %6s %6s %8s %s│%s\n",
+           COLOR_CYAN, COLOR_RESET, "RESOURCE", "AVG10", "AVG60", "AVG300", "NOW",
+           "AVG10", "AVG60", "AVG300", "NOW", "TRIGGERS", COLOR_CYAN, COLOR_RESET);
+
+    for (int r = 0; r < PSI_RESOURCES; r++) {
+        const psi_info_t *psi = &pressure->resources[r];
+        char some_now[16], full[4][16], stalls[16];
+
+        format_optional(psi->some.stall_percent, "%.2f", some_now, sizeof(some_now));
+        format_optional(psi->has_full ? psi->full.avg10 : -1.0, "%.2f", full[0], sizeof(full[0]));
+        format_optional(psi->has_full ? psi->full.avg60 : -1.0, "%.2f", full[1], sizeof(full[1]));
+        format_optional(psi->has_full ? psi->full.avg300 : -1.0, "%.2f", full[2], sizeof(full[2]));
+        format_optional(psi->has_full ? psi->full.stall_percent : -1.0, "%.2f", full[3], sizeof(full[3]));
+        if (psi->armed) {
+            snprintf(stalls, sizeof(stalls), "%u", psi->stalls);
         } else {
-            printf("░");
+            snprintf(stalls, sizeof(stalls), "-");
         }
+
+        fprintf(display_out, "%s│%s %-10s %s%6.2f%s %6.2f %6.2f %6s   %s%6s%s %6s %6s %6s %s%8s%s %s│%s\n",
+               COLOR_CYAN, COLOR_RESET, psi_resource_name(r),
+               get_color_by_pressure(psi->some.avg10), psi->some.avg10, COLOR_RESET,
+               psi->some.avg60, psi->some.avg300, some_now,
+               get_color_by_pressure(psi->has_full ? psi->full.avg10 : 0.0), full[0], COLOR_RESET,
+               full[1], full[2], full[3],
+               psi->stalls > 0 ? COLOR_RED : COLOR_RESET, stalls, COLOR_RESET, COLOR_CYAN, COLOR_RESET);
     }
-    printf("] %s│%s\n", COLOR_YELLOW, COLOR_RESET);
 
-    printf("%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
-           COLOR_YELLOW, COLOR_RESET);
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+}
+
+// Temperatures turn yellow 15 degrees short of the chip's high mark and red
+// at it; chips without thresholds use 80 C
+static const char *get_color_by_temperature(const sensor_t *sensor) {
+    double high = sensor->max > 0 ? sensor->max : sensor->crit > 0 ? sensor->crit - 10.0 : 80.0;
+    if (sensor->value >= high) return COLOR_RED;
+    if (sensor->value >= high - 15.0) return COLOR_YELLOW;
+    return COLOR_GREEN;
+}
+
+// Ends a row of sensor cells, padding it to the box width
+static void sensor_row_end(int *column) {
+    if (*column == 0) return;
+    fprintf(display_out, "%*s %s│%s\n", 77 - *column, "", COLOR_MAGENTA, COLOR_RESET);
+    *column = 0;
+}
+
+// Prints one "label value" cell, wrapping onto a new row when it does not
+// fit. Values are 9 columns wide ("°C" is one column but two bytes).
+static void sensor_cell(int *column, int label_width, const char *label, const sensor_t *sensor) {
+    char value[16];
+    const char *color = COLOR_RESET;
+    int width = label_width + 1 + 9;
+
+    if (!sensor->valid) {
+        snprintf(value, sizeof(value), "%9s", "-");
+    } else if (sensor->kind == SENSOR_FAN) {
+        snprintf(value, sizeof(value), "%5.0f rpm", sensor->value);
+    } else if (sensor->kind == SENSOR_POWER) {
+        snprintf(value, sizeof(value), "%7.1f W", sensor->value);
+    } else {
+        snprintf(value, sizeof(value), "%7.1f°C", sensor->value);
+        color = get_color_by_temperature(sensor);
+    }
+
+    if (*column > 0 && *column + 2 + width > 77) sensor_row_end(column);
+    if (*column == 0) {
+        fprintf(display_out, "%s│%s ", COLOR_MAGENTA, COLOR_RESET);
+    } else {
+        fputs("  ", display_out);
+        *column += 2;
+    }
+    fprintf(display_out, "%-*.*s %s%s%s", label_width, label_width, label, color, value, COLOR_RESET);
+    *column += width;
+}
+
+// Packages first, each with its RAPL power and its cores, then every other
+// temperature, fan and power domain two to a row
+void display_sensors(const sensor_info_t *sensors) {
+    char used[MAX_SENSORS] = {0};
+    char label[64];
+    int count = sensors->count < MAX_SENSORS ? sensors->count : MAX_SENSORS;
+    int column = 0;
+
+    fprintf(display_out, "%s┌─ Sensors ─────────────────────────────────────────────────────────────────────┐%s\n",
+           COLOR_MAGENTA, COLOR_RESET);
+
+    for (int i = 0; i < count; i++) {
+        const sensor_t *package = &sensors->sensors[i];
+        if (package->kind != SENSOR_PACKAGE) continue;
+        used[i] = 1;
+
+        if (package->package >= 0) {
+            snprintf(label, sizeof(label), "Package %d (%s)", package->package, package->chip);
+        } else {
+            snprintf(label, sizeof(label), "%s (%s)", package->label, package->chip);
+        }
+        sensor_row_end(&column);
+        sensor_cell(&column, 26, label, package);
+
+        // The package's own RAPL zone ("package-N"), not its subzones
+        for (int j = 0; j < count && package->package >= 0; j++) {
+            const sensor_t *power = &sensors->sensors[j];
+            if (used[j] || power->kind != SENSOR_POWER || power->package != package->package ||
+                strchr(power->label, ' ')) {
+                continue;
+            }
+            used[j] = 1;
+            sensor_cell(&column, 26, power->label, power);
+            break;
+        }
+        sensor_row_end(&column);
+
+        for (int j = 0; j < count; j++) {
+            const sensor_t *core = &sensors->sensors[j];
+            if (used[j] || core->kind != SENSOR_CORE || core->package != package->package) continue;
+            used[j] = 1;
+            snprintf(label, sizeof(label), "Core %d", core->core);
+            sensor_cell(&column, 7, label, core);
+        }
+        sensor_row_end(&column);
+    }
+
+    for (int i = 0; i < count; i++) {
+        const sensor_t *sensor = &sensors->sensors[i];
+        if (used[i]) continue;
+        snprintf(label, sizeof(label), "%s %s", sensor->chip, sensor->label);
+        sensor_cell(&column, 26, label, sensor);
+    }
+    sensor_row_end(&column);
+
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+           COLOR_MAGENTA, COLOR_RESET);
+}
+
+// Per-core rows shown in the rolling windows panel; the exports have them all
+#define WINDOW_CORE_ROWS 16
+
+// Formats a series value in at most 5 columns, "-" for an empty window
+static void format_series_value(series_unit_t unit, double value, int present,
+                                char *output, size_t size) {
+    if (!present) {
+        snprintf(output, size, "-");
+    } else if (unit == SERIES_PERCENT) {
+        snprintf(output, size, "%.1f", value);
+    } else {
+        format_bytes_short(value, output, size);
+    }
+}
+
+void display_windows(const window_info_t *windows) {
+    fprintf(display_out, "%s┌─ Rolling Windows ─────────────────────────────────────────────────────────────┐%s\n",
+           COLOR_BLUE, COLOR_RESET);
+    fprintf(display_out, "%s│%s %-10s %6s  %-17s  %-17s  %-17s    %s│%s\n",
+           COLOR_BLUE, COLOR_RESET, "", "", window_name(0), window_name(1), window_name(2),
+           COLOR_BLUE, COLOR_RESET);
+    fprintf(display_out, "%s│%s %-10s %6s  %5s %5s %5s  %5s %5s %5s  %5s %5s %5s    %s│%s\n",
+           COLOR_BLUE, COLOR_RESET, "SERIES", "NOW", "MEAN", "P95", "MAX", "MEAN", "P95", "MAX",
+           "MEAN", "P95", "MAX", COLOR_BLUE, COLOR_RESET);
+
+    int cores = 0;
+    for (int i = 0; i < windows->count; i++) {
+        const series_stats_t *series = &windows->series[i];
+        char now[16], cells[WINDOW_COUNT][3][16];
+
+        // Per-core series follow the fixed ones
+        if (strncmp(series->name, "cpu", 3) == 0 && isdigit((unsigned char)series->name[3]) &&
+            ++cores > WINDOW_CORE_ROWS) {
+            continue;
+        }
+
+        int sampled = series->windows[0].count > 0;
+        format_series_value(series->unit, series->current, sampled, now, sizeof(now));
+        for (int w = 0; w < WINDOW_COUNT; w++) {
+            const window_stats_t *window = &series->windows[w];
+            format_series_value(series->unit, window->mean, window->count > 0,
+                                cells[w][0], sizeof(cells[w][0]));
+            format_series_value(series->unit, window->p95, window->count > 0,
+                                cells[w][1], sizeof(cells[w][1]));
+            format_series_value(series->unit, window->max, window->count > 0,
+                                cells[w][2], sizeof(cells[w][2]));
+        }
+
+        const char *color = series->unit == SERIES_PERCENT && sampled ?
+                            get_color_by_percentage(series->current) : COLOR_RESET;
+        fprintf(display_out, "%s│%s %-10.10s %s%6s%s  %5s %5s %5s  %5s %5s %5s  %5s %5s %5s    %s│%s\n",
+               COLOR_BLUE, COLOR_RESET, series->name, color, now, COLOR_RESET,
+               cells[0][0], cells[0][1], cells[0][2], cells[1][0], cells[1][1], cells[1][2],
+               cells[2][0], cells[2][1], cells[2][2], COLOR_BLUE, COLOR_RESET);
+    }
+
+    if (cores > WINDOW_CORE_ROWS) {
+        char more[64];
+        snprintf(more, sizeof(more), "... %d more cores", cores - WINDOW_CORE_ROWS);
+        fprintf(display_out, "%s│%s %-77s %s│%s\n", COLOR_BLUE, COLOR_RESET, more,
+               COLOR_BLUE, COLOR_RESET);
+    }
+
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+           COLOR_BLUE, COLOR_RESET);
 }
 
 void display_processes(const process_info_t *processes, int count) {
-    printf("%s┌─ Top Processes ───────────────────────────────────────────────────────────────┐%s\n",
+    fprintf(display_out, "%s┌─ Top Processes ───────────────────────────────────────────────────────────────┐%s\n",
            COLOR_RED, COLOR_RESET);
-    printf("%s│%s %5s %-16s %8s %12s %34s %s│%s\n",
-           COLOR_RED, COLOR_RESET, "PID", "NAME", "CPU%", "MEMORY", "", COLOR_RED, COLOR_RESET);
-    printf("%s│%s────────────────────────────────────────────────────────────────────────────── %s│%s\n",
+    fprintf(display_out, "%s│%s %7s %-14s %6s %6s %6s %4s %6s %6s %7s %6s %s│%s\n",
+           COLOR_RED, COLOR_RESET, "PID", "NAME", "CPU%", "RSS", "PSS", "THR", "READ/s", "WRIT/s",
+           "CSW/s", "MAJF/s", COLOR_RED, COLOR_RESET);
+    fprintf(display_out, "%s│%s────────────────────────────────────────────────────────────────────────────── %s│%s\n",
            COLOR_RED, COLOR_RESET, COLOR_RED, COLOR_RESET);
 
-    for (int i = 0; i < count && i < 10; i++) {
-        char mem_str[32];
-        char truncated_name[17]; // 16 chars + null terminator
-
-        format_bytes(processes[i].memory_kb * 1024, mem_str);
+    for (int i = 0; i < count; i++) {
+        const process_info_t *proc = &processes[i];
+        char rss_str[16], pss_str[16], read_str[16], write_str[16], csw_str[16];
+        char truncated_name[15]; // 14 chars + null terminator
+
+        format_bytes_short((double)proc->memory_kb * 1024, rss_str, sizeof(rss_str));
+        format_bytes_short(proc->pss_kb >= 0 ? (double)proc->pss_kb * 1024 : -1.0,
+                           pss_str, sizeof(pss_str));
+        format_bytes_short(proc->read_bytes_per_sec, read_str, sizeof(read_str));
+        format_bytes_short(proc->write_bytes_per_sec, write_str, sizeof(write_str));
+
+        // Voluntary (waiting) plus involuntary (preempted) switches
+        if (proc->voluntary_ctxsw_per_sec >= 0) {
+            snprintf(csw_str, sizeof(csw_str), "%.0f",
+                     proc->voluntary_ctxsw_per_sec + proc->involuntary_ctxsw_per_sec);
+        } else {
+            strcpy(csw_str, "-");
+        }
 
         // Truncate process name if too long and add ellipsis
-        if (strlen(processes[i].name) > 16) {
-            strncpy(truncated_name, processes[i].name, 13);
+        if (strlen(proc->name) > 14) {
+            strncpy(truncated_name, proc->name, 11);
+            truncated_name[11] = '.';
+            truncated_name[12] = '.';
             truncated_name[13] = '.';
-            truncated_name[14] = '.';
-            truncated_name[15] = '.';
-            truncated_name[16] = '\0';
+            truncated_name[14] = '\0';
         } else {
-            strcpy(truncated_name, processes[i].name);
+            strcpy(truncated_name, proc->name);
         }
 
-        printf("%s│%s %5d %-16s %s%7.1f%%%s %12s %34s %s│%s\n",
-               COLOR_RED, COLOR_RESET, processes[i].pid, truncated_name,
-               get_color_by_percentage(processes[i].cpu_percent), processes[i].cpu_percent, COLOR_RESET,
-               mem_str, "", COLOR_RED, COLOR_RESET);
+        // Multithreaded processes can go past 999%, which needs no decimal
+        fprintf(display_out, "%s│%s %7d %-14s %s%*.*f%%%s %6s %6s %4d %6s %6s %7s %6.1f %s│%s\n",
+               COLOR_RED, COLOR_RESET, proc->pid, truncated_name,
+               get_color_by_percentage(proc->cpu_percent), 5, proc->cpu_percent < 999.95 ? 1 : 0,
+               proc->cpu_percent, COLOR_RESET, rss_str, pss_str, proc->threads, read_str, write_str,
+               csw_str, proc->major_faults_per_sec, COLOR_RED, COLOR_RESET);
     }
 
-    printf("%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
            COLOR_RED, COLOR_RESET);
-}
\ No newline at end of file
+}
+// Displays the watch-mode status line below the sections
+void display_status(const event_loop_t *loop) {
+    long interval_ms = loop->burst_left > 0 ? loop->burst_ms : loop->interval_ms;
+
+    fprintf(display_out, " Interval: %s%ld ms%s   Overruns: %s%llu%s",
+            loop->burst_left > 0 ? COLOR_RED : COLOR_WHITE, interval_ms, COLOR_RESET,
+            loop->overruns > 0 ? COLOR_RED : COLOR_GREEN,
+            (unsigned long long)loop->overruns, COLOR_RESET);
+    if (loop->triggers > 0) {
+        fprintf(display_out, "   Stalls: %s%llu%s", loop->stalls > 0 ? COLOR_RED : COLOR_GREEN,
+                (unsigned long long)loop->stalls, COLOR_RESET);
+    }
+    fprintf(display_out, "   %s[q]%s quit  %s[r]%s refresh\n",
+            COLOR_BOLD, COLOR_RESET, COLOR_BOLD, COLOR_RESET);
+}
+
+// Formats a duration in nanoseconds with a readable unit
+static void format_duration(double ns, char *output, size_t size) {
+    if (ns >= 1e9) {
+        snprintf(output, size, "%.2f s", ns / 1e9);
+    } else if (ns >= 1e6) {
+        snprintf(output, size, "%.2f ms", ns / 1e6);
+    } else if (ns >= 1e3) {
+        snprintf(output, size, "%.1f us", ns / 1e3);
+    } else {
+        snprintf(output, size, "%.0f ns", ns);
+    }
+}
+
+// Displays what each collector and the renderer cost per call
+void display_self_stats(void) {
+    fprintf(display_out, "%s┌─ Self Statistics (per call) ──────────────────────────────────────────────────┐%s\n",
+            COLOR_CYAN, COLOR_RESET);
+    fprintf(display_out, "%s│%s %-12s %8s %10s %10s %10s %9s %11s %s│%s\n",
+            COLOR_CYAN, COLOR_RESET, "PROBE", "CALLS", "WALL", "CPU", "P99", "SYSCALLS", "BYTES",
+            COLOR_CYAN, COLOR_RESET);
+
+    for (int p = 0; p < PROBE_COUNT; p++) {
+        selfstat_summary_t s;
+        char wall[16], cpu[16], p99[16], bytes[32];
+
+        selfstat_summary((selfstat_probe_t)p, &s);
+        if (s.count == 0) continue;
+
+        format_duration((double)s.wall_ns / s.count, wall, sizeof(wall));
+        format_duration((double)s.cpu_ns / s.count, cpu, sizeof(cpu));
+        format_duration((double)s.p99_ns, p99, sizeof(p99));
+        format_bytes((unsigned long)(s.bytes / s.count), bytes);
+
+        fprintf(display_out, "%s│%s %-12s %8llu %10s %10s %10s %9.1f %11s %s│%s\n",
+                COLOR_CYAN, COLOR_RESET, selfstat_probe_name((selfstat_probe_t)p),
+                (unsigned long long)s.count, wall, cpu, p99, (double)s.syscalls / s.count, bytes,
+                COLOR_CYAN, COLOR_RESET);
+    }
+
+    fprintf(display_out, "%s└───────────────────────────────────────────────────────────────────────────────┘%s\n\n",
+            COLOR_CYAN, COLOR_RESET);
+}
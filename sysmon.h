@@ -1,6 +1,9 @@
 #ifndef SYSMON_H
 #define SYSMON_H
 
+// Expose POSIX/Linux interfaces (pread, openat, ...) under -std=c99
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,13 +13,19 @@
 #include <ctype.h>
 #include <sys/statvfs.h>
 #include <sys/sysinfo.h>
+#include <stdint.h>
+#include <limits.h>
+#include <termios.h>
 
-// Maximum number of CPU cores to track
-#define MAX_CPU_CORES 32
 // Maximum line length for file reading
 #define MAX_LINE_LEN 512
 // Maximum process name length
 #define MAX_PROC_NAME 32
+// Upper bound and default for the number of top processes kept
+#define MAX_TOP_PROCESSES 64
+#define DEFAULT_TOP_PROCESSES 10
+// Upper bound for the process scan thread count
+#define MAX_SCAN_THREADS 64
 
 // ANSI color codes for terminal output
 #define COLOR_RESET   "\033[0m"
@@ -29,20 +38,72 @@
 #define COLOR_WHITE   "\033[37m"
 #define COLOR_BOLD    "\033[1m"
 
+// /proc/stat tick fields, in file order
+enum {
+    CPU_USER, CPU_NICE, CPU_SYSTEM, CPU_IDLE, CPU_IOWAIT, CPU_IRQ, CPU_SOFTIRQ, CPU_STEAL,
+    CPU_FIELDS
+};
+
+// Tick counters of many cores as structure-of-arrays (field[CPU_IDLE][core]),
+// each array 64-byte aligned
+typedef struct {
+    uint64_t *field[CPU_FIELDS];
+} cpu_counters_t;
+
+// Per-core percentages computed by a cpu_kernel_fn
+typedef struct {
+    double *usage;                      // Busy time (everything but idle)
+    double *iowait;                     // Waiting for I/O
+    double *steal;                      // Stolen by the hypervisor
+    double *irq;                        // Hard and soft interrupts
+} cpu_usage_t;
+
+// Computes per-core percentages from two samples of count cores
+typedef void (*cpu_kernel_fn)(const cpu_counters_t *cur, const cpu_counters_t *prev,
+                              const cpu_usage_t *out, int count);
+
+typedef struct {
+    const char *name;
+    cpu_kernel_fn fn;
+} cpu_kernel_t;
+
 // CPU information structure
 typedef struct {
     char model[128];                    // CPU model name
-    int cores;                          // Number of CPU cores
-    double usage[MAX_CPU_CORES];        // Per-core usage percentages
+    int cores;                          // Number of CPU cores (configured, online or not)
+    int online;                         // Cores online in this sample
+    const double *usage;                // Per-core usage percentages, -1 for offline
+                                        // cores (owned by the collector or the record)
+    const double *iowait;               // Per-core iowait/steal/irq percentages,
+    const double *steal;                // same length and ownership as usage
+    const double *irq;
     double total_usage;                 // Overall CPU usage percentage
+    double iowait_percent;              // Overall breakdown of the same interval
+    double steal_percent;
+    double irq_percent;
     double temperature;                 // CPU temperature in Celsius
 } cpu_info_t;
 
+// NUMA nodes listed per sample
+#define MAX_NUMA_NODES 16
+
+// Memory of one NUMA node, from /sys/devices/system/node/nodeN/meminfo
+typedef struct {
+    int32_t id;                         // N of nodeN
+    uint64_t total_kb;
+    uint64_t free_kb;
+    uint64_t used_kb;                   // Same accounting as memory_info_t.used
+    uint64_t file_kb;                   // Page cache (FilePages)
+    uint64_t anon_kb;                   // Anonymous pages
+    double usage_percent;               // used_kb of total_kb
+} numa_node_t;
+
 // Memory information structure
 typedef struct {
     unsigned long total;                // Total RAM in KB
     unsigned long available;            // Available RAM in KB
-    unsigned long used;                 // Used RAM in KB
+    unsigned long used;                 // Used RAM in KB: not free, buffers or page cache,
+                                        // with SReclaimable as cache and Shmem as used
     unsigned long free;                 // Free RAM in KB
     unsigned long buffers;              // Buffer memory in KB
     unsigned long cached;               // Cached memory in KB
@@ -51,6 +112,27 @@ typedef struct {
     unsigned long swap_free;            // Free swap in KB
     double usage_percent;               // RAM usage percentage
     double swap_percent;                // Swap usage percentage
+    unsigned long shmem;                // tmpfs and shared memory in KB
+    unsigned long slab_reclaimable;     // Reclaimable slab (dentries, inodes) in KB
+    unsigned long slab_unreclaimable;   // Unreclaimable slab in KB
+    unsigned long dirty;                // Waiting to be written back in KB
+    unsigned long writeback;            // Being written back in KB
+    unsigned long anon;                 // Anonymous pages in KB
+    unsigned long file;                 // Active and inactive page cache in KB
+    unsigned long hugepages_total;      // Huge page pool, in pages
+    unsigned long hugepages_free;
+    unsigned long hugepage_size;        // Default huge page size in KB
+    double pgfault_per_sec;             // /proc/vmstat rates over the interval,
+    double pgmajfault_per_sec;          // -1 until there are two samples
+    double pswpin_per_sec;              // Pages swapped in and out
+    double pswpout_per_sec;
+    double pgscan_per_sec;              // Pages scanned and reclaimed by kswapd and
+    double pgsteal_per_sec;             // direct reclaim
+    double compact_stall_per_sec;       // Direct compaction stalls
+    double numa_miss_per_sec;           // Allocations that fell back to another node
+    long long oom_kills;                // OOM kills over the interval, -1 unknown
+    int numa_count;                     // Entries in numa, 0 without NUMA in sysfs
+    numa_node_t numa[MAX_NUMA_NODES];
 } memory_info_t;
 
 // System uptime information structure
@@ -60,53 +142,742 @@ typedef struct {
     unsigned long session_time;         // Current session time
 } uptime_info_t;
 
+// Capacity of one mounted filesystem
+typedef struct {
+    char mount_point[128];              // Where it is mounted (truncated if longer)
+    char device[64];                    // Mount source, e.g. /dev/nvme0n1p2
+    char fstype[32];                    // Filesystem type
+    uint64_t total_bytes;
+    uint64_t used_bytes;
+    uint64_t available_bytes;           // Available to unprivileged users
+    double usage_percent;
+} mount_info_t;
+
+// I/O of one block device over the last interval, from /proc/diskstats
+typedef struct {
+    char name[32];                      // Kernel device name, e.g. sda
+    double read_iops;                   // Completed reads per second
+    double write_iops;                  // Completed writes per second
+    double read_bytes_per_sec;
+    double write_bytes_per_sec;
+    double queue_depth;                 // Average requests in flight
+    double await_ms;                    // Average time per request, queueing included
+    double util_percent;                // Time the device was busy
+} disk_io_t;
+
 // Disk usage information structure
 typedef struct {
-    char filesystem[64];                // Filesystem name
+    char filesystem[64];                // Root filesystem summary: mount point
     unsigned long total_bytes;          // Total disk space in bytes
     unsigned long used_bytes;           // Used disk space in bytes
     unsigned long available_bytes;      // Available disk space in bytes
     double usage_percent;               // Disk usage percentage
+    int mount_count;                    // Real (non-pseudo) mounts
+    const mount_info_t *mounts;         // [mount_count], valid until the next sample
+    int device_count;                   // Whole block devices that have done I/O
+    const disk_io_t *devices;           // [device_count], valid until the next sample
+    int capacity_fresh;                 // Mount capacities queried in this sample
 } disk_info_t;
 
+// Traffic of one network interface over the last interval, from /proc/net/dev
+typedef struct {
+    char name[32];                      // Interface name, e.g. eth0
+    double rx_bytes_per_sec;
+    double tx_bytes_per_sec;
+    double rx_packets_per_sec;
+    double tx_packets_per_sec;
+    double rx_drops_per_sec;
+    double tx_drops_per_sec;
+    double rx_errors_per_sec;
+    double tx_errors_per_sec;
+} net_if_t;
+
+// TCP states as numbered by the kernel (TCP_ESTABLISHED = 1 ... TCP_CLOSING = 11)
+#define NET_TCP_STATES 12
+
+// Network information structure
+typedef struct {
+    int interface_count;                // Interfaces with rates
+    const net_if_t *interfaces;         // [interface_count], valid until the next sample
+    double rx_bytes_per_sec;            // Sum over every interface but loopback
+    double tx_bytes_per_sec;
+    int tcp_valid;                      // tcp_states was filled (--tcp-states)
+    uint32_t tcp_states[NET_TCP_STATES]; // IPv4 + IPv6 TCP sockets per state
+} net_info_t;
+
+// Pressure stall information (PSI) resources, in /proc/pressure file order
+typedef enum {
+    PSI_CPU,
+    PSI_MEMORY,
+    PSI_IO,
+    PSI_RESOURCES
+} psi_resource_t;
+
+// One line of a pressure file
+typedef struct {
+    double avg10;                       // Kernel running averages, percent of time stalled
+    double avg60;
+    double avg300;
+    double stall_percent;               // From the total over the last interval, negative on the first sample
+    uint64_t total_usec;                // Stall time since boot
+} psi_line_t;
+
+typedef struct {
+    psi_line_t some;                    // At least one task stalled
+    psi_line_t full;                    // Every non-idle task stalled at once
+    int32_t has_full;                   // full was reported (cpu: 5.13 and later)
+    int32_t armed;                      // A stall trigger is set on this resource
+    uint32_t stalls;                    // Trigger wakeups since the previous sample
+    uint32_t reserved;
+} psi_info_t;
+
+// Pressure stall information structure
+typedef struct {
+    psi_info_t resources[PSI_RESOURCES];
+    int32_t burst;                      // Sampled in the fast burst after a stall trigger
+    int32_t reserved;
+} pressure_info_t;
+
+// Stall trigger burst: samples taken at a short period after a trigger fired
+#define PSI_BURST_INTERVAL_MS 100
+#define PSI_BURST_SAMPLES     20
+// Default trigger window; the kernel accepts 500 ms to 10 s
+#define PSI_TRIGGER_WINDOW_MS 1000
+
+// One cgroup v2 group in the ranked tree. cgroup v2 counters are
+// hierarchical: a group includes everything below it.
+typedef struct {
+    char path[192];                     // Relative to the cgroup root, e.g. "system.slice/sshd.service"
+    int32_t depth;                      // 1 for top-level groups
+    int32_t reserved;
+    double cpu_percent;                 // cpu.stat usage over the interval, percent of one CPU
+    double throttled_percent;           // Time throttled by cpu.max, negative without the cpu controller
+    int64_t memory_bytes;               // memory.current, negative without the memory controller
+    int64_t anon_bytes;                 // memory.stat anon and file,
+    int64_t file_bytes;                 // negative if not readable
+    double read_bytes_per_sec;          // io.stat summed over devices
+    double write_bytes_per_sec;
+    double cpu_pressure;                // "some" avg10 of the PSI files in percent,
+    double memory_pressure;             // negative if not readable
+    double io_pressure;
+} cgroup_info_t;
+
+// Ranked cgroup tree: the busiest groups plus their ancestors, in preorder
+// with siblings busiest first
+#define MAX_CGROUP_ROWS 32
+
+typedef struct {
+    int count;
+    const cgroup_info_t *groups;        // Valid until the next read_cgroup_info()
+    int tracked;                        // Groups known in the whole hierarchy
+} cgroup_tree_t;
+
 // Process information structure
 typedef struct {
     char name[MAX_PROC_NAME];           // Process name
     int pid;                            // Process ID
     double cpu_percent;                 // CPU usage percentage
-    unsigned long memory_kb;            // Memory usage in KB
+    unsigned long memory_kb;            // Resident set size in KB
+    long pss_kb;                        // Proportional set size in KB, negative if not readable
+    int threads;                        // Number of threads
+    double io_rate;                     // Disk I/O in bytes/s, negative if not sampled
+    double read_bytes_per_sec;          // Storage reads and writes from /proc/[pid]/io,
+    double write_bytes_per_sec;         // negative if not readable
+    double voluntary_ctxsw_per_sec;     // Context switches from /proc/[pid]/status,
+    double involuntary_ctxsw_per_sec;   // negative if not readable
+    double major_faults_per_sec;        // Page faults that needed I/O
 } process_info_t;
 
+// Keys the process list can be ranked by
+typedef enum {
+    SORT_CPU,                           // CPU usage over the last interval
+    SORT_RSS,                           // Resident memory
+    SORT_IO,                            // Disk read + write bytes/s
+    SORT_THREADS                        // Thread count
+} proc_sort_t;
+
+// Hardware sensors (hwmon, thermal zones, RAPL)
+#define MAX_SENSORS 128
+#define SENSOR_NAME_SIZE 24
+
+typedef enum {
+    SENSOR_PACKAGE,                     // CPU package temperature
+    SENSOR_CORE,                        // CPU core temperature
+    SENSOR_TEMP,                        // Any other temperature
+    SENSOR_FAN,                         // Fan speed
+    SENSOR_POWER                        // RAPL domain power
+} sensor_kind_t;
+
+typedef struct {
+    char chip[SENSOR_NAME_SIZE];        // hwmon name, thermal zone type or "rapl"
+    char label[32];                     // "Package id 0", "Core 3", "fan1", "package-0 dram"
+    int32_t kind;                       // sensor_kind_t
+    int32_t package;                    // CPU package, -1 for none
+    int32_t core;                       // Core id within the package, -1 for none
+    int32_t valid;                      // value was read (power needs two samples)
+    double value;                       // Celsius, RPM or watts
+    double max;                         // Temperature thresholds, -1 when not exported
+    double crit;
+} sensor_t;
+
+typedef struct {
+    int count;
+    const sensor_t *sensors;            // [count], valid until the next sample
+} sensor_info_t;
+
+// Rolling windows of --windows over the fast metrics
+#define WINDOW_COUNT 3                  // 10 s, 1 min and 5 min
+#define WINDOW_SLOTS 10                 // Sub-windows each window slides by
+#define WINDOW_BINS  128                // Quantile sketch bins per sub-window
+#define DEFAULT_FAST_INTERVAL_MS 100    // Sampling period of the fast collectors
+#define MIN_FAST_INTERVAL_MS 20
+
+typedef enum {
+    SERIES_PERCENT,                     // 0-100, linear sketch bins
+    SERIES_BYTES_RATE                   // Bytes per second, logarithmic bins
+} series_unit_t;
+
+// One window of one series
+typedef struct {
+    uint32_t count;                     // Fast samples in the window, 0 for none
+    double min;
+    double max;
+    double mean;
+    double p50;                         // Sketch estimates
+    double p95;
+    double p99;
+} window_stats_t;
+
+typedef struct {
+    char name[16];                      // "cpu", "memory", "disk.read", "cpu3", ...
+    series_unit_t unit;
+    double current;                     // Latest fast sample
+    window_stats_t windows[WINDOW_COUNT];
+} series_stats_t;
+
+typedef struct {
+    int count;
+    const series_stats_t *series;       // [count], valid until the next sample
+} window_info_t;
+
 // Main system information structure containing all metrics
 typedef struct {
     cpu_info_t cpu;                     // CPU information
     memory_info_t memory;               // Memory information
     uptime_info_t uptime;               // Uptime information
     disk_info_t disk;                   // Disk information
-    process_info_t top_processes[10];   // Top 10 processes
+    net_info_t net;                     // Network information
+    cgroup_tree_t cgroups;              // cgroup v2 tree (--cgroups)
+    pressure_info_t pressure;           // Pressure stall information
+    window_info_t windows;              // Rolling windows (--windows)
+    sensor_info_t sensors;              // Temperatures, fans and power
+    process_info_t top_processes[MAX_TOP_PROCESSES]; // Top processes, best first
     int process_count;                  // Number of processes found
+    int valid_flags;                    // SHOW_* bits of the sections collected
+    int stale_flags;                    // SHOW_* bits of sections carried over from an
+                                        // earlier sample (adaptive sampling)
+    double timestamp;                   // Wall-clock sample time (seconds since epoch)
 } system_info_t;
 
+// What to collect on every sample
+typedef struct {
+    int show_flags;                     // SHOW_* bits of the sections to read
+    int top_count;                      // Number of top processes to keep
+    proc_sort_t sort_key;               // Key processes are ranked by
+    int tcp_states;                     // Count TCP sockets per state (netlink)
+    int adaptive;                       // Per-collector periods; 0 reads every section
+                                        // on every sample
+    long interval_ms;                   // Sampling period the collector periods round to
+    int refresh;                        // Read every section now, whatever its period
+} collect_options_t;
+
 // Function prototypes for data collection
 int read_cpu_info(cpu_info_t *cpu);
+int cpu_core_count(void);
+
+// Function prototypes for the per-core CPU kernels
+int cpu_counters_resize(cpu_counters_t *counters, int old_count, int count);
+void cpu_counters_free(cpu_counters_t *counters);
+int cpu_usage_resize(cpu_usage_t *usage, int old_count, int count);
+void cpu_usage_free(cpu_usage_t *usage);
+const cpu_kernel_t *cpu_kernel_list(int *count);
+cpu_kernel_fn cpu_kernel_best(void);
 int read_memory_info(memory_info_t *memory);
+int read_sensor_info(sensor_info_t *info);
+double read_cpu_temperature(void);
+const char *sensor_kind_name(sensor_kind_t kind);
 int read_uptime_info(uptime_info_t *uptime);
-int read_disk_info(disk_info_t *disk);
-int read_top_processes(process_info_t *processes, int max_count);
+int read_disk_info(disk_info_t *disk, int capacity);
+int read_net_info(net_info_t *net, int tcp_states);
+const char *net_tcp_state_name(int state);
+int read_cgroup_info(cgroup_tree_t *tree);
+int read_pressure_info(pressure_info_t *pressure);
+const char *psi_resource_name(int resource);
+
+// PSI stall triggers (--psi-trigger)
+int pressure_triggers_open(long stall_ms, long window_ms);
+void pressure_triggers_close(void);
+int pressure_trigger_fd(int resource);
+void pressure_trigger_fired(int fd);
+int read_top_processes(process_info_t *processes, int max_count, proc_sort_t sort_key);
+int process_scan_set_threads(int threads);
 
-// Function prototypes for display
+// Live process set kept from kernel proc connector events (--proc-events)
+int proc_events_open(void);
+void proc_events_close(void);
+int proc_events_active(void);
+int proc_events_update(void);
+void proc_events_seed(const int *pids, size_t count);
+void proc_events_forget(int pid);
+ssize_t proc_events_list(int **pids, size_t *cap);
+void collect_system_info(system_info_t *info, const collect_options_t *options);
+void collect_fast(const collect_options_t *options);
+int aggregate_open(int cores);
+void aggregate_close(void);
+void aggregate_feed(const system_info_t *sample, double now);
+void aggregate_stats(window_info_t *out, double now);
+const char *window_name(int window);
+
+// Function prototypes for display (event_loop_t is defined further down)
+struct event_loop;
 void display_system_info(const system_info_t *info, int show_flags);
-void display_header(void);
+void display_header(time_t when);
 void display_cpu_info(const cpu_info_t *cpu);
 void display_memory_info(const memory_info_t *memory);
 void display_uptime_info(const uptime_info_t *uptime);
 void display_disk_info(const disk_info_t *disk);
+void display_net_info(const net_info_t *net);
+void display_cgroups(const cgroup_tree_t *tree);
+void display_pressure(const pressure_info_t *pressure);
+void display_windows(const window_info_t *windows);
+void display_sensors(const sensor_info_t *sensors);
 void display_processes(const process_info_t *processes, int count);
+void display_status(const struct event_loop *loop);
+void display_self_stats(void);
+void display_set_output(FILE *fp);
+
+// Function prototypes for the diffing screen renderer
+int screen_init(int fd);
+void screen_invalidate(void);
+FILE *screen_begin(void);
+int screen_end(void);
+void screen_close(void);
+
+// Persistent /proc file handle: opened once, re-read with pread() every sample
+typedef struct {
+    const char *path;                   // Absolute /proc or /sys path of the file
+    int fd;                             // Open descriptor, -1 until first read
+    char *buf;                          // Reusable read buffer (NUL-terminated)
+    size_t cap;                         // Allocated size of buf
+    size_t len;                         // Bytes read by the last sample
+    unsigned int generation;            // Root generation fd was opened under
+} proc_file_t;
+
+#define PROC_FILE_INIT(file_path) { (file_path), -1, NULL, 0, 0, 0 }
+
+// Function prototypes for the /proc sampler
+int sysmon_set_roots(const char *proc_root, const char *sys_root);
+unsigned int sysmon_root_generation(void);
+const char *sysmon_path(const char *path, char *buf, size_t size);
+int sysmon_open(const char *path, int flags);
+ssize_t proc_file_read(proc_file_t *pf);
+void proc_file_close(proc_file_t *pf);
+void *grow_array(void *ptr, int *cap, int count, size_t size);
+int compare_ints(const void *a, const void *b);
+const char *scan_skip_spaces(const char *p);
+const char *scan_ulong(const char *p, unsigned long *value);
+const char *scan_next_line(const char *p);
+int scan_key(const char *buf, const char *key, size_t key_len, unsigned long *value);
+
+// Per-process sample kept between refreshes, keyed by PID + start time
+typedef struct {
+    int pid;                            // Process ID, 0 marks an empty slot
+    int fresh;                          // No previous sample for this process
+    unsigned int seen;                  // Generation of the last update
+    unsigned long long starttime;       // Start time in clock ticks after boot
+    unsigned long long ticks;           // utime + stime at the last sample
+    unsigned long long major_faults;    // majflt at the last sample
+    unsigned int detail_seen;           // Generation the counters below were last read
+    unsigned long long read_bytes;      // /proc/[pid]/io at the last read
+    unsigned long long write_bytes;
+    unsigned long long voluntary_ctxsw; // /proc/[pid]/status at the last read
+    unsigned long long involuntary_ctxsw;
+} proc_entry_t;
+
+// Open-addressed (linear probing) hash table of proc_entry_t
+typedef struct {
+    proc_entry_t *slots;                // Power-of-two sized slot array
+    size_t capacity;                    // Number of slots
+    size_t count;                       // Live entries
+    unsigned int generation;            // Incremented on every sampling pass
+    long clk_tck;                       // sysconf(_SC_CLK_TCK)
+    double last_sample;                 // CLOCK_MONOTONIC time of the last pass
+    double elapsed;                     // Seconds between the last two passes
+    double boot_seconds;                // CLOCK_BOOTTIME at the current pass
+} proc_table_t;
+
+// Function prototypes for the process table
+int proc_table_init(proc_table_t *table);
+void proc_table_free(proc_table_t *table);
+void proc_table_begin(proc_table_t *table);
+proc_entry_t *proc_table_sample(proc_table_t *table, int pid, unsigned long long starttime);
+proc_entry_t *proc_table_find(proc_table_t *table, int pid);
+double proc_table_rate(const proc_table_t *table, const proc_entry_t *entry,
+                       unsigned long long *previous, unsigned long long current);
+double proc_table_detail_rate(const proc_table_t *table, const proc_entry_t *entry,
+                              unsigned long long *previous, unsigned long long current);
+void proc_table_end(proc_table_t *table);
+
+// Fork-join worker pool used by the parallel process scan
+typedef void (*thread_pool_fn)(void *arg, int worker_index);
+
+int thread_pool_start(int size);
+void thread_pool_stop(void);
+int thread_pool_size(void);
+void thread_pool_run(thread_pool_fn fn, void *arg);
+
+// Output formats selected with --format
+typedef enum {
+    FORMAT_TEXT,                        // ANSI box rendering (default)
+    FORMAT_JSONL,                       // One JSON object per line
+    FORMAT_CSV,                         // Header line plus one row per sample
+    FORMAT_BINARY,                      // Stream of sysmon_record_t records
+    FORMAT_PROMETHEUS                   // Prometheus text exposition, one block per sample
+} output_format_t;
+
+// Buffered writer shared by the machine-readable formats
+typedef struct {
+    int fd;                             // Destination descriptor, -1 to keep the bytes in buf
+    int owns_fd;                        // Close fd on output_close()
+    char *buf;                          // Pending bytes
+    size_t len;                         // Bytes pending in buf
+    size_t cap;                         // Size of buf
+    int csv_header_done;                // CSV header already written
+    int csv_flags;                      // Sections in the CSV columns
+    int csv_cores;                      // Per-core columns in the CSV
+    int csv_processes;                  // Process column groups in the CSV
+} out_writer_t;
+
+// Binary record layout (native byte order). Each record is a fixed header
+// followed by the per-core, process, mount, device, interface, cgroup and
+// sensor arrays at the given offsets; record_size is a multiple of 8 so
+// records can be walked in an mmap. Mounts, devices, interfaces, cgroups and
+// sensors are stored as mount_info_t, disk_io_t, net_if_t, cgroup_info_t and
+// sensor_t, at most RECORD_MAX_* of each.
+#define SYSMON_RECORD_MAGIC   0x4e4f4d53u   // "SMON"
+#define SYSMON_RECORD_VERSION 11
+#define RECORD_MAX_MOUNTS     16
+#define RECORD_MAX_DEVICES    16
+#define RECORD_MAX_INTERFACES 16
+#define RECORD_MAX_CGROUPS    MAX_CGROUP_ROWS
+#define RECORD_MAX_SENSORS    64
+
+typedef struct {
+    uint32_t magic;                     // SYSMON_RECORD_MAGIC
+    uint16_t version;                   // SYSMON_RECORD_VERSION
+    uint16_t header_size;               // sizeof(sysmon_record_t)
+    uint32_t record_size;               // Header plus trailing arrays
+    uint32_t valid_flags;               // SHOW_* bits of the sections collected
+    int64_t timestamp_ns;               // Wall-clock sample time
+    uint32_t core_count;                // Entries in each per-core array
+    uint32_t process_count;             // Entries in the process array
+    uint32_t cores_offset;              // Offset of double usage, iowait, steal and
+                                        // irq[core_count], one array after the other
+    uint32_t processes_offset;          // Offset of sysmon_record_process_t[process_count]
+    uint32_t mount_count;               // Entries in the mount array
+    uint32_t device_count;              // Entries in the device array
+    uint32_t mounts_offset;             // Offset of mount_info_t[mount_count]
+    uint32_t devices_offset;            // Offset of disk_io_t[device_count]
+    uint32_t interface_count;           // Entries in the interface array
+    uint32_t interfaces_offset;         // Offset of net_if_t[interface_count]
+    uint32_t cgroup_count;              // Entries in the cgroup array
+    uint32_t cgroups_offset;            // Offset of cgroup_info_t[cgroup_count]
+    uint32_t sensor_count;              // Entries in the sensor array
+    uint32_t sensors_offset;            // Offset of sensor_t[sensor_count]
+    char cpu_model[128];
+    int32_t cpu_cores;
+    int32_t cpu_online;
+    double cpu_total_usage;
+    double cpu_iowait_percent;
+    double cpu_steal_percent;
+    double cpu_irq_percent;
+    double cpu_temperature;
+    uint64_t mem_total_kb;
+    uint64_t mem_available_kb;
+    uint64_t mem_used_kb;
+    uint64_t mem_free_kb;
+    uint64_t mem_buffers_kb;
+    uint64_t mem_cached_kb;
+    uint64_t swap_total_kb;
+    uint64_t swap_used_kb;
+    uint64_t swap_free_kb;
+    double mem_usage_percent;
+    double swap_percent;
+    uint64_t mem_shmem_kb;
+    uint64_t mem_slab_reclaimable_kb;
+    uint64_t mem_slab_unreclaimable_kb;
+    uint64_t mem_dirty_kb;
+    uint64_t mem_writeback_kb;
+    uint64_t mem_anon_kb;
+    uint64_t mem_file_kb;
+    uint64_t hugepages_total;
+    uint64_t hugepages_free;
+    uint64_t hugepage_size_kb;
+    double pgfault_per_sec;             // /proc/vmstat rates, -1 when not sampled
+    double pgmajfault_per_sec;
+    double pswpin_per_sec;
+    double pswpout_per_sec;
+    double pgscan_per_sec;
+    double pgsteal_per_sec;
+    double compact_stall_per_sec;
+    double numa_miss_per_sec;
+    int64_t oom_kills;                  // Over the interval, -1 unknown
+    uint32_t numa_count;                // Valid entries of numa
+    uint32_t numa_reserved;
+    numa_node_t numa[MAX_NUMA_NODES];
+    uint64_t uptime_seconds;
+    char disk_filesystem[64];
+    uint64_t disk_total_bytes;
+    uint64_t disk_used_bytes;
+    uint64_t disk_available_bytes;
+    double disk_usage_percent;
+    double net_rx_bytes_per_sec;
+    double net_tx_bytes_per_sec;
+    uint32_t tcp_valid;
+    uint32_t tcp_states[NET_TCP_STATES];
+    uint32_t cgroups_tracked;           // Groups below the root, listed or not
+    uint32_t stale_flags;               // SHOW_* bits of sections carried over
+    pressure_info_t pressure;
+} sysmon_record_t;
+
+typedef struct {
+    int32_t pid;
+    int32_t threads;
+    double cpu_percent;
+    double io_rate;                     // Negative if not sampled
+    uint64_t memory_kb;
+    int64_t pss_kb;                     // Negative if not readable
+    double read_bytes_per_sec;          // Negative if not readable
+    double write_bytes_per_sec;
+    double voluntary_ctxsw_per_sec;     // Negative if not readable
+    double involuntary_ctxsw_per_sec;
+    double major_faults_per_sec;
+    char name[MAX_PROC_NAME];
+} sysmon_record_process_t;
+
+// Function prototypes for machine-readable output
+int output_open(out_writer_t *w, const char *path);
+int output_open_memory(out_writer_t *w);
+int output_flush(out_writer_t *w);
+void output_close(out_writer_t *w);
+int output_write_sample(out_writer_t *w, output_format_t format, const system_info_t *info);
+size_t record_encode(const system_info_t *info, void *out, size_t cap);
+int record_decode(const void *data, size_t len, system_info_t *info);
+size_t record_max_size(int cores);
+void out_bytes(out_writer_t *w, const void *data, size_t n);
+void out_str(out_writer_t *w, const char *s);
+void out_char(out_writer_t *w, char c);
+void out_u64(out_writer_t *w, unsigned long long v);
+void out_i64(out_writer_t *w, long long v);
+void out_fixed(out_writer_t *w, double v, int decimals);
+void out_json_string(out_writer_t *w, const char *s);
+
+// Memory-mapped ring of binary records kept by --record
+typedef struct {
+    int fd;                             // Ring file descriptor
+    char *map;                          // Mapping of the whole file
+    size_t size;                        // Size of the mapping
+    uint32_t slot_size;                 // Bytes per slot
+    uint64_t slot_count;                // Slots in the ring
+} history_t;
+
+// Default number of samples kept by --record
+#define DEFAULT_HISTORY_SLOTS 3600
+
+// Shared-memory segment of the latest sample, published by sysmond
+typedef struct {
+    int fd;                             // Shared-memory object descriptor
+    char *map;                          // Mapping of the whole object
+    size_t size;                        // Size of the mapping
+    uint32_t record_size;               // Bytes reserved for the record
+    uint64_t ino;                       // Object the name pointed to when attached
+    long interval_ms;                   // Publisher's sampling period
+    uint64_t seq;                       // Reader: sequence of the last sample read
+    void *scratch;                      // Reader: copy of the record being decoded
+    char name[64];                      // Object name, as passed to shm_open()
+} shm_segment_t;
+
+// Default shared-memory object name of sysmond
+#define DEFAULT_SHM_NAME "/sysmon"
+
+// HTTP endpoint of --serve
+#define HTTP_MAX_CONNS 64                // Connections served at once
+#define HTTP_IDLE_TIMEOUT 30             // Seconds before an idle connection is dropped
+
+typedef struct {
+    int fd;                             // -1 for a free slot
+    char request[2048];                 // Request head bytes read so far
+    size_t request_len;
+    int responding;                     // A response is being sent
+    int writing;                        // Registered for EPOLLOUT
+    int keep_alive;                     // Read the next request after this response
+    char head[256];                     // Status line and headers
+    size_t head_len;
+    const char *body;                   // Snapshot or static body
+    size_t body_len;
+    size_t sent;                        // Bytes of head and body written
+    int snapshot;                       // Snapshot the body points into, -1 for none
+    double last_active;                 // CLOCK_MONOTONIC time of the last request bytes
+} http_conn_t;
+
+typedef struct {
+    int epfd;                           // Listening socket and connections
+    int listen_fd;
+    char unix_path[108];                // Socket file removed on close, "" for TCP
+    out_writer_t snapshots[2];          // Serialized samples
+    int refs[2];                        // Connections sending from each snapshot
+    int front;                          // Snapshot answered to new scrapes, -1 before the first
+    http_conn_t *conns;                 // [HTTP_MAX_CONNS]
+} http_server_t;
+
+// Event loop driving watch and follow mode
+
+// Most events a single epoll_wait() returns
+#define EVENT_LOOP_BATCH 8
+
+typedef enum {
+    EVENT_TICK,                         // Next sampling period started
+    EVENT_KEY,                          // Key pressed on the terminal
+    EVENT_STALL,                        // A PSI trigger descriptor raised POLLPRI
+    EVENT_SERVE,                        // The --serve sockets have work
+    EVENT_FAST,                         // Next fast sampling period (--windows) started
+    EVENT_QUIT                          // SIGINT, SIGTERM or 'q'
+} event_type_t;
+
+typedef struct {
+    event_type_t type;
+    int key;                            // EVENT_KEY: the key
+    int stall_fds[EVENT_LOOP_BATCH];    // EVENT_STALL: the trigger descriptors that fired
+    int stall_count;
+    int burst;                          // EVENT_TICK: a fast tick of a stall burst
+    uint64_t missed;                    // EVENT_TICK: periods skipped by an overrun
+} event_t;
+
+typedef struct event_loop {
+    int epfd;
+    int timer_fd;                       // Absolute CLOCK_MONOTONIC period timer
+    int signal_fd;                      // SIGINT, SIGTERM, SIGWINCH
+    int key_fd;                         // stdin in non-canonical mode, or -1
+    long interval_ms;                   // Sampling period
+    int raw_tty;                        // saved_tty must be restored
+    struct termios saved_tty;
+    uint64_t ticks;                     // Periods elapsed
+    uint64_t overruns;                  // Periods skipped because sampling overran
+    struct timespec start;              // Period boundaries are start + k * interval_ms
+    int triggers;                       // PSI trigger descriptors watched
+    int serve_fd;                       // epoll set of the --serve sockets, or -1
+    int fast_fd;                        // Fast sampling timer of --windows, or -1
+    uint64_t stalls;                    // EVENT_STALL wakeups so far
+    int burst_left;                     // Fast ticks left before the period resumes
+    long burst_ms;                      // Period of the current burst
+} event_loop_t;
+
+#define DEFAULT_INTERVAL_MS 2000
+#define MIN_INTERVAL_MS 50
+
+// Self-profiling probes
+typedef enum {
+    PROBE_CPU,
+    PROBE_MEMORY,
+    PROBE_UPTIME,
+    PROBE_DISK,
+    PROBE_NET,
+    PROBE_CGROUPS,
+    PROBE_PRESSURE,
+    PROBE_SENSORS,
+    PROBE_PROCESSES,                    // Whole scan, on the calling thread
+    PROBE_SCAN_WORKER,                  // Scan share of each helper thread
+    PROBE_RENDER,                       // Display or serialization of a sample
+    PROBE_COUNT
+} selfstat_probe_t;
+
+// Power-of-two wall-time histogram buckets (1 ns up to ~9 minutes)
+#define SELFSTAT_BUCKETS 40
+
+// One measured call, kept on the caller's stack
+typedef struct {
+    selfstat_probe_t probe;
+    int active;                         // Profiling was enabled at begin
+    uint64_t wall_ns;                   // Start times and I/O counters at begin
+    uint64_t cpu_ns;
+    uint64_t syscalls;
+    uint64_t bytes;
+} selfstat_span_t;
+
+// A probe summed over all threads
+typedef struct {
+    uint64_t count;
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+    uint64_t syscalls;
+    uint64_t bytes;
+    uint64_t max_ns;
+    uint64_t p50_ns;                    // Histogram estimates (bucket upper bounds)
+    uint64_t p99_ns;
+} selfstat_summary_t;
+
+// Function prototypes for self-profiling
+void selfstat_enable(int on);
+int selfstat_enabled(void);
+const char *selfstat_probe_name(selfstat_probe_t probe);
+void selfstat_io(unsigned long syscalls, unsigned long bytes);
+void selfstat_begin(selfstat_span_t *span, selfstat_probe_t probe);
+void selfstat_end(selfstat_span_t *span);
+void selfstat_summary(selfstat_probe_t probe, selfstat_summary_t *out);
+
+// Function prototypes for the event loop
+int event_loop_open(event_loop_t *loop, long interval_ms, int keys);
+int event_loop_next(event_loop_t *loop, event_t *event);
+void event_loop_close(event_loop_t *loop);
+int event_loop_add_trigger(event_loop_t *loop, int fd);
+int event_loop_burst(event_loop_t *loop, long burst_ms, int ticks);
+int event_loop_add_server(event_loop_t *loop, int fd);
+int event_loop_add_fast(event_loop_t *loop, long interval_ms);
+
+typedef void (*history_render_fn)(const system_info_t *info, void *ctx);
+
+// Function prototypes for the history ring
+int history_open_writer(history_t *h, const char *path, uint64_t slot_count);
+int history_open_reader(history_t *h, const char *path);
+void history_close(history_t *h);
+void history_append(history_t *h, const system_info_t *info);
+uint64_t history_head(const history_t *h);
+uint64_t history_tail(const history_t *h);
+int history_read(const history_t *h, uint64_t index, void *scratch, system_info_t *info);
+int history_replay(const char *path, double from, double to, int follow,
+                   history_render_fn render, void *ctx, event_loop_t *loop);
+
+// Function prototypes for the shared-memory publisher and its clients
+int shm_publisher_open(shm_segment_t *s, const char *name, long interval_ms);
+void shm_publish(shm_segment_t *s, const system_info_t *info);
+void shm_publisher_close(shm_segment_t *s);
+int shm_reader_open(shm_segment_t *s, const char *name);
+void shm_reader_close(shm_segment_t *s);
+int shm_reader_read(shm_segment_t *s, system_info_t *info);
+int shm_follow(shm_segment_t *s, int follow, history_render_fn render, void *ctx,
+               event_loop_t *loop);
+
+// Function prototypes for the HTTP endpoint
+int http_server_open(http_server_t *srv, const char *addr);
+void http_server_close(http_server_t *srv);
+void http_server_publish(http_server_t *srv, const system_info_t *info);
+void http_server_poll(http_server_t *srv);
 
 // Utility function prototypes
 const char* get_color_by_percentage(double percent);
 void format_bytes(unsigned long bytes, char *output);
 void clear_screen(void);
+void format_uptime(unsigned long total_seconds, char *output, size_t size);
 
 // Display flags for modular output (bit flags)
 #define SHOW_CPU     (1 << 0)    // Show CPU information
@@ -114,6 +885,12 @@ void clear_screen(void);
 #define SHOW_UPTIME  (1 << 2)    // Show uptime information
 #define SHOW_DISK    (1 << 3)    // Show disk information
 #define SHOW_PROC    (1 << 4)    // Show process information
-#define SHOW_ALL     (SHOW_CPU | SHOW_MEMORY | SHOW_UPTIME | SHOW_DISK | SHOW_PROC)
+#define SHOW_NET     (1 << 5)    // Show network information
+#define SHOW_CGROUPS (1 << 6)    // Show the cgroup tree (only on request)
+#define SHOW_PRESSURE (1 << 7)   // Show pressure stall information
+#define SHOW_WINDOWS (1 << 8)    // Show rolling windows of the fast metrics (only on request)
+#define SHOW_SENSORS (1 << 9)    // Show temperatures, fans and power
+#define SHOW_ALL     (SHOW_CPU | SHOW_MEMORY | SHOW_UPTIME | SHOW_DISK | SHOW_PROC | SHOW_NET | \
+                      SHOW_PRESSURE | SHOW_SENSORS)
 
 #endif
\ No newline at end of file
@@ -1,148 +1,356 @@
 #include "sysmon.h"
 
+// Formats a number of seconds as "N days, N hours, N minutes" and so on
+void format_uptime(unsigned long total_seconds, char *output, size_t size) {
+    unsigned long days = total_seconds / 86400;
+    unsigned long hours = (total_seconds % 86400) / 3600;
+    unsigned long minutes = (total_seconds % 3600) / 60;
+    unsigned long seconds = total_seconds % 60;
+
+    if (days > 0) {
+        snprintf(output, size,
+                "%lu days, %lu hours, %lu minutes", days, hours, minutes);
+    } else if (hours > 0) {
+        snprintf(output, size,
+                "%lu hours, %lu minutes", hours, minutes);
+    } else {
+        snprintf(output, size,
+                "%lu minutes, %lu seconds", minutes, seconds);
+    }
+}
+
+// Persistent handle for /proc/uptime
+static proc_file_t uptime_file = PROC_FILE_INIT("/proc/uptime");
+
 int read_uptime_info(uptime_info_t *uptime) {
-    FILE *fp;
-    double uptime_seconds;
+    unsigned long uptime_seconds;
 
     memset(uptime, 0, sizeof(uptime_info_t));
 
-    // Read system uptime from /proc/uptime
-    fp = fopen("/proc/uptime", "r");
-    if (!fp) {
-        perror("Error opening /proc/uptime");
+    // Read system uptime from /proc/uptime (only the whole seconds are used)
+    if (proc_file_read(&uptime_file) < 0) {
+        perror("Error reading /proc/uptime");
         return -1;
     }
 
-    if (fscanf(fp, "%lf", &uptime_seconds) != 1) {
-        fclose(fp);
+    if (!scan_ulong(uptime_file.buf, &uptime_seconds)) {
         return -1;
     }
-    fclose(fp);
 
-    uptime->uptime_seconds = (unsigned long)uptime_seconds;
+    uptime->uptime_seconds = uptime_seconds;
 
     // Format uptime into human-readable string
-    unsigned long days = uptime->uptime_seconds / 86400;
-    unsigned long hours = (uptime->uptime_seconds % 86400) / 3600;
-    unsigned long minutes = (uptime->uptime_seconds % 3600) / 60;
-    unsigned long seconds = uptime->uptime_seconds % 60;
-
-    if (days > 0) {
-        snprintf(uptime->uptime_formatted, sizeof(uptime->uptime_formatted),
-                "%lu days, %lu hours, %lu minutes", days, hours, minutes);
-    } else if (hours > 0) {
-        snprintf(uptime->uptime_formatted, sizeof(uptime->uptime_formatted),
-                "%lu hours, %lu minutes", hours, minutes);
-    } else {
-        snprintf(uptime->uptime_formatted, sizeof(uptime->uptime_formatted),
-                "%lu minutes, %lu seconds", minutes, seconds);
-    }
+    format_uptime(uptime->uptime_seconds, uptime->uptime_formatted,
+                  sizeof(uptime->uptime_formatted));
 
     return 0;
 }
 
-int read_disk_info(disk_info_t *disk) {
-    struct statvfs stat_buf;
+// Collectors in the order a sample reads them
+typedef enum {
+    COLLECT_CPU,
+    COLLECT_MEMORY,
+    COLLECT_UPTIME,
+    COLLECT_DISK,                       // I/O rates; capacity is COLLECT_MOUNTS
+    COLLECT_MOUNTS,
+    COLLECT_NET,
+    COLLECT_PRESSURE,
+    COLLECT_SENSORS,
+    COLLECT_CGROUPS,
+    COLLECT_PROCESSES,
+    COLLECTORS
+} collector_id_t;
 
-    memset(disk, 0, sizeof(disk_info_t));
+typedef struct {
+    int flag;                           // SHOW_* bit of the section, 0 for mounts
+    selfstat_probe_t probe;
+    long base_ms;                       // Period while the data moves, 0 for every sample
+    long budget_ms;                     // Longest a result is reused (adaptive collectors)
+    uint64_t (*signature)(const system_info_t *info); // NULL for a fixed period
+} collector_spec_t;
 
-    // Get filesystem statistics for root directory
-    if (statvfs("/", &stat_buf) != 0) {
-        perror("Error getting disk information");
-        return -1;
+typedef struct {
+    double last_run;                    // CLOCK_MONOTONIC time of the last read, 0 for never
+    long period_ms;                     // Current period
+    int has_signature;
+    uint64_t signature;                 // Summary of the last result
+} collector_state_t;
+
+static uint64_t mounts_signature(const system_info_t *info);
+static uint64_t cgroups_signature(const system_info_t *info);
+static uint64_t processes_signature(const system_info_t *info);
+
+// Schedule of adaptive sampling. Rates that move all the time are read on
+// every sample; the slow scans back off while their results stay the same
+// and are reused from the last read in between.
+static const collector_spec_t collectors[COLLECTORS] = {
+    [COLLECT_CPU]       = {SHOW_CPU,      PROBE_CPU,       0,     0,     NULL},
+    [COLLECT_MEMORY]    = {SHOW_MEMORY,   PROBE_MEMORY,    0,     0,     NULL},
+    [COLLECT_UPTIME]    = {SHOW_UPTIME,   PROBE_UPTIME,    1000,  1000,  NULL},
+    [COLLECT_DISK]      = {SHOW_DISK,     PROBE_DISK,      0,     0,     NULL},
+    [COLLECT_MOUNTS]    = {0,             PROBE_DISK,      5000,  60000, mounts_signature},
+    [COLLECT_NET]       = {SHOW_NET,      PROBE_NET,       0,     0,     NULL},
+    [COLLECT_PRESSURE]  = {SHOW_PRESSURE, PROBE_PRESSURE,  0,     0,     NULL},
+    [COLLECT_SENSORS]   = {SHOW_SENSORS,  PROBE_SENSORS,   1000,  1000,  NULL},
+    [COLLECT_CGROUPS]   = {SHOW_CGROUPS,  PROBE_CGROUPS,   2000,  10000, cgroups_signature},
+    [COLLECT_PROCESSES] = {SHOW_PROC,     PROBE_PROCESSES, 1000,  8000,  processes_signature},
+};
+
+static collector_state_t collector_states[COLLECTORS];
+static system_info_t carried;           // Last result of every section
+
+// Total CPU and used memory when the process list was last read: a jump in
+// either wakes the backed-off scans
+#define WAKE_CPU_PERCENT    5.0
+#define WAKE_MEMORY_PERCENT 2.0
+static double scan_cpu_usage = -1.0;
+static unsigned long scan_memory_used = 0;
+
+// FNV-1a step over a 64-bit value
+static uint64_t mix(uint64_t hash, uint64_t value) {
+    return (hash ^ value) * 1099511628211ull;
+}
+
+// Capacities to the MiB: a log file growing does not count as a change
+static uint64_t mounts_signature(const system_info_t *info) {
+    uint64_t hash = mix(14695981039346656037ull, (uint64_t)info->disk.mount_count);
+
+    for (int i = 0; i < info->disk.mount_count; i++) {
+        hash = mix(hash, info->disk.mounts[i].total_bytes >> 20);
+        hash = mix(hash, info->disk.mounts[i].used_bytes >> 20);
     }
+    return hash;
+}
 
-    strcpy(disk->filesystem, "/");
+static uint64_t cgroups_signature(const system_info_t *info) {
+    uint64_t hash = mix(14695981039346656037ull, (uint64_t)info->cgroups.tracked);
 
-    // Calculate disk space statistics
-    disk->total_bytes = stat_buf.f_blocks * stat_buf.f_frsize;
-    disk->available_bytes = stat_buf.f_bavail * stat_buf.f_frsize;
-    disk->used_bytes = disk->total_bytes - (stat_buf.f_bfree * stat_buf.f_frsize);
+    for (int i = 0; i < info->cgroups.count; i++) {
+        const cgroup_info_t *group = &info->cgroups.groups[i];
+        for (const char *p = group->path; *p; p++) hash = mix(hash, (unsigned char)*p);
+        hash = mix(hash, (uint64_t)(group->cpu_percent + 0.5));
+        hash = mix(hash, (uint64_t)(group->memory_bytes >> 20));
+    }
+    return hash;
+}
 
-    // Calculate usage percentage
-    if (disk->total_bytes > 0) {
-        disk->usage_percent = (double)disk->used_bytes * 100.0 / disk->total_bytes;
+// Which processes make the top K, in any order. On a busy host the ranking,
+// CPU percents and RSS of the listed processes change on nearly every scan,
+// so only the membership is compared (ties rank by PID, so it settles). A
+// process crossing the cut still resets the period; load shifts within the
+// set are caught by the CPU and memory jumps that wake the scan.
+static uint64_t processes_signature(const system_info_t *info) {
+    uint64_t members = 0;
+
+    for (int i = 0; i < info->process_count; i++) {
+        members += mix(14695981039346656037ull, (uint64_t)info->top_processes[i].pid);
     }
+    return mix(members, (uint64_t)info->process_count);
+}
 
-    return 0;
+// True when a collector has to be read in this sample. Half an interval of
+// slack keeps a period from slipping a whole tick on timer jitter.
+static int collector_due(collector_id_t id, double now, const collect_options_t *options) {
+    const collector_state_t *state = &collector_states[id];
+
+    if (!options->adaptive || options->refresh || state->last_run == 0.0) return 1;
+
+    double slack = options->interval_ms / 2000.0;
+    return now - state->last_run + slack >= state->period_ms / 1000.0;
 }
 
-// Comparison function for sorting processes by CPU usage
-int compare_processes_by_cpu(const void *a, const void *b) {
-    const process_info_t *proc_a = (const process_info_t *)a;
-    const process_info_t *proc_b = (const process_info_t *)b;
+// Books a read: an unchanged result doubles the period up to the budget,
+// a changed one goes back to the base period
+static void collector_ran(collector_id_t id, double now, const system_info_t *info) {
+    const collector_spec_t *spec = &collectors[id];
+    collector_state_t *state = &collector_states[id];
 
-    if (proc_b->cpu_percent > proc_a->cpu_percent) return 1;
-    if (proc_b->cpu_percent < proc_a->cpu_percent) return -1;
-    return 0;
+    state->last_run = now;
+    if (!spec->signature) {
+        state->period_ms = spec->base_ms;
+        return;
+    }
+
+    uint64_t signature = spec->signature(info);
+    if (state->has_signature && signature == state->signature) {
+        long doubled = state->period_ms > 0 ? state->period_ms * 2 : spec->base_ms;
+        state->period_ms = doubled < spec->budget_ms ? doubled : spec->budget_ms;
+    } else {
+        state->period_ms = spec->base_ms;
+    }
+    state->signature = signature;
+    state->has_signature = 1;
+}
+
+// Drops a backed-off collector to its base period and reads it now
+static void collector_wake(collector_id_t id) {
+    collector_states[id].last_run = 0.0;
+    collector_states[id].period_ms = collectors[id].base_ms;
 }
 
-int read_top_processes(process_info_t *processes, int max_count) {
-    DIR *proc_dir;
-    struct dirent *entry;
-    FILE *fp;
-    char path[512];
-    char line[MAX_LINE_LEN];
-    int count = 0;
-
-    memset(processes, 0, max_count * sizeof(process_info_t));
-
-    // Open /proc directory to read process information
-    proc_dir = opendir("/proc");
-    if (!proc_dir) {
-        perror("Error opening /proc");
-        return 0;
-    }
-
-    // Iterate through /proc directory entries
-    while ((entry = readdir(proc_dir)) && count < max_count) {
-        // Skip non-numeric entries (only process IDs are numeric)
-        if (!isdigit(entry->d_name[0])) continue;
-
-        int pid = atoi(entry->d_name);
-        if (pid <= 0) continue;
-
-        // Read process name from /proc/[pid]/comm
-        snprintf(path, sizeof(path), "/proc/%d/comm", pid);
-        fp = fopen(path, "r");
-        if (!fp) continue;
-
-        memset(line, 0, sizeof(line));
-        if (fgets(line, sizeof(line), fp)) {
-            char *newline = strchr(line, '\n');
-            if (newline) *newline = '\0';
-            size_t name_len = strlen(line);
-            if (name_len >= MAX_PROC_NAME) name_len = MAX_PROC_NAME - 1;
-            memcpy(processes[count].name, line, name_len);
-            processes[count].name[name_len] = '\0';
-        } else {
-            strcpy(processes[count].name, "unknown");
+// Copies one section between two samples
+static void copy_section(system_info_t *dst, const system_info_t *src, int flag) {
+    switch (flag) {
+        case SHOW_CPU:      dst->cpu = src->cpu; break;
+        case SHOW_MEMORY:   dst->memory = src->memory; break;
+        case SHOW_UPTIME:   dst->uptime = src->uptime; break;
+        case SHOW_DISK:     dst->disk = src->disk; break;
+        case SHOW_NET:      dst->net = src->net; break;
+        case SHOW_PRESSURE: dst->pressure = src->pressure; break;
+        case SHOW_SENSORS:  dst->sensors = src->sensors; break;
+        case SHOW_CGROUPS:  dst->cgroups = src->cgroups; break;
+        case SHOW_PROC:
+            memcpy(dst->top_processes, src->top_processes,
+                   (size_t)src->process_count * sizeof(process_info_t));
+            dst->process_count = src->process_count;
+            break;
+    }
+}
+
+// Reads one section; returns 0 when it holds a fresh result
+static int read_section(collector_id_t id, system_info_t *info, const collect_options_t *options,
+                        double now) {
+    switch (id) {
+        case COLLECT_CPU:
+            return read_cpu_info(&info->cpu);
+        case COLLECT_MEMORY:
+            return read_memory_info(&info->memory);
+        case COLLECT_UPTIME:
+            return read_uptime_info(&info->uptime);
+        case COLLECT_DISK: {
+            int result = read_disk_info(&info->disk, collector_due(COLLECT_MOUNTS, now, options));
+            if (info->disk.capacity_fresh) collector_ran(COLLECT_MOUNTS, now, info);
+            return result;
         }
-        fclose(fp);
+        case COLLECT_NET:
+            return read_net_info(&info->net, options->tcp_states);
+        case COLLECT_PRESSURE:
+            return read_pressure_info(&info->pressure);
+        case COLLECT_SENSORS:
+            return read_sensor_info(&info->sensors);
+        case COLLECT_CGROUPS:
+            return read_cgroup_info(&info->cgroups);
+        case COLLECT_PROCESSES:
+            info->process_count = read_top_processes(info->top_processes, options->top_count,
+                                                     options->sort_key);
+            return 0;
+        default:
+            return -1;
+    }
+}
 
-        processes[count].pid = pid;
+// Wakes the process and cgroup scans when total CPU or memory moved since
+// the process list was read
+static void wake_on_jump(const system_info_t *info) {
+    if (scan_cpu_usage < 0.0) return;
 
-        // Read process statistics from /proc/[pid]/stat
-        snprintf(path, sizeof(path), "/proc/%d/stat", pid);
-        fp = fopen(path, "r");
-        if (!fp) continue;
+    double cpu_jump = 0.0;
+    if (info->valid_flags & SHOW_CPU) {
+        cpu_jump = info->cpu.total_usage - scan_cpu_usage;
+        if (cpu_jump < 0) cpu_jump = -cpu_jump;
+    }
+    double memory_jump = 0.0;
+    if ((info->valid_flags & SHOW_MEMORY) && info->memory.total > 0) {
+        long delta = (long)info->memory.used - (long)scan_memory_used;
+        memory_jump = labs(delta) * 100.0 / (double)info->memory.total;
+    }
+    if (cpu_jump >= WAKE_CPU_PERCENT || memory_jump >= WAKE_MEMORY_PERCENT) {
+        collector_wake(COLLECT_PROCESSES);
+        collector_wake(COLLECT_CGROUPS);
+    }
+}
 
-        unsigned long utime = 0, stime = 0, vsize = 0, rss = 0;
-        if (fscanf(fp, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d %*d %*d %*d %*u %lu %ld",
-                   &utime, &stime, &vsize, &rss) >= 2) {
+// Fast sections of --windows: read on every fast tick and fed to the rolling
+// windows. The regular samples take them from the latest fast sample, so
+// their rates cover one fast period.
+#define FAST_FLAGS (SHOW_CPU | SHOW_MEMORY | SHOW_DISK | SHOW_NET)
+static system_info_t fast;
+static int fast_samples = 0;
 
-            // Calculate CPU usage and memory consumption
-            processes[count].cpu_percent = (double)(utime + stime) / 10000.0;
-            processes[count].memory_kb = rss * 4;  // RSS is in pages, convert to KB
-        }
-        fclose(fp);
+void collect_fast(const collect_options_t *options) {
+    static const collector_id_t ids[] = {COLLECT_CPU, COLLECT_MEMORY, COLLECT_DISK, COLLECT_NET};
+    struct timespec now;
+    selfstat_span_t span;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec + now.tv_nsec / 1e9;
 
-        count++;
+    fast.valid_flags = 0;
+    for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+        const collector_spec_t *spec = &collectors[ids[i]];
+        selfstat_begin(&span, spec->probe);
+        if (read_section(ids[i], &fast, options, time) == 0) fast.valid_flags |= spec->flag;
+        selfstat_end(&span);
     }
-    closedir(proc_dir);
 
-    // Sort processes by CPU usage (highest first)
-    qsort(processes, count, sizeof(process_info_t), compare_processes_by_cpu);
+    // Rates need two readings: the first one only sets the baseline
+    if (fast_samples++ > 0) aggregate_feed(&fast, time);
+}
+
+// Reads every section selected in options into info. In adaptive mode a
+// section whose collector is not due carries its last result and is marked
+// in stale_flags; a section that failed is retried on the next sample. With
+// SHOW_WINDOWS the fast sections come from collect_fast().
+void collect_system_info(system_info_t *info, const collect_options_t *options) {
+    struct timespec now;
 
-    return count;
-}
\ No newline at end of file
+    // Initialize system info structure
+    memset(info, 0, sizeof(system_info_t));
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    info->timestamp = now.tv_sec + now.tv_nsec / 1e9;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec + now.tv_nsec / 1e9;
+
+    selfstat_span_t span;
+
+    for (int id = 0; id < COLLECTORS; id++) {
+        const collector_spec_t *spec = &collectors[id];
+        if (!(options->show_flags & spec->flag)) continue;
+
+        if (id == COLLECT_PROCESSES || id == COLLECT_CGROUPS) wake_on_jump(info);
+
+        if ((options->show_flags & SHOW_WINDOWS) && (spec->flag & FAST_FLAGS)) {
+            if (fast_samples == 0) collect_fast(options);
+            if (fast.valid_flags & spec->flag) {
+                copy_section(info, &fast, spec->flag);
+                info->valid_flags |= spec->flag;
+            }
+            continue;
+        }
+
+        if (!collector_due((collector_id_t)id, time, options)) {
+            if (carried.valid_flags & spec->flag) {
+                copy_section(info, &carried, spec->flag);
+                info->valid_flags |= spec->flag;
+                info->stale_flags |= spec->flag;
+            }
+            continue;
+        }
+
+        selfstat_begin(&span, spec->probe);
+        int result = read_section((collector_id_t)id, info, options, time);
+        selfstat_end(&span);
+
+        if (result != 0) {
+            carried.valid_flags &= ~spec->flag;
+            continue;
+        }
+        info->valid_flags |= spec->flag;
+        collector_ran((collector_id_t)id, time, info);
+
+        if (options->adaptive) {
+            copy_section(&carried, info, spec->flag);
+            carried.valid_flags |= spec->flag;
+        }
+        if (id == COLLECT_PROCESSES) {
+            scan_cpu_usage = (info->valid_flags & SHOW_CPU) ? info->cpu.total_usage : -1.0;
+            scan_memory_used = info->memory.used;
+        }
+    }
+
+    if (options->show_flags & SHOW_WINDOWS) {
+        aggregate_stats(&info->windows, time);
+        info->valid_flags |= SHOW_WINDOWS;
+    }
+}
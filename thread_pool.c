@@ -0,0 +1,131 @@
+#include "sysmon.h"
+#include <pthread.h>
+
+// Fork-join worker pool: thread_pool_run() hands the same task to every
+// worker plus the calling thread and returns once all of them finished.
+static struct {
+    pthread_t *threads;                 // Helper threads (size - 1 of them)
+    int size;                           // Workers including the caller
+    pthread_mutex_t lock;
+    pthread_cond_t start;               // Signals a new generation of work
+    pthread_cond_t done;                // Signals the last helper finished
+    unsigned int generation;            // Incremented for every run
+    int pending;                        // Helpers still running this generation
+    int stopping;                       // Set to make helpers exit
+    thread_pool_fn fn;                  // Current task
+    void *arg;                          // Current task argument
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .size = 1,
+};
+
+// Start parameters handed to each helper thread
+typedef struct {
+    int index;                          // Worker index (the caller is 0)
+    unsigned int generation;            // Last generation before the helper started
+} worker_arg_t;
+
+static worker_arg_t *worker_args = NULL;
+
+static void *worker_main(void *opaque) {
+    int index = ((worker_arg_t *)opaque)->index;
+    unsigned int seen = ((worker_arg_t *)opaque)->generation;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen && !pool.stopping) {
+            pthread_cond_wait(&pool.start, &pool.lock);
+        }
+        if (pool.stopping) break;
+
+        seen = pool.generation;
+        thread_pool_fn fn = pool.fn;
+        void *arg = pool.arg;
+        pthread_mutex_unlock(&pool.lock);
+
+        fn(arg, index);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0) {
+            pthread_cond_signal(&pool.done);
+        }
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+// Starts a pool of the given size (the caller counts as one worker)
+int thread_pool_start(int size) {
+    thread_pool_stop();
+    if (size <= 1) return 0;
+
+    pool.threads = calloc(size - 1, sizeof(pthread_t));
+    worker_args = calloc(size - 1, sizeof(worker_arg_t));
+    if (!pool.threads || !worker_args) {
+        thread_pool_stop();
+        return -1;
+    }
+
+    pool.stopping = 0;
+    for (int i = 0; i < size - 1; i++) {
+        worker_args[i].index = i + 1;
+        worker_args[i].generation = pool.generation;
+        if (pthread_create(&pool.threads[i], NULL, worker_main, &worker_args[i]) != 0) {
+            // Keep the helpers that did start
+            size = i + 1;
+            break;
+        }
+    }
+    pool.size = size;
+    return 0;
+}
+
+// Stops and joins all helper threads
+void thread_pool_stop(void) {
+    if (pool.threads) {
+        pthread_mutex_lock(&pool.lock);
+        pool.stopping = 1;
+        pthread_cond_broadcast(&pool.start);
+        pthread_mutex_unlock(&pool.lock);
+
+        for (int i = 0; i < pool.size - 1; i++) {
+            pthread_join(pool.threads[i], NULL);
+        }
+    }
+
+    free(pool.threads);
+    free(worker_args);
+    pool.threads = NULL;
+    worker_args = NULL;
+    pool.size = 1;
+    pool.stopping = 0;
+}
+
+int thread_pool_size(void) {
+    return pool.size;
+}
+
+// Runs fn(arg, worker_index) on every worker and waits for all of them
+void thread_pool_run(thread_pool_fn fn, void *arg) {
+    if (pool.size > 1) {
+        pthread_mutex_lock(&pool.lock);
+        pool.fn = fn;
+        pool.arg = arg;
+        pool.pending = pool.size - 1;
+        pool.generation++;
+        pthread_cond_broadcast(&pool.start);
+        pthread_mutex_unlock(&pool.lock);
+    }
+
+    fn(arg, 0);
+
+    if (pool.size > 1) {
+        pthread_mutex_lock(&pool.lock);
+        while (pool.pending > 0) {
+            pthread_cond_wait(&pool.done, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
+    }
+}